@@ -0,0 +1,80 @@
+/**
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (c) Bao Project and Contributors. All rights reserved.
+ */
+
+#include <bench.h>
+
+/**
+ * Pointer-chasing latency probe: walks a random single-cycle permutation of cache lines spread
+ * over a buffer much larger than the last level cache, so every load misses and depends on the
+ * previous one. Each sample is the average load latency over a fixed number of hops.
+ */
+
+#ifndef CHASE_SIZE
+#define CHASE_SIZE (16UL * 1024 * 1024)
+#endif
+
+#ifndef CHASE_SAMPLES
+#define CHASE_SAMPLES (512)
+#endif
+
+#ifndef CHASE_HOPS
+#define CHASE_HOPS (1024)
+#endif
+
+#define CHASE_LINE (64)
+
+struct chase_node {
+    struct chase_node* next;
+    uint8_t pad[CHASE_LINE - sizeof(struct chase_node*)];
+};
+
+const char bench_name[] = "chase";
+
+static struct chase_node* volatile chase_sink;
+
+/* Sattolo's algorithm yields a permutation made of a single cycle through every node */
+static void chase_build(struct chase_node* nodes, uint32_t* perm, size_t num)
+{
+    for (size_t i = 0; i < num; i++) {
+        perm[i] = (uint32_t)i;
+    }
+
+    for (size_t i = num - 1; i > 0; i--) {
+        size_t j = (size_t)(bench_rand() % i);
+        uint32_t tmp = perm[i];
+        perm[i] = perm[j];
+        perm[j] = tmp;
+    }
+
+    for (size_t i = 0; i < num; i++) {
+        nodes[i].next = &nodes[perm[i]];
+    }
+}
+
+void bench_main(void)
+{
+    size_t num = CHASE_SIZE / sizeof(struct chase_node);
+    struct chase_node* nodes = bench_alloc(CHASE_SIZE);
+    uint32_t* perm = bench_alloc(num * sizeof(uint32_t));
+    static uint64_t samples[CHASE_SAMPLES];
+
+    chase_build(nodes, perm, num);
+
+    struct chase_node* node = &nodes[0];
+    for (size_t i = 0; i < num; i++) {
+        node = node->next;
+    }
+
+    for (size_t i = 0; i < CHASE_SAMPLES; i++) {
+        uint64_t start = arch_time();
+        for (size_t j = 0; j < CHASE_HOPS; j++) {
+            node = node->next;
+        }
+        samples[i] = bench_ticks_to_ns(arch_time() - start) / CHASE_HOPS;
+    }
+    chase_sink = node;
+
+    bench_report_percentiles("load_ns", samples, CHASE_SAMPLES);
+}
@@ -0,0 +1,142 @@
+/**
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (c) Bao Project and Contributors. All rights reserved.
+ */
+
+#include <bench.h>
+
+/* QEMU virt devices, mapped 1:1 by configs/bench-qemu-aarch64-virt */
+#define UART_BASE        (0x09000000UL)
+#define UART_DR          (0x00)
+#define UART_FR          (0x18)
+#define UART_FR_TXFF     (1U << 5)
+
+#define GICD_BASE        (0x08000000UL)
+#define GICD_CTLR        (0x0000)
+#define GICD_CTLR_ARE_NS (1U << 4)
+#define GICD_CTLR_ENA1   (1U << 1)
+
+#define GICR_BASE        (0x080A0000UL)
+#define GICR_SGI_BASE    (GICR_BASE + 0x10000)
+#define GICR_IGROUPR0    (0x0080)
+#define GICR_ISENABLER0  (0x0100)
+#define GICR_IPRIORITYR  (0x0400)
+
+#define TIMER_VIRT_IRQ   (27)
+#define CNTV_CTL_ENABLE  (1UL << 0)
+
+#define HC_FID_BASE      (0xC6000000UL)
+
+#define SYSREG_READ(reg)                                \
+    ({                                                  \
+        unsigned long _val;                             \
+        __asm__ volatile("mrs %0, " #reg : "=r"(_val)); \
+        _val;                                           \
+    })
+
+#define SYSREG_WRITE(reg, val) __asm__ volatile("msr " #reg ", %0" ::"r"((unsigned long)(val)))
+
+/* GICv3 cpu interface registers, by encoding so no GIC-aware assembler is needed */
+#define ICC_PMR_EL1     S3_0_C4_C6_0
+#define ICC_IAR1_EL1    S3_0_C12_C12_0
+#define ICC_EOIR1_EL1   S3_0_C12_C12_1
+#define ICC_SRE_EL1     S3_0_C12_C12_5
+#define ICC_IGRPEN1_EL1 S3_0_C12_C12_7
+
+#define XSYSREG_READ(reg)       SYSREG_READ(reg)
+#define XSYSREG_WRITE(reg, val) SYSREG_WRITE(reg, val)
+
+static inline void mmio_write32(unsigned long addr, uint32_t val)
+{
+    *(volatile uint32_t*)addr = val;
+}
+
+static inline void mmio_write8(unsigned long addr, uint8_t val)
+{
+    *(volatile uint8_t*)addr = val;
+}
+
+static inline uint32_t mmio_read32(unsigned long addr)
+{
+    return *(volatile uint32_t*)addr;
+}
+
+void arch_init(void)
+{
+    mmio_write32(GICD_BASE + GICD_CTLR, GICD_CTLR_ARE_NS | GICD_CTLR_ENA1);
+
+    mmio_write32(GICR_SGI_BASE + GICR_IGROUPR0, 1U << TIMER_VIRT_IRQ);
+    mmio_write8(GICR_SGI_BASE + GICR_IPRIORITYR + TIMER_VIRT_IRQ, 0x80);
+    mmio_write32(GICR_SGI_BASE + GICR_ISENABLER0, 1U << TIMER_VIRT_IRQ);
+
+    XSYSREG_WRITE(ICC_SRE_EL1, XSYSREG_READ(ICC_SRE_EL1) | 1);
+    __asm__ volatile("isb");
+    XSYSREG_WRITE(ICC_PMR_EL1, 0xff);
+    XSYSREG_WRITE(ICC_IGRPEN1_EL1, 1);
+    __asm__ volatile("isb");
+}
+
+void arch_putc(char c)
+{
+    while (mmio_read32(UART_BASE + UART_FR) & UART_FR_TXFF) { }
+    mmio_write32(UART_BASE + UART_DR, (uint32_t)c);
+}
+
+uint64_t arch_time(void)
+{
+    __asm__ volatile("isb" ::: "memory");
+    return SYSREG_READ(cntvct_el0);
+}
+
+uint64_t arch_time_freq(void)
+{
+    return SYSREG_READ(cntfrq_el0);
+}
+
+long arch_hypercall(unsigned long id, unsigned long arg0, unsigned long arg1, unsigned long arg2)
+{
+    register unsigned long x0 __asm__("x0") = HC_FID_BASE | id;
+    register unsigned long x1 __asm__("x1") = arg0;
+    register unsigned long x2 __asm__("x2") = arg1;
+    register unsigned long x3 __asm__("x3") = arg2;
+
+    __asm__ volatile("hvc #0"
+                     : "+r"(x0), "+r"(x1), "+r"(x2), "+r"(x3)
+                     :
+                     : "x4", "x5", "x6", "x7", "memory");
+
+    return (long)x0;
+}
+
+void arch_timer_arm(uint64_t deadline)
+{
+    SYSREG_WRITE(cntv_cval_el0, deadline);
+    SYSREG_WRITE(cntv_ctl_el0, CNTV_CTL_ENABLE);
+    __asm__ volatile("isb");
+}
+
+void arch_irq_enable(void)
+{
+    __asm__ volatile("msr daifclr, #2" ::: "memory");
+}
+
+void arch_wfi(void)
+{
+    __asm__ volatile("wfi" ::: "memory");
+}
+
+void arch_irq_handler(void)
+{
+    uint64_t now = arch_time();
+    unsigned long iar = XSYSREG_READ(ICC_IAR1_EL1);
+    unsigned long id = iar & 0xffffff;
+
+    if (id == TIMER_VIRT_IRQ) {
+        /* Drop the timer line before deactivating it */
+        SYSREG_WRITE(cntv_ctl_el0, 0);
+        __asm__ volatile("isb");
+        bench_timer_irq(now);
+    }
+
+    XSYSREG_WRITE(ICC_EOIR1_EL1, iar);
+}
@@ -0,0 +1,104 @@
+/**
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (c) Bao Project and Contributors. All rights reserved.
+ */
+
+#include <bench.h>
+
+/* QEMU virt devices, mapped 1:1 by configs/bench-qemu-riscv64-virt */
+#define UART_BASE      (0x10000000UL)
+#define UART_THR       (0x00)
+#define UART_LSR       (0x05)
+#define UART_LSR_THRE  (1U << 5)
+
+/* QEMU virt timebase-frequency */
+#define TIME_FREQ      (10000000ULL)
+
+#define SBI_EXTID_TIME (0x54494D45UL)
+#define SBI_EXTID_BAO  (0x08000ba0UL)
+
+#define SSTATUS_SIE    (1UL << 1)
+#define SIE_STIE       (1UL << 5)
+#define SCAUSE_INT     (1UL << 63)
+#define SCAUSE_STI     (5)
+
+#define CSR_READ(csr)                                    \
+    ({                                                   \
+        unsigned long _val;                              \
+        __asm__ volatile("csrr %0, " #csr : "=r"(_val)); \
+        _val;                                            \
+    })
+
+#define CSR_SET(csr, val) __asm__ volatile("csrs " #csr ", %0" ::"r"((unsigned long)(val)))
+
+static inline long sbi_ecall(unsigned long extid, unsigned long fid, unsigned long arg0,
+    unsigned long arg1, unsigned long arg2)
+{
+    register unsigned long a0 __asm__("a0") = arg0;
+    register unsigned long a1 __asm__("a1") = arg1;
+    register unsigned long a2 __asm__("a2") = arg2;
+    register unsigned long a6 __asm__("a6") = fid;
+    register unsigned long a7 __asm__("a7") = extid;
+
+    __asm__ volatile("ecall" : "+r"(a0), "+r"(a1) : "r"(a2), "r"(a6), "r"(a7) : "memory");
+
+    return (long)a0;
+}
+
+void arch_init(void)
+{
+    CSR_SET(sie, SIE_STIE);
+}
+
+void arch_putc(char c)
+{
+    while (!(*(volatile uint8_t*)(UART_BASE + UART_LSR) & UART_LSR_THRE)) { }
+    *(volatile uint8_t*)(UART_BASE + UART_THR) = (uint8_t)c;
+}
+
+uint64_t arch_time(void)
+{
+    return CSR_READ(time);
+}
+
+uint64_t arch_time_freq(void)
+{
+    return TIME_FREQ;
+}
+
+long arch_hypercall(unsigned long id, unsigned long arg0, unsigned long arg1, unsigned long arg2)
+{
+    return sbi_ecall(SBI_EXTID_BAO, id, arg0, arg1, arg2);
+}
+
+void arch_timer_arm(uint64_t deadline)
+{
+    sbi_ecall(SBI_EXTID_TIME, 0, deadline, 0, 0);
+}
+
+void arch_irq_enable(void)
+{
+    CSR_SET(sstatus, SSTATUS_SIE);
+}
+
+void arch_wfi(void)
+{
+    __asm__ volatile("wfi" ::: "memory");
+}
+
+void arch_trap_handler(void)
+{
+    uint64_t now = arch_time();
+    unsigned long scause = CSR_READ(scause);
+
+    if (scause == (SCAUSE_INT | SCAUSE_STI)) {
+        /* Setting the next event in the far future clears the pending timer interrupt */
+        sbi_ecall(SBI_EXTID_TIME, 0, UINT64_MAX, 0, 0);
+        bench_timer_irq(now);
+    } else {
+        bench_puts("BENCH error unexpected trap\n");
+        while (true) {
+            arch_wfi();
+        }
+    }
+}
@@ -0,0 +1,159 @@
+/**
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (c) Bao Project and Contributors. All rights reserved.
+ */
+
+#include <bench.h>
+
+#define BENCH_ALLOC_ALIGN (64)
+
+extern uint8_t _heap_start[];
+
+static uintptr_t bench_heap = (uintptr_t)_heap_start;
+static uint64_t bench_seed = 0x9e3779b97f4a7c15ULL;
+
+/* The compiler may emit calls to these for aggregate copies and initializations */
+void* memset(void* dst, int val, size_t num)
+{
+    uint8_t* ptr = dst;
+    while (num-- > 0) {
+        *ptr++ = (uint8_t)val;
+    }
+    return dst;
+}
+
+void* memcpy(void* dst, const void* src, size_t num)
+{
+    uint8_t* out = dst;
+    const uint8_t* in = src;
+    while (num-- > 0) {
+        *out++ = *in++;
+    }
+    return dst;
+}
+
+__attribute__((weak)) void bench_timer_irq(uint64_t now)
+{
+    (void)now;
+}
+
+void bench_puts(const char* str)
+{
+    while (*str != '\0') {
+        if (*str == '\n') {
+            arch_putc('\r');
+        }
+        arch_putc(*str++);
+    }
+}
+
+static void bench_put_u64(uint64_t value)
+{
+    char buf[21];
+    size_t i = sizeof(buf) - 1;
+
+    buf[i] = '\0';
+    do {
+        buf[--i] = (char)('0' + (value % 10));
+        value /= 10;
+    } while (value != 0);
+
+    bench_puts(&buf[i]);
+}
+
+void bench_report(const char* metric, uint64_t value)
+{
+    bench_puts("BENCH ");
+    bench_puts(bench_name);
+    bench_puts(".");
+    bench_puts(metric);
+    bench_puts(" ");
+    bench_put_u64(value);
+    bench_puts("\n");
+}
+
+static void bench_report_suffixed(const char* metric, const char* suffix, uint64_t value)
+{
+    char buf[64];
+    size_t len = 0;
+
+    for (const char* c = metric; (*c != '\0') && (len < (sizeof(buf) - 1)); c++) {
+        buf[len++] = *c;
+    }
+    for (const char* c = suffix; (*c != '\0') && (len < (sizeof(buf) - 1)); c++) {
+        buf[len++] = *c;
+    }
+    buf[len] = '\0';
+
+    bench_report(buf, value);
+}
+
+static void bench_sort(uint64_t* samples, size_t num)
+{
+    for (size_t gap = num / 2; gap > 0; gap /= 2) {
+        for (size_t i = gap; i < num; i++) {
+            uint64_t tmp = samples[i];
+            size_t j = i;
+            for (; (j >= gap) && (samples[j - gap] > tmp); j -= gap) {
+                samples[j] = samples[j - gap];
+            }
+            samples[j] = tmp;
+        }
+    }
+}
+
+/* Sorts samples in place */
+void bench_report_percentiles(const char* metric, uint64_t* samples, size_t num)
+{
+    if (num == 0) {
+        return;
+    }
+
+    bench_sort(samples, num);
+
+    bench_report_suffixed(metric, "_p50", samples[(num * 50) / 100]);
+    bench_report_suffixed(metric, "_p90", samples[(num * 90) / 100]);
+    bench_report_suffixed(metric, "_p99", samples[(num * 99) / 100]);
+    bench_report_suffixed(metric, "_max", samples[num - 1]);
+}
+
+uint64_t bench_ticks_to_ns(uint64_t ticks)
+{
+    uint64_t freq = arch_time_freq();
+    return ((ticks / freq) * 1000000000ULL) + (((ticks % freq) * 1000000000ULL) / freq);
+}
+
+uint64_t bench_rand(void)
+{
+    bench_seed ^= bench_seed << 13;
+    bench_seed ^= bench_seed >> 7;
+    bench_seed ^= bench_seed << 17;
+    return bench_seed;
+}
+
+void* bench_alloc(size_t size)
+{
+    uintptr_t ptr = (bench_heap + (BENCH_ALLOC_ALIGN - 1)) & ~(uintptr_t)(BENCH_ALLOC_ALIGN - 1);
+    bench_heap = ptr + size;
+    return (void*)ptr;
+}
+
+uint64_t bench_throttle_events(void)
+{
+    long ret = arch_hypercall(BENCH_HC_EXIT_STATS, 0, BENCH_EXIT_REASON_PMU,
+        BENCH_EXIT_STATS_COUNT);
+    return (ret < 0) ? 0 : (uint64_t)ret;
+}
+
+void bench_entry(void)
+{
+    arch_init();
+
+    bench_main();
+    bench_report("throttle_events", bench_throttle_events());
+    bench_puts("BENCH end\n");
+
+    while (true) {
+        arch_wfi();
+    }
+}
@@ -0,0 +1,54 @@
+/**
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (c) Bao Project and Contributors. All rights reserved.
+ */
+
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * Minimal runtime shared by the benchmark guests. Each probe implements bench_main() and defines
+ * bench_name; results are printed to the console as "BENCH <probe>.<metric> <value>" lines, and
+ * the run ends with "BENCH end", which bench/run.sh waits for.
+ */
+
+/* Hypervisor interface (see src/core/inc/hypercall.h and src/core/inc/exit_stats.h) */
+#define BENCH_HC_EXIT_STATS    (2)
+#define BENCH_EXIT_REASON_PMU  (6)
+#define BENCH_EXIT_STATS_COUNT (0)
+
+extern const char bench_name[];
+void bench_main(void);
+
+/* Called from the timer interrupt handler with the time the handler was entered */
+void bench_timer_irq(uint64_t now);
+
+void bench_puts(const char* str);
+void bench_report(const char* metric, uint64_t value);
+void bench_report_percentiles(const char* metric, uint64_t* samples, size_t num);
+
+uint64_t bench_ticks_to_ns(uint64_t ticks);
+uint64_t bench_rand(void);
+void* bench_alloc(size_t size);
+
+/**
+ * Number of bandwidth regulator overflow interrupts taken on behalf of this vcpu, i.e., the
+ * number of times the vcpu exhausted its budget.
+ */
+uint64_t bench_throttle_events(void);
+
+/* Implemented per architecture in common/arch/<arch> */
+void arch_init(void);
+void arch_putc(char c);
+uint64_t arch_time(void);
+uint64_t arch_time_freq(void);
+long arch_hypercall(unsigned long id, unsigned long arg0, unsigned long arg1, unsigned long arg2);
+void arch_timer_arm(uint64_t deadline);
+void arch_irq_enable(void);
+void arch_wfi(void);
+
+#endif /* __BENCH_H__ */
@@ -0,0 +1,37 @@
+/**
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (c) Bao Project and Contributors. All rights reserved.
+ */
+
+#include <bench.h>
+
+/**
+ * Hypercall round-trip probe: times batches of a cheap hypercall (an exit statistics read) to
+ * measure the cost of a guest exit and return. Batching keeps the result above the resolution of
+ * the guest timer.
+ */
+
+#ifndef HYPERCALL_SAMPLES
+#define HYPERCALL_SAMPLES (1024)
+#endif
+
+#ifndef HYPERCALL_BATCH
+#define HYPERCALL_BATCH (16)
+#endif
+
+const char bench_name[] = "hypercall";
+
+void bench_main(void)
+{
+    static uint64_t samples[HYPERCALL_SAMPLES];
+
+    for (size_t i = 0; i < HYPERCALL_SAMPLES; i++) {
+        uint64_t start = arch_time();
+        for (size_t j = 0; j < HYPERCALL_BATCH; j++) {
+            arch_hypercall(BENCH_HC_EXIT_STATS, 0, BENCH_EXIT_REASON_PMU, BENCH_EXIT_STATS_COUNT);
+        }
+        samples[i] = bench_ticks_to_ns(arch_time() - start) / HYPERCALL_BATCH;
+    }
+
+    bench_report_percentiles("roundtrip_ns", samples, HYPERCALL_SAMPLES);
+}
@@ -0,0 +1,55 @@
+/**
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (c) Bao Project and Contributors. All rights reserved.
+ */
+
+#include <bench.h>
+
+/**
+ * IRQ latency probe: arms the guest timer for a known deadline and measures how late its
+ * interrupt handler runs. On Arm the virtual timer interrupt is a hardware interrupt forwarded
+ * through the vGIC; on RISC-V the timer is programmed through SBI and the interrupt injected by
+ * the hypervisor. A random delay keeps deadlines from phase-locking with the regulation period.
+ */
+
+#ifndef IRQLAT_SAMPLES
+#define IRQLAT_SAMPLES (512)
+#endif
+
+#ifndef IRQLAT_DELAY_US
+#define IRQLAT_DELAY_US (100)
+#endif
+
+const char bench_name[] = "irqlat";
+
+static volatile bool irqlat_fired;
+static volatile uint64_t irqlat_time;
+
+void bench_timer_irq(uint64_t now)
+{
+    irqlat_time = now;
+    irqlat_fired = true;
+}
+
+void bench_main(void)
+{
+    static uint64_t samples[IRQLAT_SAMPLES];
+    uint64_t delay = (arch_time_freq() * IRQLAT_DELAY_US) / 1000000;
+
+    arch_irq_enable();
+
+    for (size_t i = 0; i < IRQLAT_SAMPLES; i++) {
+        uint64_t deadline = arch_time() + delay + (bench_rand() % delay);
+
+        irqlat_fired = false;
+        arch_timer_arm(deadline);
+        while (!irqlat_fired) {
+            arch_wfi();
+        }
+
+        uint64_t late = (irqlat_time > deadline) ? (irqlat_time - deadline) : 0;
+        samples[i] = bench_ticks_to_ns(late);
+    }
+
+    bench_report_percentiles("timer_irq_ns", samples, IRQLAT_SAMPLES);
+}
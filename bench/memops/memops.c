@@ -0,0 +1,158 @@
+/**
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (c) Bao Project and Contributors. All rights reserved.
+ */
+
+#include <bench.h>
+
+/**
+ * Hypervisor memcpy and memset microbenchmark. The generic versions in src/lib/string.c and the
+ * architecture's optimized ones are both built into this probe under other names (see
+ * bench/Makefile). Each is timed over a range of sizes, reporting the bytes written per
+ * microsecond, and the optimized versions are first checked against the generic ones for every
+ * size and alignment up to a few cache lines.
+ */
+
+#ifndef MEMOPS_BYTES
+#define MEMOPS_BYTES (16UL * 1024 * 1024)
+#endif
+
+#define MEMOPS_MAX_SIZE  (1024UL * 1024)
+#define MEMOPS_CHECK_MAX (256)
+
+void* memcpy_generic(void* dst, const void* src, size_t count);
+void* memset_generic(void* dest, int c, size_t count);
+void* memcpy_arch(void* dst, const void* src, size_t count);
+void* memset_arch(void* dest, int c, size_t count);
+
+struct memops_size {
+    size_t size;
+    const char* name;
+};
+
+static const struct memops_size memops_sizes[] = {
+    { 64, "64" },
+    { 512, "512" },
+    { 4096, "4k" },
+    { 65536, "64k" },
+    { MEMOPS_MAX_SIZE, "1m" },
+};
+
+const char bench_name[] = "memops";
+
+static uint8_t* memops_dst;
+static uint8_t* memops_ref;
+static uint8_t* memops_src;
+
+static void memops_metric(char* buf, size_t len, const char* const* parts, size_t num)
+{
+    size_t i = 0;
+
+    for (size_t p = 0; p < num; p++) {
+        for (const char* c = parts[p]; (*c != '\0') && (i < (len - 1)); c++) {
+            buf[i++] = *c;
+        }
+    }
+    buf[i] = '\0';
+}
+
+static void memops_fill(uint8_t* buf, size_t size)
+{
+    for (size_t i = 0; i < size; i += sizeof(uint64_t)) {
+        *(uint64_t*)&buf[i] = bench_rand();
+    }
+}
+
+static bool memops_equal(const uint8_t* a, const uint8_t* b, size_t size)
+{
+    for (size_t i = 0; i < size; i++) {
+        if (a[i] != b[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Both versions over every size and destination and source offset within a word and beyond */
+static uint64_t memops_check(void)
+{
+    size_t span = MEMOPS_CHECK_MAX + 64;
+    uint64_t errors = 0;
+
+    for (size_t size = 0; size <= MEMOPS_CHECK_MAX; size++) {
+        for (size_t dst_off = 0; dst_off < 16; dst_off++) {
+            for (size_t src_off = 0; src_off < 16; src_off++) {
+                memops_fill(memops_dst, span);
+                memcpy_generic(memops_ref, memops_dst, span);
+                memops_fill(memops_src, span);
+
+                memcpy_generic(&memops_ref[dst_off], &memops_src[src_off], size);
+                memcpy_arch(&memops_dst[dst_off], &memops_src[src_off], size);
+                errors += memops_equal(memops_dst, memops_ref, span) ? 0 : 1;
+            }
+
+            int val = (size & 1) ? (int)(size + dst_off) : 0;
+            memset_generic(&memops_ref[dst_off], val, size);
+            memset_arch(&memops_dst[dst_off], val, size);
+            errors += memops_equal(memops_dst, memops_ref, span) ? 0 : 1;
+        }
+    }
+
+    /* Large zero fills take the block zeroing path, if any */
+    memops_fill(memops_dst, MEMOPS_MAX_SIZE + 64);
+    memcpy_generic(memops_ref, memops_dst, MEMOPS_MAX_SIZE + 64);
+    memset_generic(&memops_ref[8], 0, MEMOPS_MAX_SIZE - 8);
+    memset_arch(&memops_dst[8], 0, MEMOPS_MAX_SIZE - 8);
+    errors += memops_equal(memops_dst, memops_ref, MEMOPS_MAX_SIZE + 64) ? 0 : 1;
+
+    return errors;
+}
+
+enum memops_op { MEMOPS_COPY, MEMOPS_ZERO, MEMOPS_SET };
+
+/* Bytes written per microsecond, i.e., MB/s */
+static uint64_t memops_time(enum memops_op op, bool arch, size_t size)
+{
+    size_t iterations = (MEMOPS_BYTES / size) + 1;
+    uint64_t start = arch_time();
+
+    for (size_t i = 0; i < iterations; i++) {
+        switch (op) {
+            case MEMOPS_COPY:
+                (arch ? memcpy_arch : memcpy_generic)(memops_dst, memops_src, size);
+                break;
+            case MEMOPS_ZERO:
+                (arch ? memset_arch : memset_generic)(memops_dst, 0, size);
+                break;
+            case MEMOPS_SET:
+                (arch ? memset_arch : memset_generic)(memops_dst, 0x5a, size);
+                break;
+        }
+    }
+
+    uint64_t ns = bench_ticks_to_ns(arch_time() - start);
+    return ((iterations * size) * 1000) / ((ns != 0) ? ns : 1);
+}
+
+void bench_main(void)
+{
+    static const char* const op_names[] = { "memcpy_", "memzero_", "memset_" };
+    char metric[48];
+
+    memops_dst = bench_alloc(MEMOPS_MAX_SIZE + 64);
+    memops_ref = bench_alloc(MEMOPS_MAX_SIZE + 64);
+    memops_src = bench_alloc(MEMOPS_MAX_SIZE + 64);
+
+    bench_report("errors", memops_check());
+
+    for (size_t op = MEMOPS_COPY; op <= MEMOPS_SET; op++) {
+        for (size_t i = 0; i < (sizeof(memops_sizes) / sizeof(memops_sizes[0])); i++) {
+            for (size_t arch = 0; arch < 2; arch++) {
+                const char* parts[] = { op_names[op], memops_sizes[i].name,
+                    arch ? "_arch_mbps" : "_generic_mbps" };
+                memops_metric(metric, sizeof(metric), parts, 3);
+                bench_report(metric, memops_time(op, arch != 0, memops_sizes[i].size));
+            }
+        }
+    }
+}
@@ -0,0 +1,143 @@
+#!/bin/bash
+## SPDX-License-Identifier: Apache-2.0
+## Copyright (c) Bao Project and Contributors. All rights reserved.
+
+# Boots each benchmark guest on top of the hypervisor under QEMU and compares the results with the
+# stored baseline in bench/baseline/<platform>.txt.
+#
+#   bench/run.sh [platform...]    (default: qemu-aarch64-virt)
+#
+# qemu-riscv64-virt is only run when asked for, as the RISC-V port has no events (PMU) backend
+# and does not build yet.
+#
+# Environment:
+#   BENCH_PROBES      probes to run (default: stream chase irqlat hypercall memops)
+#   BENCH_TIMEOUT     seconds to wait for each probe to finish (default: 300)
+#   BENCH_TOLERANCE   regression threshold in percent (default: 10)
+#   BENCH_SAVE=y      store the results as the new baseline instead of comparing
+#   CROSS_COMPILE_AARCH64, CROSS_COMPILE_RISCV64, QEMU_AARCH64, QEMU_RISCV64
+
+set -o pipefail
+
+root_dir=$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)
+bench_dir=$root_dir/bench
+baseline_dir=$bench_dir/baseline
+results_dir=$bench_dir/build/results
+
+platforms=${*:-qemu-aarch64-virt}
+probes=${BENCH_PROBES:-stream chase irqlat hypercall memops}
+timeout=${BENCH_TIMEOUT:-300}
+tolerance=${BENCH_TOLERANCE:-10}
+
+status=0
+
+# Boot the hypervisor image and wait for the guest to print "BENCH end"
+run_qemu() {
+    local log=$1
+    shift
+
+    "$@" > "$log" 2>&1 < /dev/null &
+    local pid=$!
+
+    for ((t = 0; t < timeout; t++)); do
+        if grep -q "BENCH end" "$log" || ! kill -0 $pid 2> /dev/null; then
+            break
+        fi
+        sleep 1
+    done
+
+    kill $pid 2> /dev/null
+    wait $pid 2> /dev/null
+
+    grep -q "BENCH end" "$log"
+}
+
+# Higher is better for bandwidths; throttle counts are informational; lower is better otherwise
+compare() {
+    local results=$1
+    local baseline=$2
+
+    awk -v tolerance="$tolerance" '
+        NR == FNR { base[$1] = $2; next }
+        BEGIN { printf "%-36s %14s %14s %9s\n", "metric", "value", "baseline", "delta" }
+        {
+            if (!($1 in base)) {
+                printf "%-36s %14s %14s %9s\n", $1, $2, "-", "-"
+                next
+            }
+            delta = (base[$1] == 0) ? 0 : (($2 - base[$1]) * 100.0) / base[$1]
+            worse = ($1 ~ /mbps/) ? -delta : delta
+            flag = ""
+            if ($1 !~ /throttle_events/ && worse > tolerance) {
+                flag = "  REGRESSION"
+                regressions++
+            }
+            printf "%-36s %14s %14s %+8.1f%%%s\n", $1, $2, base[$1], delta, flag
+        }
+        END { exit (regressions > 0) }
+    ' "$baseline" "$results"
+}
+
+for platform in $platforms; do
+    case $platform in
+        qemu-aarch64-virt)
+            arch=aarch64
+            cross=${CROSS_COMPILE_AARCH64:-aarch64-none-elf-}
+            qemu=(${QEMU_AARCH64:-qemu-system-aarch64} -nographic
+                -M virt,virtualization=on,gic-version=3 -cpu cortex-a53 -smp 4 -m 4G)
+            ;;
+        qemu-riscv64-virt)
+            arch=riscv64
+            cross=${CROSS_COMPILE_RISCV64:-riscv64-unknown-elf-}
+            qemu=(${QEMU_RISCV64:-qemu-system-riscv64} -nographic
+                -M virt -cpu rv64,h=true -smp 4 -m 4G -bios default)
+            ;;
+        *)
+            echo "error: no benchmark configuration for platform $platform"
+            status=1
+            continue
+            ;;
+    esac
+
+    config=bench-$platform
+    bao=$root_dir/bin/$platform/$config/bao.bin
+    results=$results_dir/$platform.txt
+
+    echo "Benchmarking $platform"
+
+    mkdir -p "$results_dir"
+    : > "$results"
+
+    make -s -C "$bench_dir" ARCH=$arch CROSS_COMPILE=$cross PROBES="$probes" || exit 1
+    make -s -C "$root_dir" PLATFORM=$platform CONFIG=$config clean > /dev/null
+
+    for probe in $probes; do
+        log=$results_dir/$platform-$probe.log
+
+        # The configuration embeds bench/build/<arch>/guest.bin
+        cp "$bench_dir/build/$arch/$probe.bin" "$bench_dir/build/$arch/guest.bin"
+        make -s -C "$root_dir" PLATFORM=$platform CONFIG=$config CROSS_COMPILE=$cross || exit 1
+
+        if ! run_qemu "$log" "${qemu[@]}" -kernel "$bao"; then
+            echo "error: $probe did not complete on $platform (see $log)"
+            status=1
+        fi
+
+        tr -d '\r' < "$log" | awk -v probe="$probe" '$1 == "BENCH" && index($2, probe ".") == 1 {
+            print $2, $3 }' >> "$results"
+    done
+
+    if [ "$BENCH_SAVE" = "y" ]; then
+        mkdir -p "$baseline_dir"
+        cp "$results" "$baseline_dir/$platform.txt"
+        echo "Baseline for $platform saved to bench/baseline/$platform.txt"
+        cat "$results"
+    elif [ -f "$baseline_dir/$platform.txt" ]; then
+        compare "$results" "$baseline_dir/$platform.txt" || status=1
+    else
+        echo "No baseline for $platform; run with BENCH_SAVE=y to record one"
+        cat "$results"
+    fi
+done
+
+exit $status
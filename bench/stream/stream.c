@@ -0,0 +1,55 @@
+/**
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (c) Bao Project and Contributors. All rights reserved.
+ */
+
+#include <bench.h>
+
+/**
+ * Memory bandwidth streamer: copies a buffer much larger than the last level cache and reports
+ * the bandwidth achieved on each pass, counting both the bytes read and written.
+ */
+
+#ifndef STREAM_SIZE
+#define STREAM_SIZE (8UL * 1024 * 1024)
+#endif
+
+#ifndef STREAM_ITERATIONS
+#define STREAM_ITERATIONS (32)
+#endif
+
+const char bench_name[] = "stream";
+
+static void stream_copy(uint64_t* dst, const uint64_t* src, size_t words)
+{
+    for (size_t i = 0; i < words; i++) {
+        dst[i] = src[i];
+    }
+}
+
+void bench_main(void)
+{
+    size_t words = STREAM_SIZE / sizeof(uint64_t);
+    uint64_t* src = bench_alloc(STREAM_SIZE);
+    uint64_t* dst = bench_alloc(STREAM_SIZE);
+    uint64_t samples[STREAM_ITERATIONS];
+    uint64_t total = 0;
+
+    for (size_t i = 0; i < words; i++) {
+        src[i] = i;
+        dst[i] = 0;
+    }
+
+    for (size_t i = 0; i < STREAM_ITERATIONS; i++) {
+        uint64_t start = arch_time();
+        stream_copy(dst, src, words);
+        uint64_t ns = bench_ticks_to_ns(arch_time() - start);
+
+        /* bytes per microsecond is MB/s */
+        samples[i] = ((2 * STREAM_SIZE) * 1000) / ((ns != 0) ? ns : 1);
+        total += samples[i];
+    }
+
+    bench_report("copy_mbps", total / STREAM_ITERATIONS);
+    bench_report_percentiles("copy_mbps", samples, STREAM_ITERATIONS);
+}
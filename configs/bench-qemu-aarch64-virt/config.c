@@ -0,0 +1,80 @@
+/**
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (c) Bao Project and Contributors. All rights reserved.
+ */
+
+#include <config.h>
+
+/**
+ * Benchmark configuration for qemu-aarch64-virt: a single-vcpu regulated VM running one of the
+ * bench/ guest images, which bench/run.sh copies to BENCH_IMAGE before building. The UART is
+ * shared with the hypervisor console and the virtual timer interrupt is passed through.
+ */
+
+#ifndef BENCH_IMAGE
+#define BENCH_IMAGE "bench/build/aarch64/guest.bin"
+#endif
+
+#ifndef BENCH_PERIOD_US
+#define BENCH_PERIOD_US (1000)
+#endif
+
+/* Bus accesses per period; zero leaves the VM unregulated */
+#ifndef BENCH_BUDGET
+#define BENCH_BUDGET (100000)
+#endif
+
+VM_IMAGE(bench, BENCH_IMAGE);
+
+struct config config = {
+
+    .vmlist_size = 1,
+    .vmlist = (struct vm_config[]) {
+        {
+            .image = VM_IMAGE_BUILTIN(bench, 0x40000000),
+
+            .entry = 0x40000000,
+            .cpu_affinity = 0x1,
+
+            .mem_throth = {
+                .period_us = BENCH_PERIOD_US,
+                .vm_budget = BENCH_BUDGET,
+                .cpu_num_tickets = (uint64_t[]) {100},
+            },
+
+            .platform = {
+                .cpu_num = 1,
+
+                .region_num = 1,
+                .regions = (struct vm_mem_region[]) {
+                    {
+                        .base = 0x40000000,
+                        .size = 0x8000000,
+                    },
+                },
+
+                .dev_num = 2,
+                .devs = (struct vm_dev_region[]) {
+                    {
+                        /* PL011 */
+                        .pa = 0x09000000,
+                        .va = 0x09000000,
+                        .size = 0x1000,
+                    },
+                    {
+                        /* Virtual timer */
+                        .interrupt_num = 1,
+                        .interrupts = (irqid_t[]) {27},
+                    },
+                },
+
+                .arch = {
+                    .gic = {
+                        .gicd_addr = 0x08000000,
+                        .gicr_addr = 0x080A0000,
+                    },
+                },
+            },
+        },
+    },
+};
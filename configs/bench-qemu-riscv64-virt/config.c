@@ -0,0 +1,72 @@
+/**
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (c) Bao Project and Contributors. All rights reserved.
+ */
+
+#include <config.h>
+
+/**
+ * Benchmark configuration for qemu-riscv64-virt: a single-vcpu VM running one of the bench/ guest
+ * images, which bench/run.sh copies to BENCH_IMAGE before building. The guest drives the UART
+ * directly and programs its timer through SBI.
+ */
+
+#ifndef BENCH_IMAGE
+#define BENCH_IMAGE "bench/build/riscv64/guest.bin"
+#endif
+
+#ifndef BENCH_PERIOD_US
+#define BENCH_PERIOD_US (1000)
+#endif
+
+/* Bus accesses per period; zero leaves the VM unregulated */
+#ifndef BENCH_BUDGET
+#define BENCH_BUDGET (0)
+#endif
+
+VM_IMAGE(bench, BENCH_IMAGE);
+
+struct config config = {
+
+    .vmlist_size = 1,
+    .vmlist = (struct vm_config[]) {
+        {
+            .image = VM_IMAGE_BUILTIN(bench, 0x80000000),
+
+            .entry = 0x80000000,
+            .cpu_affinity = 0x1,
+
+            .mem_throth = {
+                .period_us = BENCH_PERIOD_US,
+                .vm_budget = BENCH_BUDGET,
+                .cpu_num_tickets = (uint64_t[]) {100},
+            },
+
+            .platform = {
+                .cpu_num = 1,
+
+                .region_num = 1,
+                .regions = (struct vm_mem_region[]) {
+                    {
+                        .base = 0x80000000,
+                        .size = 0x8000000,
+                    },
+                },
+
+                .dev_num = 1,
+                .devs = (struct vm_dev_region[]) {
+                    {
+                        /* NS16550 */
+                        .pa = 0x10000000,
+                        .va = 0x10000000,
+                        .size = 0x1000,
+                    },
+                },
+
+                .arch = {
+                    .irqc.plic.base = 0xc000000,
+                },
+            },
+        },
+    },
+};
@@ -165,6 +165,11 @@ static inline void arm_tlbi_vmalls12e1is()
     __asm__ volatile("mcr p15, 0, r0, c8, c7, 0");
 }
 
+static inline void arm_tlbi_vmalle1is()
+{
+    __asm__ volatile("mcr p15, 0, r0, c8, c3, 0"); // tlbiallis
+}
+
 static inline void arm_tlbi_vae2is(vaddr_t vaddr)
 {
     __asm__ volatile("mcr p15, 4, %0, c8, c7, 1" ::"r"(vaddr));
@@ -175,6 +180,26 @@ static inline void arm_tlbi_ipas2e1is(vaddr_t vaddr)
     __asm__ volatile("mcr p15, 4, %0, c8, c0, 1" ::"r"(vaddr >> 12));
 }
 
+/* AArch32 has no range invalidations, so the ones below are never issued */
+static inline bool arm_tlbi_range_supported()
+{
+    return false;
+}
+
+static inline void arm_tlbi_rvae2is(vaddr_t vaddr, size_t scale, size_t num)
+{
+    UNUSED_ARG(vaddr);
+    UNUSED_ARG(scale);
+    UNUSED_ARG(num);
+}
+
+static inline void arm_tlbi_ripas2e1is(vaddr_t vaddr, size_t scale, size_t num)
+{
+    UNUSED_ARG(vaddr);
+    UNUSED_ARG(scale);
+    UNUSED_ARG(num);
+}
+
 #endif /* |__ASSEMBLER__ */
 
 #endif /* ARCH_PROFILE_SYSREGS_H */
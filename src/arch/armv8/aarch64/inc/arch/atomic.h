@@ -0,0 +1,80 @@
+/**
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (c) Bao Project and Contributors. All rights reserved.
+ */
+
+#ifndef __ARCH_ATOMIC_H__
+#define __ARCH_ATOMIC_H__
+
+#include <bao.h>
+
+static inline uint32_t atomic_load_acquire(volatile uint32_t* ptr)
+{
+    uint32_t val;
+
+    __asm__ volatile("ldar   %w0, %1\n\t" : "=r"(val) : "Q"(*ptr) : "memory");
+
+    return val;
+}
+
+static inline void atomic_store_release(volatile uint32_t* ptr, uint32_t val)
+{
+    __asm__ volatile("stlr   %w1, %0\n\t" : "=Q"(*ptr) : "r"(val) : "memory");
+}
+
+static inline uint32_t atomic_cmpxchg(volatile uint32_t* ptr, uint32_t expected, uint32_t desired)
+{
+    uint32_t val;
+    uint32_t temp;
+
+    __asm__ volatile(
+        "1:\n\t"
+        "ldaxr  %w0, %2\n\t"
+        "cmp    %w0, %w3\n\t"
+        "b.ne   2f\n\t"
+        "stlxr  %w1, %w4, %2\n\t"
+        "cbnz   %w1, 1b\n\t"
+        "b      3f\n\t"
+        /* Release the exclusive monitor on a failed comparison */
+        "2:\n\t"
+        "clrex\n\t"
+        "3:\n\t" : "=&r"(val), "=&r"(temp), "+Q"(*ptr) : "r"(expected), "r"(desired)
+        : "cc", "memory");
+
+    return val;
+}
+
+static inline uint32_t atomic_fetch_add(volatile uint32_t* ptr, uint32_t val)
+{
+    uint32_t old;
+    uint32_t new;
+    uint32_t temp;
+
+    __asm__ volatile(
+        "1:\n\t"
+        "ldaxr  %w0, %3\n\t"
+        "add    %w1, %w0, %w4\n\t"
+        "stlxr  %w2, %w1, %3\n\t"
+        "cbnz   %w2, 1b\n\t" : "=&r"(old), "=&r"(new), "=&r"(temp), "+Q"(*ptr) : "r"(val)
+        : "memory");
+
+    return old;
+}
+
+/**
+ * Loading with ldaxr arms the exclusive monitor: a write to *ptr by another cpu clears it, which
+ * is a wake-up event for wfe, so no explicit sev is needed to wake the waiter.
+ */
+static inline void atomic_wait_while_eq(volatile uint32_t* ptr, uint32_t val)
+{
+    uint32_t temp;
+
+    __asm__ volatile(
+        "ldaxr  %w0, %1\n\t"
+        "cmp    %w0, %w2\n\t"
+        "b.ne   1f\n\t"
+        "wfe\n\t"
+        "1:\n\t" : "=&r"(temp) : "Q"(*ptr), "r"(val) : "cc", "memory");
+}
+
+#endif /* __ARCH_ATOMIC_H__ */
@@ -44,6 +44,19 @@
 #define ich_lr14_el2    S3_4_C12_C13_6
 #define ich_lr15_el2    S3_4_C12_C13_7
 
+/* ID_AA64ISAR0_EL1, AArch64 Instruction Set Attribute Register 0 */
+#define ID_AA64ISAR0_TLB_OFF      56
+#define ID_AA64ISAR0_TLB_LEN      4
+#define ID_AA64ISAR0_TLB_RANGE    (2)
+
+/* TLBI range operations argument, see TLBI_RANGE_NUM_MAX */
+#define TLBI_RANGE_BADDR_OFF      0
+#define TLBI_RANGE_BADDR_LEN      37
+#define TLBI_RANGE_BADDR_MSK      BIT64_MASK(TLBI_RANGE_BADDR_OFF, TLBI_RANGE_BADDR_LEN)
+#define TLBI_RANGE_NUM_OFF        39
+#define TLBI_RANGE_SCALE_OFF      44
+#define TLBI_RANGE_TG_4K          (1ULL << 46)
+
 #ifndef __ASSEMBLER__
 
 #define SYSREG_GEN_ACCESSORS_NAME(reg, name)                          \
@@ -85,6 +98,7 @@ SYSREG_GEN_ACCESSORS(hcr_el2)
 SYSREG_GEN_ACCESSORS(vtcr_el2)
 SYSREG_GEN_ACCESSORS(vttbr_el2)
 SYSREG_GEN_ACCESSORS(id_aa64mmfr0_el1)
+SYSREG_GEN_ACCESSORS(id_aa64isar0_el1)
 SYSREG_GEN_ACCESSORS(tpidr_el2)
 SYSREG_GEN_ACCESSORS(vsctlr_el2)
 SYSREG_GEN_ACCESSORS(mpuir_el2)
@@ -124,6 +138,8 @@ SYSREG_GEN_ACCESSORS(ich_lr14_el2)
 SYSREG_GEN_ACCESSORS(ich_lr15_el2)
 SYSREG_GEN_ACCESSORS(cnthp_ctl_el2);
 SYSREG_GEN_ACCESSORS(cnthp_tval_el2);
+SYSREG_GEN_ACCESSORS(cnthp_cval_el2);
+SYSREG_GEN_ACCESSORS(cntpct_el0);
 SYSREG_GEN_ACCESSORS(mdcr_el2);
 SYSREG_GEN_ACCESSORS(pmcntenclr_el0);
 SYSREG_GEN_ACCESSORS(pmcntenset_el0);
@@ -133,6 +149,12 @@ SYSREG_GEN_ACCESSORS(pmxevtyper_el0);
 SYSREG_GEN_ACCESSORS(pmintenset_el1);
 SYSREG_GEN_ACCESSORS(pmintenclr_el1);
 SYSREG_GEN_ACCESSORS(pmovsclr_el0);
+SYSREG_GEN_ACCESSORS(pmovsset_el0);
+SYSREG_GEN_ACCESSORS(pmccntr_el0);
+SYSREG_GEN_ACCESSORS(pmccfiltr_el0);
+SYSREG_GEN_ACCESSORS(pmceid0_el0);
+SYSREG_GEN_ACCESSORS(pmceid1_el0);
+SYSREG_GEN_ACCESSORS(pmuserenr_el0);
 
 static inline void arm_dc_civac(vaddr_t cache_addr)
 {
@@ -159,6 +181,11 @@ static inline void arm_tlbi_vmalls12e1is()
     __asm__ volatile("tlbi vmalls12e1is");
 }
 
+static inline void arm_tlbi_vmalle1is()
+{
+    __asm__ volatile("tlbi vmalle1is");
+}
+
 static inline void arm_tlbi_vae2is(vaddr_t vaddr)
 {
     __asm__ volatile("tlbi vae2is, %0" ::"r"(vaddr >> 12));
@@ -169,6 +196,35 @@ static inline void arm_tlbi_ipas2e1is(vaddr_t vaddr)
     __asm__ volatile("tlbi ipas2e1is, %0" ::"r"(vaddr >> 12));
 }
 
+/* FEAT_TLBIRANGE, i.e., the TLBI R* operations, present since Armv8.4 */
+static inline bool arm_tlbi_range_supported()
+{
+    return bit64_extract(sysreg_id_aa64isar0_el1_read(), ID_AA64ISAR0_TLB_OFF,
+               ID_AA64ISAR0_TLB_LEN) >= ID_AA64ISAR0_TLB_RANGE;
+}
+
+/**
+ * Range operations cover (num + 1) << (5 * scale + 1) pages from vaddr. They are issued with their
+ * sys encodings, so no assembler support for Armv8.4 is required.
+ */
+static inline uint64_t arm_tlbi_range_arg(vaddr_t vaddr, size_t scale, size_t num)
+{
+    return TLBI_RANGE_TG_4K | ((uint64_t)scale << TLBI_RANGE_SCALE_OFF) |
+        ((uint64_t)num << TLBI_RANGE_NUM_OFF) | ((vaddr >> 12) & TLBI_RANGE_BADDR_MSK);
+}
+
+static inline void arm_tlbi_rvae2is(vaddr_t vaddr, size_t scale, size_t num)
+{
+    /* tlbi rvae2is */
+    __asm__ volatile("sys #4, c8, c2, #1, %0" ::"r"(arm_tlbi_range_arg(vaddr, scale, num)));
+}
+
+static inline void arm_tlbi_ripas2e1is(vaddr_t vaddr, size_t scale, size_t num)
+{
+    /* tlbi ripas2e1is */
+    __asm__ volatile("sys #4, c8, c0, #2, %0" ::"r"(arm_tlbi_range_arg(vaddr, scale, num)));
+}
+
 #endif /* |__ASSEMBLER__ */
 
 #endif /* __ARCH_SYSREGS_H__ */
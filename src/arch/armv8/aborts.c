@@ -11,6 +11,7 @@
 #include <emul.h>
 #include <config.h>
 #include <hypercall.h>
+#include <trace.h>
 
 typedef void (*abort_handler_t)(unsigned long, unsigned long, unsigned long, unsigned long);
 
@@ -19,19 +20,26 @@ static void aborts_data_lower(unsigned long iss, unsigned long far, unsigned lon
 {
     UNUSED_ARG(ec);
 
+    unsigned long DSFC = bit_extract(iss, ESR_ISS_DA_DSFC_OFF, ESR_ISS_DA_DSFC_LEN) & (0xf << 2);
+
+    /* First accesses to lazily mapped memory, including by the guest's page table walks */
+    if ((DSFC == ESR_ISS_DA_DSFC_TRNSLT) && vm_mem_fault(cpu()->vcpu->vm, far)) {
+        return;
+    }
+
     if (!(iss & ESR_ISS_DA_ISV_BIT) || (iss & ESR_ISS_DA_FnV_BIT)) {
         ERROR("no information to handle data abort (0x%x)", far);
     }
 
-    unsigned long DSFC = bit_extract(iss, ESR_ISS_DA_DSFC_OFF, ESR_ISS_DA_DSFC_LEN) & (0xf << 2);
-
     if (DSFC != ESR_ISS_DA_DSFC_TRNSLT && DSFC != ESR_ISS_DA_DSFC_PERMIS) {
         ERROR("data abort is not translation fault - cant deal with it");
     }
 
     vaddr_t addr = far;
-    emul_handler_t handler = vm_emul_get_mem(cpu()->vcpu->vm, addr);
-    if (handler != NULL) {
+    struct emul_mem* emu = vm_emul_get_mem_region(cpu()->vcpu->vm, addr);
+    if (emu != NULL) {
+        emul_handler_t handler = emu->handler;
+        exit_stats_classify(EXIT_REASON_MMIO, emu->va_base);
         struct emul_access emul;
         emul.addr = addr;
         emul.width = (1U << bit_extract(iss, ESR_ISS_DA_SAS_OFF, ESR_ISS_DA_SAS_LEN));
@@ -43,6 +51,7 @@ static void aborts_data_lower(unsigned long iss, unsigned long far, unsigned lon
         // TODO: check if the access is aligned. If not, inject an exception in the vm
 
         if (handler(&emul)) {
+            TRACE_EVENT(MMIO, TRACE_MMIO, emul.write, addr, vcpu_readreg(cpu()->vcpu, emul.reg));
             unsigned long pc_step = 2 + (2 * il);
             vcpu_writepc(cpu()->vcpu, vcpu_readpc(cpu()->vcpu) + pc_step);
         } else {
@@ -53,6 +62,19 @@ static void aborts_data_lower(unsigned long iss, unsigned long far, unsigned lon
     }
 }
 
+static void aborts_inst_lower(unsigned long iss, unsigned long far, unsigned long il,
+    unsigned long ec)
+{
+    UNUSED_ARG(il);
+    UNUSED_ARG(ec);
+
+    unsigned long IFSC = bit_extract(iss, ESR_ISS_DA_DSFC_OFF, ESR_ISS_DA_DSFC_LEN) & (0xf << 2);
+
+    if ((IFSC != ESR_ISS_DA_DSFC_TRNSLT) || !vm_mem_fault(cpu()->vcpu->vm, far)) {
+        ERROR("no handler for instruction abort (0x%x at 0x%x)", far, vcpu_readpc(cpu()->vcpu));
+    }
+}
+
 static long int standard_service_call(unsigned long _fn_num)
 {
     UNUSED_ARG(_fn_num);
@@ -79,10 +101,13 @@ static inline void syscall_handler(unsigned long iss, unsigned long far, unsigne
     UNUSED_ARG(iss);
     UNUSED_ARG(far);
     UNUSED_ARG(il);
-    UNUSED_ARG(ec);
 
     unsigned long fid = vcpu_readreg(cpu()->vcpu, 0);
 
+    enum exit_reason reason =
+        ((ec == ESR_EC_SMC32) || (ec == ESR_EC_SMC64)) ? EXIT_REASON_SMC : EXIT_REASON_HVC;
+    exit_stats_classify(reason, fid);
+
     long ret = SMCC_E_NOT_SUPPORTED;
     switch (fid & ~SMCC_FID_FN_NUM_MSK) {
         case SMCC32_FID_STD_SRVC:
@@ -140,6 +165,8 @@ static void sysreg_handler(unsigned long iss, unsigned long far, unsigned long i
         reg_addr = (iss & ESR_ISS_SYSREG_ADDR_32) | OP0_MRS_CP15;
     }
 
+    exit_stats_classify(EXIT_REASON_SYSREG, reg_addr);
+
     emul_handler_t handler = vm_emul_get_reg(cpu()->vcpu->vm, reg_addr);
     if (handler != NULL) {
         struct emul_access emul;
@@ -165,6 +192,7 @@ static void sysreg_handler(unsigned long iss, unsigned long far, unsigned long i
 }
 
 abort_handler_t abort_handlers[64] = {
+    [ESR_EC_IALEL] = aborts_inst_lower,
     [ESR_EC_DALEL] = aborts_data_lower,
     [ESR_EC_SMC32] = smc_handler,
     [ESR_EC_SMC64] = smc_handler,
@@ -177,6 +205,11 @@ abort_handler_t abort_handlers[64] = {
 
 void aborts_sync_handler(void)
 {
+    exit_stats_begin();
+    if (DEFINED(IRQ_LATENCY)) {
+        vgic_irq_lat_poll(cpu()->vcpu);
+    }
+
     unsigned long esr = sysreg_esr_el2_read();
     unsigned long far = sysreg_far_el2_read();
     unsigned long hpfar = sysreg_hpfar_el2_read();
@@ -192,10 +225,14 @@ void aborts_sync_handler(void)
     unsigned long il = bit_extract(esr, ESR_IL_OFF, ESR_IL_LEN);
     unsigned long iss = bit_extract(esr, ESR_ISS_OFF, ESR_ISS_LEN);
 
+    TRACE_EVENT(EXIT, TRACE_VM_EXIT, ec, iss, ipa_fault_addr);
+
     abort_handler_t handler = abort_handlers[ec];
     if (handler) {
         handler(iss, ipa_fault_addr, il, ec);
     } else {
         ERROR("no handler for abort ec = 0x%x", ec); // unknown guest exception
     }
+
+    exit_stats_end();
 }
@@ -154,6 +154,12 @@ static inline bool pte_valid(pte_t* pte)
     return (*pte & PTE_VALID);
 }
 
+/* Type, attribute and permission bits, to remap an entry without changing its semantics */
+static inline pte_flags_t pte_flags(pte_t* pte)
+{
+    return (pte_flags_t)(*pte & PTE_FLAGS_MSK);
+}
+
 static inline void pte_set_rsw(pte_t* pte, pte_flags_t flag)
 {
     *pte = (*pte & ~PTE_RSW_MSK) | (flag & PTE_RSW_MSK);
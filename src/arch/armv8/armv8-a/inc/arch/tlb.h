@@ -10,6 +10,12 @@
 #include <arch/sysregs.h>
 #include <arch/fences.h>
 
+/* Above this many pages, invalidating them one by one costs more than invalidating all */
+#define TLB_INV_PAGES_MAX   (64)
+
+/* Range invalidations take counts below this, with one operation per scale at most */
+#define TLB_RANGE_PAGES_MAX ((TLBI_RANGE_NUM_MAX + 1) << ((5 * TLBI_RANGE_SCALE_MAX) + 1))
+
 static inline void tlb_hyp_inv_va(vaddr_t va)
 {
     DSB(ish);
@@ -66,4 +72,104 @@ static inline void tlb_vm_inv_all(asid_t vmid)
     }
 }
 
+static inline bool tlb_arm_range_fits(size_t pages)
+{
+    return arm_tlbi_range_supported() ? (pages < TLB_RANGE_PAGES_MAX) :
+                                        (pages <= TLB_INV_PAGES_MAX);
+}
+
+static inline void tlb_arm_inv_page(vaddr_t va, bool stage2)
+{
+    if (stage2) {
+        arm_tlbi_ipas2e1is(va);
+    } else {
+        arm_tlbi_vae2is(va);
+    }
+}
+
+/**
+ * Each range operation takes one 5-bit group of the page count, from the bottom, and a lone odd
+ * page is invalidated on its own. Without range operations, pages are invalidated one by one.
+ */
+static inline void tlb_arm_inv_pages(vaddr_t va, size_t pages, bool stage2)
+{
+    if (!arm_tlbi_range_supported()) {
+        for (size_t i = 0; i < pages; i++) {
+            tlb_arm_inv_page(va + (i * PAGE_SIZE), stage2);
+        }
+        return;
+    }
+
+    if (pages & 1) {
+        tlb_arm_inv_page(va, stage2);
+        va += PAGE_SIZE;
+        pages--;
+    }
+
+    for (size_t scale = 0; pages > 0; scale++) {
+        size_t shift = (5 * scale) + 1;
+        size_t num = (pages >> shift) & TLBI_RANGE_NUM_MAX;
+        if (num != 0) {
+            if (stage2) {
+                arm_tlbi_ripas2e1is(va, scale, num - 1);
+            } else {
+                arm_tlbi_rvae2is(va, scale, num - 1);
+            }
+            va += (num << shift) * PAGE_SIZE;
+            pages -= num << shift;
+        }
+    }
+}
+
+static inline void tlb_hyp_inv_range(vaddr_t va, size_t size)
+{
+    size_t pages = NUM_PAGES(size);
+
+    if (!tlb_arm_range_fits(pages)) {
+        tlb_hyp_inv_all();
+        return;
+    }
+
+    DSB(ish);
+    tlb_arm_inv_pages(va, pages, false);
+    DSB(ish);
+    ISB();
+}
+
+/**
+ * IPA invalidations only remove stage 2 entries, not the combined stage 1 and 2 entries the guest's
+ * own walks may have cached from them. Those go with all stage 1 entries of the VMID, once the IPA
+ * invalidations are complete.
+ */
+static inline void tlb_vm_inv_range(asid_t vmid, vaddr_t va, size_t size)
+{
+    size_t pages = NUM_PAGES(size);
+
+    if (!tlb_arm_range_fits(pages)) {
+        tlb_vm_inv_all(vmid);
+        return;
+    }
+
+    uint64_t vttbr = 0;
+    vttbr = sysreg_vttbr_el2_read();
+    bool switch_vmid = bit64_extract(vttbr, VTTBR_VMID_OFF, VTTBR_VMID_LEN) != vmid;
+
+    DSB(ish);
+
+    if (switch_vmid) {
+        sysreg_vttbr_el2_write(((uint64_t)vmid << VTTBR_VMID_OFF) & VTTBR_VMID_MSK);
+        ISB();
+    }
+
+    tlb_arm_inv_pages(va, pages, true);
+    DSB(ish);
+    arm_tlbi_vmalle1is();
+    DSB(ish);
+
+    if (switch_vmid) {
+        sysreg_vttbr_el2_write(vttbr);
+    }
+    ISB();
+}
+
 #endif /* __ARCH_TLB_H__ */
@@ -8,6 +8,7 @@
 #include <fences.h>
 #include <bit.h>
 #include <platform.h>
+#include <string.h>
 
 void cache_arch_enumerate(struct cache* dscrp)
 {
@@ -101,6 +102,34 @@ void cache_arch_enumerate(struct cache* dscrp)
     }
 }
 
+#ifdef AARCH64
+/**
+ * Non-temporal load and store pairs, 64 bytes at a time, hint the core not to allocate the lines
+ * in the caches. The tail is left to memcpy.
+ */
+void cache_copy_stream(void* dst, const void* src, size_t size)
+{
+    size_t bulk = size & ~((size_t)63);
+    uint8_t* d = (uint8_t*)dst;
+    const uint8_t* s = (const uint8_t*)src;
+
+    for (size_t off = 0; off < bulk; off += 64) {
+        __asm__ volatile("ldnp x2, x3, [%1]\n\t"
+                         "ldnp x4, x5, [%1, #16]\n\t"
+                         "ldnp x6, x7, [%1, #32]\n\t"
+                         "ldnp x8, x9, [%1, #48]\n\t"
+                         "stnp x2, x3, [%0]\n\t"
+                         "stnp x4, x5, [%0, #16]\n\t"
+                         "stnp x6, x7, [%0, #32]\n\t"
+                         "stnp x8, x9, [%0, #48]\n\t" ::"r"(d + off),
+            "r"(s + off)
+            : "x2", "x3", "x4", "x5", "x6", "x7", "x8", "x9", "memory");
+    }
+
+    memcpy(d + bulk, s + bulk, size - bulk);
+}
+#endif
+
 void cache_flush_range(vaddr_t base, size_t size)
 {
     vaddr_t cache_addr = base;
@@ -18,6 +18,8 @@
 #include <spinlock.h>
 #include <platform.h>
 #include <fences.h>
+#include <exit_stats.h>
+#include <arch/vgic.h>
 
 volatile struct gicd_hw* gicd;
 spinlock_t gicd_lock;
@@ -91,17 +93,25 @@ void gic_init()
 
 void gic_handle()
 {
+    exit_stats_begin();
+    if (DEFINED(IRQ_LATENCY)) {
+        vgic_irq_lat_poll(cpu()->vcpu);
+    }
+
     uint32_t ack = gicc_iar();
     cpu()->is_handling_irq = 1;
     cpu()->handling_irq_id = ack;
     irqid_t id = bit32_extract(ack, GICC_IAR_ID_OFF, GICC_IAR_ID_LEN);
 
     if (id < GIC_FIRST_SPECIAL_INTID) {
+        exit_stats_classify(EXIT_REASON_IRQ, id);
         enum irq_res res = interrupts_handle(id);
         gicc_eoir(ack);
         if (res == HANDLED_BY_HYP) gicc_dir(ack);
     }
     cpu()->is_handling_irq = 0;
+
+    exit_stats_end();
 }
 
 uint8_t gicd_get_prio(irqid_t int_id)
@@ -142,6 +142,15 @@ static inline uint8_t gic_translate_cpu_to_trgt(uint8_t cpu_targets)
     return gic_targets;
 }
 
+void gic_send_sgi_mask(cpumap_t cpu_targets, irqid_t sgi_num)
+{
+    uint32_t gic_targets = (uint32_t)gic_translate_cpu_to_trgt((uint8_t)cpu_targets);
+
+    if ((sgi_num < GIC_MAX_SGIS) && (gic_targets != 0)) {
+        gicd->SGIR = (gic_targets << GICD_SGIR_CPUTRGLST_OFF) | (sgi_num & GICD_SGIR_SGIINTID_MSK);
+    }
+}
+
 void gicd_set_trgt(irqid_t int_id, uint8_t cpu_targets)
 {
     size_t reg_ind = GIC_TARGET_REG(int_id);
@@ -227,6 +227,40 @@ void gic_send_sgi(cpuid_t cpu_target, irqid_t sgi_num)
     }
 }
 
+/**
+ * A single ICC_SGI1R write signals every target that shares affinity level 1 (i.e., a cluster),
+ * so the mask costs one write per cluster rather than one per cpu.
+ */
+void gic_send_sgi_mask(cpumap_t cpu_targets, irqid_t sgi_num)
+{
+    uint64_t trgtlist = 0;
+    unsigned long aff1 = 0;
+
+    if (sgi_num >= GIC_MAX_SGIS) {
+        return;
+    }
+
+    for (cpuid_t cpu_id = 0; cpu_id < platform.cpu_num; cpu_id++) {
+        if (!(cpu_targets & (1UL << cpu_id))) {
+            continue;
+        }
+
+        unsigned long mpidr = cpu_id_to_mpidr(cpu_id) & MPIDR_AFF_MSK;
+        if ((trgtlist != 0) && (MPIDR_AFF_LVL(mpidr, 1) != aff1)) {
+            sysreg_icc_sgi1r_el1_write((aff1 << ICC_SGIR_AFF1_OFFSET) | trgtlist |
+                (sgi_num << ICC_SGIR_SGIINTID_OFF));
+            trgtlist = 0;
+        }
+        aff1 = MPIDR_AFF_LVL(mpidr, 1);
+        trgtlist |= 1UL << MPIDR_AFF_LVL(mpidr, 0);
+    }
+
+    if (trgtlist != 0) {
+        sysreg_icc_sgi1r_el1_write((aff1 << ICC_SGIR_AFF1_OFFSET) | trgtlist |
+            (sgi_num << ICC_SGIR_SGIINTID_OFF));
+    }
+}
+
 void gic_set_prio(irqid_t int_id, uint8_t prio)
 {
     if (!gic_is_priv(int_id)) {
@@ -40,6 +40,11 @@ static inline void events_arch_cntr_set(size_t counter, unsigned long value)
     pmu_cntr_set(counter, value);
 }
 
+static inline void events_arch_cntr_write(size_t counter, uint32_t value)
+{
+    pmu_cntr_write(counter, value);
+}
+
 static inline uint64_t events_arch_get_cntr_value(size_t counter)
 {
     return pmu_cntr_get(counter);
@@ -50,6 +55,11 @@ static inline void events_arch_set_evtyper(size_t counter, size_t event)
     pmu_set_evtyper(counter, event);
 }
 
+static inline void events_arch_set_evtyper_raw(size_t counter, uint64_t evtyper)
+{
+    pmu_set_evtyper_raw(counter, evtyper);
+}
+
 static inline void events_arch_interrupt_enable(uint64_t cpu_id)
 {
     pmu_interrupt_enable(cpu_id);
@@ -70,14 +80,14 @@ static inline void events_arch_cntr_irq_disable(size_t counter)
     pmu_set_cntr_irq_disable(counter);
 }
 
-static inline void events_arch_clear_cntr_ovs(size_t counter)
+static inline bool events_arch_cntr_ovs(size_t counter)
 {
-    pmu_clear_cntr_ovs(counter);
+    return pmu_cntr_ovs(counter);
 }
 
-static inline void events_arch_cntr_set_irq_callback(irq_handler_t handler, size_t counter)
+static inline void events_arch_clear_cntr_ovs(size_t counter)
 {
-    pmu_define_event_cntr_irq_callback(handler, counter);
+    pmu_clear_cntr_ovs(counter);
 }
 
 #endif /* __ARCH_EVENTS_H__ */
\ No newline at end of file
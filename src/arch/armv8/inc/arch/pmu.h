@@ -3,6 +3,7 @@
 
 #include <interrupts.h>
 #include <arch/sysregs.h>
+#include <arch/gic.h>
 #include <platform.h>
 #include <printk.h>
 #include <bit.h>
@@ -14,12 +15,25 @@
 #endif
 
 
+#define PMCR_EL0_E			(1 << 0)
+#define PMCR_EL0_P			(1 << 1)
+#define PMCR_EL0_C			(1 << 2)
+#define PMCR_EL0_D			(1 << 3)
+#define PMCR_EL0_X			(1 << 4)
+#define PMCR_EL0_DP			(1 << 5)
+#define PMCR_EL0_LC			(1 << 6)
 #define PMCR_EL0_N_POS		(11)
 #define PMCR_EL0_N_MASK		(0x1F << PMCR_EL0_N_POS)
+#define PMCR_EL0_ID_MASK	(0xFFFF0000)
 
+#define MDCR_EL2_TPMCR		(1 << 5)
+#define MDCR_EL2_TPM		(1 << 6)
 #define MDCR_EL2_HPME		(1 << 7)
 #define MDCR_EL2_HPMN_MASK	(0x1F)
 
+#define PMU_CYCLE_CNTR		(31)
+#define PMEVTYPER_EVT_MASK	(0xFFFF)
+
 #define PMEVTYPER_P				31 
 #define PMEVTYPER_U				30 
 #define PMEVTYPER_NSK			29 
@@ -54,7 +68,16 @@ uint64_t pmu_cntr_alloc();
 void pmu_cntr_free(uint64_t);
 void pmu_enable(void);
 void pmu_interrupt_enable(uint64_t cpu_id);
-void pmu_define_event_cntr_irq_callback(irq_handler_t handler, size_t counter);
+
+/**
+ * The PMU overflow interrupt is either a PPI, the same id on every cpu (events_irq_offset below
+ * GIC_CPU_PRIV), or one SPI per cpu starting at events_irq_offset.
+ */
+static inline irqid_t pmu_interrupt_id(uint64_t cpu_id)
+{
+    irqid_t offset = (irqid_t)platform.arch.events.events_irq_offset;
+    return gic_is_priv(offset) ? offset : (irqid_t)(offset + cpu_id);
+}
 
 
 static inline void pmu_disable(void) {
@@ -94,6 +117,16 @@ static inline void pmu_cntr_set(size_t counter, unsigned long value) {
     sysreg_pmxevcntr_el0_write(value);
 }
 
+static inline void pmu_cntr_write(size_t counter, uint32_t value) {
+    uint64_t pmselr;
+
+    pmselr = sysreg_pmselr_el0_read();
+    pmselr = bit_insert(pmselr, counter, 0, 5);
+    sysreg_pmselr_el0_write(pmselr);
+
+    sysreg_pmxevcntr_el0_write(value);
+}
+
 static inline unsigned long pmu_cntr_get(size_t counter) {
     uint64_t pmselr;
 
@@ -126,12 +159,22 @@ static inline void pmu_set_evtyper(size_t counter, size_t event) {
     sysreg_pmxevtyper_el0_write(pmxevtyper);
 }
 
-static inline void pmu_interrupt_disable(uint64_t cpu_id) {
-    // Set the interrupt number for the PMU event.
-    uint64_t interrupt_number = platform.arch.events.events_irq_offset + cpu_id;
+/* Program a raw event type, never allowing the counter to count at EL2 */
+static inline void pmu_set_evtyper_raw(size_t counter, uint64_t evtyper) {
+    uint64_t pmselr;
+
+    pmselr = sysreg_pmselr_el0_read();
+    pmselr = bit_insert(pmselr, counter, 0, 5);
+    sysreg_pmselr_el0_write(pmselr);
 
-    // Disable the specified interrupt.
-    interrupts_arch_enable(interrupt_number, false);
+    evtyper &= (1UL << PMEVTYPER_P) | (1UL << PMEVTYPER_U) | (1UL << PMEVTYPER_NSK) |
+        (1UL << PMEVTYPER_NSU) | PMEVTYPER_EVT_MASK;
+
+    sysreg_pmxevtyper_el0_write(evtyper);
+}
+
+static inline void pmu_interrupt_disable(uint64_t cpu_id) {
+    interrupts_arch_enable(pmu_interrupt_id(cpu_id), false);
 }
 
 static inline void pmu_set_cntr_irq_enable(size_t counter) {
@@ -149,6 +192,10 @@ static inline void pmu_set_cntr_irq_disable(size_t counter) {
     sysreg_pmintenclr_el1_write(pmintenset);
 }
 
+static inline bool pmu_cntr_ovs(size_t counter) {
+    return bit_get(sysreg_pmovsclr_el0_read(), counter);
+}
+
 static inline void pmu_clear_cntr_ovs(size_t counter) {
     uint64_t pmovsclr = 0;
     pmovsclr = bit_set(pmovsclr, counter);
@@ -17,6 +17,11 @@
 
 #define PAR_32BIT                 (0)
 
+/* TLBI range operations cover (NUM + 1) << (5 * SCALE + 1) pages */
+#define TLBI_RANGE_NUM_LEN        5
+#define TLBI_RANGE_NUM_MAX        ((1UL << TLBI_RANGE_NUM_LEN) - 1)
+#define TLBI_RANGE_SCALE_MAX      (3)
+
 #define SPSel_SP                  (1 << 0)
 
 /* PSTATE */
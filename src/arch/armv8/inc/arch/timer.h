@@ -1,25 +1,57 @@
 /**
- * SPDX-License-Identifier: Apache-2.0 
+ * SPDX-License-Identifier: Apache-2.0
  * Copyright (c) Bao Project and Contributors. All rights reserved
  */
 
-#ifndef __ARCH_TIMER_MOD_H__
-#define __ARCH_TIMER_MOD_H__
+#ifndef __ARCH_TIMER_H__
+#define __ARCH_TIMER_H__
 
-#include <interrupts.h>
+#include <bao.h>
 #include <platform.h>
+#include <arch/sysregs.h>
+#include <arch/fences.h>
 
-uint64_t timer_arch_init(uint64_t period);
-void timer_arch_enable();
-void timer_arch_disable();
+#define CNTHP_CTL_EL2_ENABLE (1UL << 0)
+#define CNTHP_CTL_EL2_IMASK  (1UL << 1)
 
-void timer_arch_reschedule_interrupt(uint64_t count);
-uint64_t timer_arch_reschedule_interrupt_us(uint64_t period);
+/* The EL2 physical timer PPI recommended by the Server Base System Architecture */
+#define CNTHP_PPI_DEFAULT    (26)
 
-static inline void timer_arch_define_irq_callback(irq_handler_t handler)
+void timer_arch_init(void);
+
+/* Platforms that leave generic_timer.timer_id unset get the usual CNTHP PPI */
+static inline irqid_t timer_arch_irq_id(void)
+{
+    irqid_t timer_id = (irqid_t)platform.arch.generic_timer.timer_id;
+    return (timer_id != 0) ? timer_id : CNTHP_PPI_DEFAULT;
+}
+
+static inline uint64_t timer_arch_get_counter(void)
+{
+    ISB();
+    return sysreg_cntpct_el0_read();
+}
+
+static inline uint64_t timer_arch_get_freq(void)
+{
+    return sysreg_cntfrq_el0_read() & 0xFFFFFFFF;
+}
+
+/**
+ * The hypervisor timer is programmed through its absolute compare value (CNTHP_CVAL_EL2). A
+ * deadline that is already in the past fires immediately, so no expiry is ever lost.
+ */
+static inline void timer_arch_set_deadline(uint64_t deadline)
+{
+    sysreg_cnthp_cval_el2_write(deadline);
+    sysreg_cnthp_ctl_el2_write(CNTHP_CTL_EL2_ENABLE);
+    ISB();
+}
+
+static inline void timer_arch_disarm(void)
 {
-    interrupts_reserve(platform.arch.generic_timer.timer_id, handler);
-    interrupts_arch_enable(platform.arch.generic_timer.timer_id, true);
+    sysreg_cnthp_ctl_el2_write(0);
+    ISB();
 }
 
-#endif /* __ARCH_TIMER_MOD_H__ */
+#endif /* __ARCH_TIMER_H__ */
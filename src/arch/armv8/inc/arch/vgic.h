@@ -76,6 +76,7 @@ void vgic_cpu_init(struct vcpu* vcpu);
 void vgic_set_hw(struct vm* vm, irqid_t id);
 void vgic_inject(struct vcpu* vcpu, irqid_t id, vcpuid_t source);
 void vgic_inject_hw(struct vcpu* vcpu, irqid_t id);
+void vgic_irq_lat_poll(struct vcpu* vcpu);
 
 /* VGIC INTERNALS */
 
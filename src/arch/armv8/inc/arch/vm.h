@@ -10,6 +10,7 @@
 #include <arch/subarch/vm.h>
 #include <arch/vgic.h>
 #include <arch/psci.h>
+#include <arch/vpmu.h>
 #ifdef MEM_PROT_MMU
 #include <arch/smmuv2.h>
 #endif
@@ -23,6 +24,11 @@ struct arch_vm_platform {
         size_t interrupt_num;
     } gic;
 
+    struct {
+        /* Virtual PMU overflow interrupt (PPI). Zero disables the virtual PMU. */
+        irqid_t interrupt_id;
+    } pmu;
+
 #ifdef MEM_PROT_MMU
     struct {
         streamid_t global_mask;
@@ -44,6 +50,7 @@ struct vm_arch {
     struct emul_mem vgicr_emul;
     struct emul_reg icc_sgir_emul;
     struct emul_reg icc_sre_emul;
+    struct emul_reg vpmu_emul[VPMU_EMUL_REGS];
 };
 
 struct vcpu_arch {
@@ -51,6 +58,7 @@ struct vcpu_arch {
     struct vgic_priv vgic_priv;
     struct list vgic_spilled;
     struct psci_ctx psci_ctx;
+    struct vpmu vpmu;
 };
 
 struct vcpu* vm_get_vcpu_by_mpidr(struct vm* vm, unsigned long mpidr);
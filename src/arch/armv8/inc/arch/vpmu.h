@@ -0,0 +1,60 @@
+/**
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (c) Bao Project and Contributors. All rights reserved.
+ */
+
+#ifndef __ARCH_VPMU_H__
+#define __ARCH_VPMU_H__
+
+#include <bao.h>
+#include <emul.h>
+#include <events.h>
+#include <arch/pmu.h>
+
+/* Maximum number of virtual event counters (the cycle counter is handled separately) */
+#define VPMU_CNTR_MAX      (31)
+
+/* Fixed registers plus a PMEVCNTR<n>/PMEVTYPER<n> pair per virtual counter */
+#define VPMU_EMUL_FIXED    (16)
+#define VPMU_EMUL_REGS     (VPMU_EMUL_FIXED + (2 * VPMU_CNTR_MAX))
+
+struct vpmu_cntr {
+    /* Guest value, while not counting */
+    uint32_t value;
+    uint32_t evtyper;
+    /* Backed by vcntr, which starts from value */
+    bool counting;
+    struct events_vcntr vcntr;
+};
+
+struct vpmu {
+    /* Guest PMU overflow interrupt. Zero means the vPMU is disabled for this vcpu. */
+    irqid_t irq_id;
+    size_t cntr_num;
+
+    /* Guest visible register state */
+    uint64_t pmcr;
+    uint32_t cntenset;
+    uint32_t intenset;
+    uint32_t ovs;
+    uint64_t selr;
+    uint64_t userenr;
+    uint64_t ccfiltr;
+    struct vpmu_cntr cntrs[VPMU_CNTR_MAX];
+
+    bool irq_level;
+};
+
+struct vm;
+struct vcpu;
+
+void vpmu_init(struct vm* vm);
+void vpmu_vcpu_init(struct vcpu* vcpu);
+void vpmu_reset(struct vcpu* vcpu);
+
+static inline bool vpmu_enabled(struct vpmu* vpmu)
+{
+    return vpmu->irq_id != 0;
+}
+
+#endif /* __ARCH_VPMU_H__ */
@@ -30,6 +30,13 @@ void interrupts_arch_ipi_send(cpuid_t target_cpu, irqid_t ipi_id)
     }
 }
 
+void interrupts_arch_ipi_send_mask(cpumap_t targets, irqid_t ipi_id)
+{
+    if (ipi_id < GIC_MAX_SGIS) {
+        gic_send_sgi_mask(targets, ipi_id);
+    }
+}
+
 void interrupts_arch_enable(irqid_t int_id, bool en)
 {
     gic_set_enable(int_id, en);
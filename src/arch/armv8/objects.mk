@@ -12,6 +12,7 @@ cpu-objs-y+=vgic.o
 cpu-objs-y+=vmm.o
 cpu-objs-y+=timer.o
 cpu-objs-y+=pmu.o
+cpu-objs-y+=vpmu.o
 cpu-objs-y+=psci.o
 
 ifeq ($(GIC_VERSION), GICV2)
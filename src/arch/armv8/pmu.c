@@ -25,18 +25,18 @@ void pmu_cntr_free(uint64_t counter)
 
 void pmu_interrupt_handler(irqid_t int_id)
 {
-    uint64_t pmovsclr = sysreg_pmovsclr_el0_read(); // MRS(PMOVSCLR_EL0);
-    
-    for(uint32_t index = 0; index < PMU_N_CNTR; index++)
-    {
-        if(bit_get(pmovsclr, index))
-        {
-            (index >= PMU_N_CNTR_GIVEN && index < cpu()->implemented_event_counters - PMU_N_CNTR_GIVEN) ? 
-                cpu()->array_interrupt_functions[index](int_id) : 
-                (pmovsclr = bit_set(pmovsclr, index)); //Clear overflows created by guests
-        }
+    UNUSED_ARG(int_id);
+
+    uint64_t implemented = (uint64_t)1 << PMU_CYCLE_CNTR;
+    if (cpu()->implemented_event_counters > 0) {
+        implemented |= BIT64_MASK(0, cpu()->implemented_event_counters);
     }
+
+    /* Acknowledge before dispatching, an overflow handler may never return */
+    uint64_t pmovsclr = sysreg_pmovsclr_el0_read() & implemented;
     sysreg_pmovsclr_el0_write(pmovsclr);
+
+    events_handle_overflow(pmovsclr);
 }
 
 /* Enable the pmu in the EL2*/
@@ -53,17 +53,34 @@ void pmu_enable(void)
     sysreg_mdcr_el2_write(mdcr); //MSR(MDCR_EL2, mdcr);
 }
 
+static spinlock_t pmu_irq_lock = SPINLOCK_INITVAL;
+static bool pmu_ppi_reserved = false;
+
 void pmu_interrupt_enable(uint64_t cpu_id)
 {
-    if(!interrupts_reserve((platform.arch.events.events_irq_offset + cpu_id), 
-                            pmu_interrupt_handler)) {
-        ERROR("Failed to assign PMU interrupt id = %d\n", 
-            platform.arch.events.events_irq_offset + cpu_id);
+    irqid_t int_id = pmu_interrupt_id(cpu_id);
+    bool reserved = true;
+
+    /* Both the regulator and the virtual PMU may request the per-cpu PMU interrupt */
+    if (cpu()->events_irq_reserved) {
+        return;
     }
-    interrupts_arch_enable((platform.arch.events.events_irq_offset + cpu_id), true);
-}
+    cpu()->events_irq_reserved = true;
 
-void pmu_define_event_cntr_irq_callback(irq_handler_t handler, size_t counter)
-{
-    cpu()->array_interrupt_functions[counter] = handler;
+    if (int_id < GIC_MAX_SGIS) {
+        ERROR("Platform does not describe its PMU interrupt (events_irq_offset)");
+    }
+
+    /* A PPI is reserved once, by whichever cpu gets here first, and enabled by each */
+    spin_lock(&pmu_irq_lock);
+    if (!gic_is_priv(int_id) || !pmu_ppi_reserved) {
+        reserved = interrupts_reserve(int_id, pmu_interrupt_handler);
+        pmu_ppi_reserved = reserved && gic_is_priv(int_id);
+    }
+    spin_unlock(&pmu_irq_lock);
+
+    if (!reserved) {
+        ERROR("Failed to assign PMU interrupt id = %d\n", int_id);
+    }
+    interrupts_arch_enable(int_id, true);
 }
@@ -21,6 +21,7 @@
 #include <interrupts.h>
 #include <vm.h>
 #include <platform.h>
+#include <irq_lat.h>
 
 enum VGIC_EVENTS { VGIC_UPDATE_ENABLE, VGIC_ROUTE, VGIC_INJECT, VGIC_SET_REG };
 extern volatile const size_t VGIC_IPI_ID;
@@ -137,11 +138,7 @@ void vgic_send_sgi_msg(struct vcpu* vcpu, cpumap_t pcpu_mask, irqid_t int_id)
         VGIC_MSG_DATA(cpu()->vcpu->vm->id, 0, int_id, 0, cpu()->vcpu->id),
     };
 
-    for (size_t i = 0; i < platform.cpu_num; i++) {
-        if (pcpu_mask & (1ULL << i)) {
-            cpu_send_msg(i, &msg);
-        }
-    }
+    cpu_send_msg_mask(pcpu_mask, &msg);
 }
 
 static void vgic_route(struct vcpu* vcpu, struct vgic_int* interrupt)
@@ -162,11 +159,32 @@ static void vgic_route(struct vcpu* vcpu, struct vgic_int* interrupt)
         };
         vgic_yield_ownership(vcpu, interrupt);
         cpumap_t trgtlist = vgic_int_ptarget_mask(vcpu, interrupt) & ~(1UL << vcpu->phys_id);
-        for (size_t i = 0; i < platform.cpu_num; i++) {
-            if (trgtlist & (1ULL << i)) {
-                cpu_send_msg(i, &msg);
-            }
-        }
+        cpu_send_msg_mask(trgtlist, &msg);
+    }
+}
+
+static inline unsigned long vgic_irq_lat_cookie(size_t lr_ind)
+{
+    return ((unsigned long)cpu()->id << 8) | lr_ind;
+}
+
+/**
+ * Hardware interrupts are deactivated by the guest directly in the physical distributor and raise
+ * no maintenance interrupt, so their completion is only observable as their list register
+ * retiring. This is checked on every entry to the hypervisor, which bounds the measured completion
+ * time from above.
+ */
+void vgic_irq_lat_poll(struct vcpu* vcpu)
+{
+    if (!DEFINED(IRQ_LATENCY) || (vcpu == NULL)) {
+        return;
+    }
+
+    uint64_t elrsr = gich_get_elrsr() & BIT64_MASK(0, NUM_LRS);
+    for (ssize_t lr_ind = bit64_ffs(elrsr); lr_ind >= 0; lr_ind = bit64_ffs(elrsr)) {
+        elrsr = bit64_clear(elrsr, (size_t)lr_ind);
+        irq_lat_complete(vcpu->arch.vgic_priv.curr_lrs[lr_ind],
+            vgic_irq_lat_cookie((size_t)lr_ind));
     }
 }
 
@@ -242,6 +260,10 @@ static inline void vgic_write_lr(struct vcpu* vcpu, struct vgic_int* interrupt,
     interrupt->lr = (uint8_t)lr_ind;
     vcpu->arch.vgic_priv.curr_lrs[lr_ind] = interrupt->id;
     gich_write_lr(lr_ind, lr);
+
+    if (vgic_int_is_hw(interrupt)) {
+        irq_lat_inject(interrupt->id, vgic_irq_lat_cookie(lr_ind), vcpu->mem_throt.throttled);
+    }
 }
 
 bool vgic_remove_lr(struct vcpu* vcpu, struct vgic_int* interrupt)
@@ -13,6 +13,7 @@ void vm_arch_init(struct vm* vm, const struct vm_config* vm_config)
 {
     if (vm->master == cpu()->id) {
         vgic_init(vm, &vm_config->platform.arch.gic);
+        vpmu_init(vm);
     }
     cpu_sync_and_clear_msgs(&vm->sync);
 }
@@ -55,6 +56,8 @@ void vcpu_arch_init(struct vcpu* vcpu, struct vm* vm)
     vcpu_arch_profile_init(vcpu, vm);
 
     vgic_cpu_init(vcpu);
+
+    vpmu_vcpu_init(vcpu);
 }
 
 void vcpu_arch_reset(struct vcpu* vcpu, vaddr_t entry)
@@ -72,7 +75,11 @@ void vcpu_arch_reset(struct vcpu* vcpu, vaddr_t entry)
      */
     sysreg_sctlr_el1_write(SCTLR_RES1);
     sysreg_cntkctl_el1_write(0);
-    sysreg_pmcr_el0_write(0);
+    if (vpmu_enabled(&vcpu->arch.vpmu)) {
+        vpmu_reset(vcpu);
+    } else {
+        sysreg_pmcr_el0_write(0);
+    }
 
     /**
      *  TODO: ARMv8-A ARM mentions another implementation optional registers that reset to a known
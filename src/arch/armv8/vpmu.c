@@ -0,0 +1,506 @@
+/**
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (c) Bao Project and Contributors. All rights reserved.
+ */
+
+#include <arch/vpmu.h>
+#include <cpu.h>
+#include <vm.h>
+#include <events.h>
+#include <config.h>
+
+/**
+ * The virtual PMU traps every guest PMU register access (MDCR_EL2.TPM/TPMCR) and emulates a PMUv3
+ * with as many event counters as the hardware implements. Each guest counter that is enabled
+ * (PMCR_EL0.E and its PMCNTENSET_EL0 bit) is backed by a virtual event counter of the events
+ * layer, which maps it onto one of the physical counters the memory bandwidth regulator leaves
+ * free, and time-multiplexes them when there are more enabled counters than free ones. Guest
+ * counters only hold on to physical ones while enabled, and the regulator can always reclaim them.
+ * Guest counts are not scaled, they advance only while actually counting. The cycle counter is not
+ * used by the hypervisor and is passed through to the guest. Each vcpu runs on its own physical
+ * cpu, so all state here is only touched by that cpu.
+ */
+
+#define VPMU_PMCR_RW_MSK (PMCR_EL0_E | PMCR_EL0_D | PMCR_EL0_X | PMCR_EL0_DP | PMCR_EL0_LC)
+#define VPMU_CCFILTR_MSK ((1UL << PMEVTYPER_P) | (1UL << PMEVTYPER_U))
+
+#define PMCR_EL0_ADDR       SYSREG_ENC_ADDR(3, 3, 9, 12, 0)
+#define PMCNTENSET_EL0_ADDR SYSREG_ENC_ADDR(3, 3, 9, 12, 1)
+#define PMCNTENCLR_EL0_ADDR SYSREG_ENC_ADDR(3, 3, 9, 12, 2)
+#define PMOVSCLR_EL0_ADDR   SYSREG_ENC_ADDR(3, 3, 9, 12, 3)
+#define PMSWINC_EL0_ADDR    SYSREG_ENC_ADDR(3, 3, 9, 12, 4)
+#define PMSELR_EL0_ADDR     SYSREG_ENC_ADDR(3, 3, 9, 12, 5)
+#define PMCEID0_EL0_ADDR    SYSREG_ENC_ADDR(3, 3, 9, 12, 6)
+#define PMCEID1_EL0_ADDR    SYSREG_ENC_ADDR(3, 3, 9, 12, 7)
+#define PMCCNTR_EL0_ADDR    SYSREG_ENC_ADDR(3, 3, 9, 13, 0)
+#define PMXEVTYPER_EL0_ADDR SYSREG_ENC_ADDR(3, 3, 9, 13, 1)
+#define PMXEVCNTR_EL0_ADDR  SYSREG_ENC_ADDR(3, 3, 9, 13, 2)
+#define PMUSERENR_EL0_ADDR  SYSREG_ENC_ADDR(3, 3, 9, 14, 0)
+#define PMINTENSET_EL1_ADDR SYSREG_ENC_ADDR(3, 0, 9, 14, 1)
+#define PMINTENCLR_EL1_ADDR SYSREG_ENC_ADDR(3, 0, 9, 14, 2)
+#define PMOVSSET_EL0_ADDR   SYSREG_ENC_ADDR(3, 3, 9, 14, 3)
+#define PMCCFILTR_EL0_ADDR  SYSREG_ENC_ADDR(3, 3, 14, 15, 7)
+#define PMEVCNTR_EL0_ADDR(n) SYSREG_ENC_ADDR(3, 3, 14, 8 + ((n) >> 3), (n) & 0x7)
+#define PMEVTYPER_EL0_ADDR(n) SYSREG_ENC_ADDR(3, 3, 14, 12 + ((n) >> 3), (n) & 0x7)
+
+static const regaddr_t vpmu_fixed_regs[VPMU_EMUL_FIXED] = {
+    PMCR_EL0_ADDR,
+    PMCNTENSET_EL0_ADDR,
+    PMCNTENCLR_EL0_ADDR,
+    PMOVSCLR_EL0_ADDR,
+    PMSWINC_EL0_ADDR,
+    PMSELR_EL0_ADDR,
+    PMCEID0_EL0_ADDR,
+    PMCEID1_EL0_ADDR,
+    PMCCNTR_EL0_ADDR,
+    PMXEVTYPER_EL0_ADDR,
+    PMXEVCNTR_EL0_ADDR,
+    PMUSERENR_EL0_ADDR,
+    PMINTENSET_EL1_ADDR,
+    PMINTENCLR_EL1_ADDR,
+    PMOVSSET_EL0_ADDR,
+    PMCCFILTR_EL0_ADDR,
+};
+
+static inline struct vpmu* vpmu_get(void)
+{
+    return &cpu()->vcpu->arch.vpmu;
+}
+
+static inline uint32_t vpmu_valid_mask(struct vpmu* vpmu)
+{
+    return (uint32_t)BIT32_MASK(0, vpmu->cntr_num) | (UINT32_C(1) << PMU_CYCLE_CNTR);
+}
+
+static inline bool vpmu_cntr_active(struct vpmu* vpmu, size_t cntr)
+{
+    return (vpmu->pmcr & PMCR_EL0_E) && bit32_get(vpmu->cntenset, cntr);
+}
+
+static void vpmu_update_irq(struct vcpu* vcpu)
+{
+    struct vpmu* vpmu = &vcpu->arch.vpmu;
+    bool level =
+        (vpmu->pmcr & PMCR_EL0_E) && ((vpmu->ovs & vpmu->intenset & vpmu->cntenset) != 0);
+
+    if (level && !vpmu->irq_level) {
+        vcpu_inject_irq(vcpu, vpmu->irq_id);
+    }
+    vpmu->irq_level = level;
+}
+
+/* Fold physical overflows of the counters currently backing the vPMU into the virtual state */
+static void vpmu_sync_ovs(struct vpmu* vpmu)
+{
+    uint64_t pmovs = sysreg_pmovsclr_el0_read();
+    uint64_t clear = 0;
+
+    for (size_t cntr = 0; cntr < vpmu->cntr_num; cntr++) {
+        size_t hw_cntr = vpmu->cntrs[cntr].vcntr.hw_cntr;
+        if (vpmu->cntrs[cntr].counting && (hw_cntr != EVENTS_VCNTR_UNMAPPED) &&
+            bit_get(pmovs, hw_cntr)) {
+            vpmu->ovs |= UINT32_C(1) << cntr;
+            clear = bit_set(clear, hw_cntr);
+        }
+    }
+
+    if (bit_get(pmovs, PMU_CYCLE_CNTR)) {
+        vpmu->ovs |= UINT32_C(1) << PMU_CYCLE_CNTR;
+        clear = bit_set(clear, PMU_CYCLE_CNTR);
+    }
+
+    if (clear != 0) {
+        sysreg_pmovsclr_el0_write(clear);
+    }
+}
+
+/* The overflow was already acknowledged in hardware, so record it from the counter's owner */
+static void vpmu_ovf_handler(size_t counter, void* ctx)
+{
+    struct vcpu* vcpu = cpu()->vcpu;
+    struct vpmu* vpmu = &vcpu->arch.vpmu;
+
+    if (counter == PMU_CYCLE_CNTR) {
+        vpmu->ovs |= UINT32_C(1) << PMU_CYCLE_CNTR;
+    } else {
+        vpmu->ovs |= UINT32_C(1) << ((struct vpmu_cntr*)ctx - vpmu->cntrs);
+    }
+
+    vpmu_update_irq(vcpu);
+}
+
+static uint32_t vpmu_cntr_read(struct vpmu* vpmu, size_t cntr)
+{
+    struct vpmu_cntr* vpmu_cntr = &vpmu->cntrs[cntr];
+
+    if (vpmu_cntr->counting) {
+        return (uint32_t)(vpmu_cntr->vcntr.phase +
+            events_vcntr_read_raw(&vpmu_cntr->vcntr, NULL, NULL));
+    }
+    return vpmu_cntr->value;
+}
+
+static void vpmu_cntr_start(struct vpmu* vpmu, size_t cntr)
+{
+    struct vpmu_cntr* vpmu_cntr = &vpmu->cntrs[cntr];
+
+    if (!events_vcntr_add_raw(&vpmu_cntr->vcntr, vpmu_cntr->evtyper, vpmu_cntr->value,
+            EVENTS_OWNER_VPMU, vpmu_ovf_handler, vpmu_cntr)) {
+        WARNING("vpmu: no virtual event counter left for vm %d counter %d", cpu()->vcpu->vm->id,
+            cntr);
+        return;
+    }
+    vpmu_cntr->counting = true;
+}
+
+/* Keep the count reached and give the virtual event counter, and its physical one, back */
+static void vpmu_cntr_stop(struct vpmu* vpmu, size_t cntr)
+{
+    struct vpmu_cntr* vpmu_cntr = &vpmu->cntrs[cntr];
+
+    events_vcntr_remove(&vpmu_cntr->vcntr);
+    vpmu_cntr->value = (uint32_t)(vpmu_cntr->vcntr.phase + vpmu_cntr->vcntr.count);
+    vpmu_cntr->counting = false;
+}
+
+static void vpmu_cntr_write(struct vpmu* vpmu, size_t cntr, uint32_t value)
+{
+    bool counting = vpmu->cntrs[cntr].counting;
+
+    if (counting) {
+        vpmu_cntr_stop(vpmu, cntr);
+    }
+    vpmu->cntrs[cntr].value = value;
+    if (counting) {
+        vpmu_cntr_start(vpmu, cntr);
+    }
+}
+
+static void vpmu_evtyper_write(struct vpmu* vpmu, size_t cntr, uint32_t evtyper)
+{
+    bool counting = vpmu->cntrs[cntr].counting;
+
+    if (counting) {
+        vpmu_cntr_stop(vpmu, cntr);
+    }
+    vpmu->cntrs[cntr].evtyper = evtyper;
+    if (counting) {
+        vpmu_cntr_start(vpmu, cntr);
+    }
+}
+
+static void vpmu_update_cycle_cntr(struct vpmu* vpmu)
+{
+    uint64_t cycle_bit = UINT64_C(1) << PMU_CYCLE_CNTR;
+
+    /**
+     * Counters below MDCR_EL2.HPMN are never handed to the vPMU, so the physical PMCR only
+     * effectively controls the cycle counter.
+     */
+    sysreg_pmcr_el0_write(vpmu->pmcr & VPMU_PMCR_RW_MSK);
+
+    if (vpmu->intenset & cycle_bit) {
+        sysreg_pmintenset_el1_write(cycle_bit);
+    } else {
+        sysreg_pmintenclr_el1_write(cycle_bit);
+    }
+
+    if (vpmu->cntenset & cycle_bit) {
+        sysreg_pmcntenset_el0_write(cycle_bit);
+    } else {
+        sysreg_pmcntenclr_el0_write(cycle_bit);
+    }
+}
+
+/* Start the guest counters that were just enabled and stop the ones that were just disabled */
+static void vpmu_update_cntrs(struct vpmu* vpmu)
+{
+    vpmu_update_cycle_cntr(vpmu);
+
+    for (size_t cntr = 0; cntr < vpmu->cntr_num; cntr++) {
+        bool active = vpmu_cntr_active(vpmu, cntr);
+        if (active && !vpmu->cntrs[cntr].counting) {
+            vpmu_cntr_start(vpmu, cntr);
+        } else if (!active && vpmu->cntrs[cntr].counting) {
+            vpmu_cntr_stop(vpmu, cntr);
+        }
+    }
+}
+
+static void vpmu_swinc(struct vpmu* vpmu, uint32_t mask)
+{
+    if (!(vpmu->pmcr & PMCR_EL0_E)) {
+        return;
+    }
+
+    mask &= vpmu->cntenset & (uint32_t)BIT32_MASK(0, vpmu->cntr_num);
+    for (size_t cntr = 0; cntr < vpmu->cntr_num; cntr++) {
+        /* Only counters programmed with the SW_INCR event (0x0) are affected */
+        if (bit32_get(mask, cntr) && (vpmu->cntrs[cntr].evtyper & PMEVTYPER_EVT_MASK) == 0) {
+            uint32_t value = vpmu_cntr_read(vpmu, cntr) + 1;
+            vpmu_cntr_write(vpmu, cntr, value);
+            if (value == 0) {
+                vpmu->ovs |= UINT32_C(1) << cntr;
+            }
+        }
+    }
+}
+
+static void vpmu_pmcr_write(struct vpmu* vpmu, uint64_t pmcr)
+{
+    if (pmcr & PMCR_EL0_P) {
+        for (size_t cntr = 0; cntr < vpmu->cntr_num; cntr++) {
+            vpmu_cntr_write(vpmu, cntr, 0);
+        }
+    }
+
+    if (pmcr & PMCR_EL0_C) {
+        sysreg_pmccntr_el0_write(0);
+    }
+
+    vpmu->pmcr = pmcr & VPMU_PMCR_RW_MSK;
+    vpmu_update_cntrs(vpmu);
+}
+
+static inline uint64_t vpmu_pmcr_read(struct vpmu* vpmu)
+{
+    return (sysreg_pmcr_el0_read() & PMCR_EL0_ID_MASK) |
+        ((vpmu->cntr_num << PMCR_EL0_N_POS) & PMCR_EL0_N_MASK) | vpmu->pmcr;
+}
+
+static bool vpmu_emul_evcntr(struct vpmu* vpmu, struct emul_access* acc, uint64_t* val)
+{
+    size_t crm = bit_extract(acc->addr, 1, 4);
+    size_t op2 = bit_extract(acc->addr, 17, 3);
+    size_t cntr = ((crm & 0x3) << 3) | op2;
+
+    if (crm < 12) {
+        /* PMEVCNTR<n>_EL0 */
+        if (acc->write) {
+            vpmu_cntr_write(vpmu, cntr, (uint32_t)*val);
+        } else {
+            *val = vpmu_cntr_read(vpmu, cntr);
+        }
+    } else {
+        /* PMEVTYPER<n>_EL0 */
+        if (acc->write) {
+            vpmu_evtyper_write(vpmu, cntr, (uint32_t)*val);
+        } else {
+            *val = vpmu->cntrs[cntr].evtyper;
+        }
+    }
+
+    return cntr < vpmu->cntr_num;
+}
+
+static bool vpmu_emul_handler(struct emul_access* acc)
+{
+    struct vpmu* vpmu = vpmu_get();
+    uint64_t val = acc->write ? vcpu_readreg(cpu()->vcpu, acc->reg) : 0;
+    uint32_t mask = vpmu_valid_mask(vpmu);
+
+    switch (acc->addr) {
+        case PMCR_EL0_ADDR:
+            if (acc->write) {
+                vpmu_pmcr_write(vpmu, val);
+            } else {
+                val = vpmu_pmcr_read(vpmu);
+            }
+            break;
+        case PMCNTENSET_EL0_ADDR:
+        case PMCNTENCLR_EL0_ADDR:
+            if (acc->write) {
+                if (acc->addr == PMCNTENSET_EL0_ADDR) {
+                    vpmu->cntenset |= (uint32_t)val & mask;
+                } else {
+                    vpmu->cntenset &= ~((uint32_t)val & mask);
+                }
+                vpmu_update_cntrs(vpmu);
+            } else {
+                val = vpmu->cntenset;
+            }
+            break;
+        case PMINTENSET_EL1_ADDR:
+        case PMINTENCLR_EL1_ADDR:
+            if (acc->write) {
+                if (acc->addr == PMINTENSET_EL1_ADDR) {
+                    vpmu->intenset |= (uint32_t)val & mask;
+                } else {
+                    vpmu->intenset &= ~((uint32_t)val & mask);
+                }
+                vpmu_update_cycle_cntr(vpmu);
+            } else {
+                val = vpmu->intenset;
+            }
+            break;
+        case PMOVSSET_EL0_ADDR:
+        case PMOVSCLR_EL0_ADDR:
+            vpmu_sync_ovs(vpmu);
+            if (acc->write) {
+                if (acc->addr == PMOVSSET_EL0_ADDR) {
+                    vpmu->ovs |= (uint32_t)val & mask;
+                } else {
+                    vpmu->ovs &= ~((uint32_t)val & mask);
+                }
+            } else {
+                val = vpmu->ovs;
+            }
+            break;
+        case PMSWINC_EL0_ADDR:
+            if (acc->write) {
+                vpmu_swinc(vpmu, (uint32_t)val);
+            }
+            break;
+        case PMSELR_EL0_ADDR:
+            if (acc->write) {
+                vpmu->selr = val & 0x1f;
+            } else {
+                val = vpmu->selr;
+            }
+            break;
+        case PMCEID0_EL0_ADDR:
+            val = sysreg_pmceid0_el0_read();
+            break;
+        case PMCEID1_EL0_ADDR:
+            val = sysreg_pmceid1_el0_read();
+            break;
+        case PMCCNTR_EL0_ADDR:
+            if (acc->write) {
+                sysreg_pmccntr_el0_write(val);
+            } else {
+                val = sysreg_pmccntr_el0_read();
+            }
+            break;
+        case PMUSERENR_EL0_ADDR:
+            if (acc->write) {
+                vpmu->userenr = val & 0xf;
+                sysreg_pmuserenr_el0_write(vpmu->userenr);
+            } else {
+                val = vpmu->userenr;
+            }
+            break;
+        case PMCCFILTR_EL0_ADDR:
+            if (acc->write) {
+                vpmu->ccfiltr = val & VPMU_CCFILTR_MSK;
+                sysreg_pmccfiltr_el0_write(vpmu->ccfiltr);
+            } else {
+                val = vpmu->ccfiltr;
+            }
+            break;
+        case PMXEVTYPER_EL0_ADDR:
+            if (vpmu->selr == PMU_CYCLE_CNTR) {
+                if (acc->write) {
+                    vpmu->ccfiltr = val & VPMU_CCFILTR_MSK;
+                    sysreg_pmccfiltr_el0_write(vpmu->ccfiltr);
+                } else {
+                    val = vpmu->ccfiltr;
+                }
+            } else if (vpmu->selr < vpmu->cntr_num) {
+                if (acc->write) {
+                    vpmu_evtyper_write(vpmu, vpmu->selr, (uint32_t)val);
+                } else {
+                    val = vpmu->cntrs[vpmu->selr].evtyper;
+                }
+            }
+            break;
+        case PMXEVCNTR_EL0_ADDR:
+            if (vpmu->selr < vpmu->cntr_num) {
+                if (acc->write) {
+                    vpmu_cntr_write(vpmu, vpmu->selr, (uint32_t)val);
+                } else {
+                    val = vpmu_cntr_read(vpmu, vpmu->selr);
+                }
+            }
+            break;
+        default:
+            if (!vpmu_emul_evcntr(vpmu, acc, &val)) {
+                return false;
+            }
+            break;
+    }
+
+    if (acc->write) {
+        vpmu_update_irq(cpu()->vcpu);
+    } else {
+        vcpu_writereg(cpu()->vcpu, acc->reg, val);
+    }
+
+    return true;
+}
+
+static inline size_t vpmu_hw_cntr_num(void)
+{
+    return (sysreg_pmcr_el0_read() & PMCR_EL0_N_MASK) >> PMCR_EL0_N_POS;
+}
+
+void vpmu_init(struct vm* vm)
+{
+    if (vm->config->platform.arch.pmu.interrupt_id == 0) {
+        return;
+    }
+
+    size_t cntr_num = min(vpmu_hw_cntr_num(), (size_t)VPMU_CNTR_MAX);
+    size_t emul = 0;
+
+    for (size_t i = 0; i < VPMU_EMUL_FIXED; i++) {
+        vm->arch.vpmu_emul[emul] =
+            (struct emul_reg){ .addr = vpmu_fixed_regs[i], .handler = vpmu_emul_handler };
+        vm_emul_add_reg(vm, &vm->arch.vpmu_emul[emul++]);
+    }
+
+    for (size_t i = 0; i < cntr_num; i++) {
+        vm->arch.vpmu_emul[emul] =
+            (struct emul_reg){ .addr = PMEVCNTR_EL0_ADDR(i), .handler = vpmu_emul_handler };
+        vm_emul_add_reg(vm, &vm->arch.vpmu_emul[emul++]);
+        vm->arch.vpmu_emul[emul] =
+            (struct emul_reg){ .addr = PMEVTYPER_EL0_ADDR(i), .handler = vpmu_emul_handler };
+        vm_emul_add_reg(vm, &vm->arch.vpmu_emul[emul++]);
+    }
+}
+
+void vpmu_vcpu_init(struct vcpu* vcpu)
+{
+    struct vpmu* vpmu = &vcpu->arch.vpmu;
+
+    vpmu->irq_id = vcpu->vm->config->platform.arch.pmu.interrupt_id;
+    if (!vpmu_enabled(vpmu)) {
+        return;
+    }
+
+    vpmu->cntr_num = min(vpmu_hw_cntr_num(), (size_t)VPMU_CNTR_MAX);
+
+    for (size_t cntr = 0; cntr < VPMU_CNTR_MAX; cntr++) {
+        vpmu->cntrs[cntr].counting = false;
+    }
+
+    events_cntr_set_owner(PMU_CYCLE_CNTR, EVENTS_OWNER_VPMU, vpmu_ovf_handler, NULL);
+    events_interrupt_enable(cpu()->id);
+
+    /* Trap all guest accesses to the PMU */
+    sysreg_mdcr_el2_write(sysreg_mdcr_el2_read() | MDCR_EL2_TPM | MDCR_EL2_TPMCR);
+}
+
+void vpmu_reset(struct vcpu* vcpu)
+{
+    struct vpmu* vpmu = &vcpu->arch.vpmu;
+
+    vpmu->pmcr = 0;
+    vpmu->cntenset = 0;
+    vpmu->intenset = 0;
+    vpmu->ovs = 0;
+    vpmu->selr = 0;
+    vpmu->userenr = 0;
+    vpmu->ccfiltr = 0;
+    vpmu->irq_level = false;
+
+    vpmu_update_cntrs(vpmu);
+
+    for (size_t cntr = 0; cntr < VPMU_CNTR_MAX; cntr++) {
+        vpmu->cntrs[cntr].value = 0;
+        vpmu->cntrs[cntr].evtyper = 0;
+    }
+
+    sysreg_pmuserenr_el0_write(0);
+    sysreg_pmccfiltr_el0_write(0);
+    sysreg_pmovsclr_el0_write(UINT64_C(1) << PMU_CYCLE_CNTR);
+}
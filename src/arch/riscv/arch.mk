@@ -18,6 +18,20 @@ irqc_arch_dir=$(cpu_arch_dir)/irqc/$(IRQC_DIR)
 src_dirs+=$(irqc_arch_dir)
 
 arch-cppflags+=-DIRQC=$(IRQC)
+
+# Set RISCV_ZAWRS=y for harts implementing Zawrs, so that wait loops stall on wrs.sto
+ifeq ($(RISCV_ZAWRS),y)
+arch-cppflags+=-DRISCV_ZAWRS
+endif
+# Set RISCV_ZICBOZ=y for harts implementing Zicboz, with cbo.zero enabled for HS-mode by the
+# firmware, so that memset zeroes large ranges a cache block at a time. Set
+# RISCV_CBOZ_BLOCK_SIZE to the platform's block size if it is not 64 bytes.
+ifeq ($(RISCV_ZICBOZ),y)
+arch-cppflags+=-DRISCV_ZICBOZ
+ifneq ($(RISCV_CBOZ_BLOCK_SIZE),)
+arch-cppflags+=-DRISCV_CBOZ_BLOCK_SIZE=$(RISCV_CBOZ_BLOCK_SIZE)
+endif
+endif
 arch-cflags = -mcmodel=medany -march=rv64g -mstrict-align
 arch-asflags =
 arch-ldflags = 
@@ -0,0 +1,76 @@
+/**
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (c) Bao Project and Contributors. All rights reserved.
+ */
+
+#ifndef __ARCH_ATOMIC_H__
+#define __ARCH_ATOMIC_H__
+
+#include <bao.h>
+
+static inline uint32_t atomic_load_acquire(volatile uint32_t* ptr)
+{
+    uint32_t val;
+
+    __asm__ volatile("lw     %0, %1\n\t"
+                     "fence  r, rw\n\t" : "=r"(val) : "A"(*ptr) : "memory");
+
+    return val;
+}
+
+static inline void atomic_store_release(volatile uint32_t* ptr, uint32_t val)
+{
+    __asm__ volatile("fence  rw, w\n\t"
+                     "sw     %1, %0\n\t" : "=A"(*ptr) : "r"(val) : "memory");
+}
+
+static inline uint32_t atomic_cmpxchg(volatile uint32_t* ptr, uint32_t expected, uint32_t desired)
+{
+    /* lr.w sign-extends the loaded word, so compare against the sign-extended expected value */
+    long cmp = (long)(int32_t)expected;
+    long val;
+    long temp;
+
+    __asm__ volatile("1:\n\t"
+                     "lr.w.aqrl  %0, %2\n\t"
+                     "bne        %0, %3, 2f\n\t"
+                     "sc.w.aqrl  %1, %4, %2\n\t"
+                     "bnez       %1, 1b\n\t"
+                     "2:\n\t" : "=&r"(val), "=&r"(temp), "+A"(*ptr) : "r"(cmp), "r"(desired)
+                     : "memory");
+
+    return (uint32_t)val;
+}
+
+static inline uint32_t atomic_fetch_add(volatile uint32_t* ptr, uint32_t val)
+{
+    long old;
+
+    __asm__ volatile("amoadd.w.aqrl  %0, %2, %1\n\t" : "=r"(old), "+A"(*ptr) : "r"(val)
+                     : "memory");
+
+    return (uint32_t)old;
+}
+
+#define RISCV_WRS_STO ".word 0x01d00073\n\t"
+#define RISCV_PAUSE   ".word 0x0100000f\n\t"
+
+/**
+ * With Zawrs (RISCV_ZAWRS=y), lr.w registers a reservation on *ptr and wrs.sto stalls the hart
+ * until it is invalidated by a write or a short timeout expires. Otherwise, just hint the hart
+ * that it is spinning (pause is a fence on harts without Zihintpause).
+ */
+static inline void atomic_wait_while_eq(volatile uint32_t* ptr, uint32_t val)
+{
+    long temp;
+
+    if (DEFINED(RISCV_ZAWRS)) {
+        __asm__ volatile("lr.w   %0, %1\n\t"
+                         "bne    %0, %2, 1f\n\t" RISCV_WRS_STO "1:\n\t"
+                         : "=&r"(temp) : "A"(*ptr), "r"((long)(int32_t)val) : "memory");
+    } else {
+        __asm__ volatile(RISCV_PAUSE ::: "memory");
+    }
+}
+
+#endif /* __ARCH_ATOMIC_H__ */
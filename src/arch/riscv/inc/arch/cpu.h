@@ -15,6 +15,7 @@ extern cpuid_t CPU_MASTER;
 struct cpu_arch {
     unsigned hart_id;
     unsigned plic_cntxt;
+    bool vector;
 };
 
 static inline struct cpu* cpu()
@@ -80,6 +80,13 @@
 #define SSTATUS_UPIE_BIT            (1ULL << 4)
 #define SSTATUS_SPIE_BIT            (1ULL << 5)
 #define SSTATUS_SPP_BIT             (1ULL << 8)
+#define SSTATUS_VS_OFF              (9)
+#define SSTATUS_VS_LEN              (2)
+#define SSTATUS_VS_MSK              BIT_MASK(SSTATUS_VS_OFF, SSTATUS_VS_LEN)
+#define SSTATUS_VS_AOFF             (0)
+#define SSTATUS_VS_INITIAL          (1ULL << SSTATUS_VS_OFF)
+#define SSTATUS_VS_CLEAN            (2ULL << SSTATUS_VS_OFF)
+#define SSTATUS_VS_DIRTY            (3ULL << SSTATUS_VS_OFF)
 #define SSTATUS_FS_OFF              (13)
 #define SSTATUS_FS_LEN              (2)
 #define SSTATUS_FS_MSK              BIT_MASK(SSTATUS_FS_OFF, SSTATUS_FS_LEN)
@@ -247,6 +254,7 @@ CSRS_GEN_ACCESSORS(sepc)
 CSRS_GEN_ACCESSORS(sie)
 CSRS_GEN_ACCESSORS(sip)
 CSRS_GEN_ACCESSORS(satp)
+CSRS_GEN_ACCESSORS(time)
 
 CSRS_GEN_ACCESSORS_NAMED(hstatus, CSR_HSTATUS)
 CSRS_GEN_ACCESSORS_NAMED(hgatp, CSR_HGATP)
@@ -30,6 +30,10 @@ struct arch_platform {
     struct {
         paddr_t base; // Base address of the ACLINT supervisor software interrupts
     } aclint_sswi;
+
+    struct {
+        uint64_t freq; // Frequency of the time CSR (timebase-frequency) in Hz
+    } timer;
 };
 
 #endif /* __ARCH_PLATFORM_H__ */
@@ -33,8 +33,11 @@ struct sbi_hsm {
     unsigned priv;
 };
 
+struct timer_event;
+
 void sbi_init(void);
 size_t sbi_vs_handler(void);
+void sbi_timer_event_handler(struct timer_event* event);
 
 void sbi_console_putchar(int ch);
 
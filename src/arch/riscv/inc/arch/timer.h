@@ -0,0 +1,46 @@
+/**
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (c) Bao Project and Contributors. All rights reserved
+ */
+
+#ifndef __ARCH_TIMER_H__
+#define __ARCH_TIMER_H__
+
+#include <bao.h>
+#include <platform.h>
+#include <arch/csrs.h>
+#include <arch/cpu.h>
+#include <arch/sbi.h>
+
+void timer_arch_init(void);
+irqid_t timer_arch_irq_id(void);
+
+static inline uint64_t timer_arch_get_counter(void)
+{
+    return csrs_time_read();
+}
+
+static inline uint64_t timer_arch_get_freq(void)
+{
+    return platform.arch.timer.freq;
+}
+
+/**
+ * With Sstc the hypervisor owns stimecmp directly. Otherwise, the deadline is forwarded to the
+ * SBI firmware, which also clears the pending supervisor timer interrupt.
+ */
+static inline void timer_arch_set_deadline(uint64_t deadline)
+{
+    if (CPU_HAS_EXTENSION(CPU_EXT_SSTC)) {
+        csrs_stimecmp_write(deadline);
+    } else {
+        sbi_set_timer(deadline);
+    }
+}
+
+static inline void timer_arch_disarm(void)
+{
+    timer_arch_set_deadline(~0ULL);
+}
+
+#endif /* __ARCH_TIMER_H__ */
@@ -10,6 +10,9 @@
 #include <platform.h>
 #include <arch/sbi.h>
 
+/* Above this many pages, ask for a full invalidation rather than one per page */
+#define TLB_INV_PAGES_MAX (64)
+
 /**
  * TODO: we are assuming platform.cpu_num is power of two. Make this not true.
  */
@@ -24,6 +27,15 @@ static inline void tlb_hyp_inv_all()
     sbi_remote_sfence_vma((1U << platform.cpu_num) - 1, 0, 0, 0);
 }
 
+static inline void tlb_hyp_inv_range(vaddr_t va, size_t size)
+{
+    if (NUM_PAGES(size) > TLB_INV_PAGES_MAX) {
+        tlb_hyp_inv_all();
+    } else {
+        sbi_remote_sfence_vma((1U << platform.cpu_num) - 1, 0, (unsigned long)va, size);
+    }
+}
+
 /**
  * TODO: change hart_mask to only take into account the vm physical cpus.
  */
@@ -38,4 +50,13 @@ static inline void tlb_vm_inv_all(asid_t vmid)
     sbi_remote_hfence_gvma_vmid((1U << platform.cpu_num) - 1, 0, 0, 0, vmid);
 }
 
+static inline void tlb_vm_inv_range(asid_t vmid, vaddr_t va, size_t size)
+{
+    if (NUM_PAGES(size) > TLB_INV_PAGES_MAX) {
+        tlb_vm_inv_all(vmid);
+    } else {
+        sbi_remote_hfence_gvma_vmid((1U << platform.cpu_num) - 1, 0, (unsigned long)va, size, vmid);
+    }
+}
+
 #endif /* __ARCH_TLB_H__ */
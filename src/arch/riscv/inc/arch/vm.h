@@ -10,6 +10,7 @@
 #include <irqc.h>
 #include <arch/sbi.h>
 #include <arch/interrupts.h>
+#include <timer.h>
 
 #define REG_RA  (1)
 #define REG_SP  (2)
@@ -69,6 +70,7 @@ struct vm_arch {
 struct vcpu_arch {
     vcpuid_t hart_id;
     struct sbi_hsm sbi_ctx;
+    struct timer_event sbi_timer;
 };
 
 struct arch_regs {
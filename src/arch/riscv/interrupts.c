@@ -9,6 +9,7 @@
 #include <irqc.h>
 #include <arch/sbi.h>
 #include <cpu.h>
+#include <exit_stats.h>
 #include <mem.h>
 #include <platform.h>
 #include <vm.h>
@@ -47,6 +48,22 @@ void interrupts_arch_ipi_send(cpuid_t target_cpu, irqid_t ipi_id)
     }
 }
 
+void interrupts_arch_ipi_send_mask(cpumap_t targets, irqid_t ipi_id)
+{
+    UNUSED_ARG(ipi_id);
+
+    if (ACLINT_PRESENT()) {
+        for (cpuid_t cpu_id = 0; cpu_id < platform.cpu_num; cpu_id++) {
+            if (targets & (1UL << cpu_id)) {
+                aclint_send_ipi(cpu_id);
+            }
+        }
+    } else if (targets != 0) {
+        /* One SBI call signals every hart in the mask */
+        sbi_send_ipi(targets, 0);
+    }
+}
+
 void interrupts_arch_enable(irqid_t int_id, bool en)
 {
     if (int_id == SOFT_INT_ID) {
@@ -70,6 +87,9 @@ void interrupts_arch_handle(void)
 {
     unsigned long _scause = csrs_scause_read();
 
+    exit_stats_begin();
+    exit_stats_classify(EXIT_REASON_IRQ, _scause & SCAUSE_CODE_MSK);
+
     switch (_scause) {
         case SCAUSE_CODE_SSI:
             csrs_sip_clear(SIP_SSIP);
@@ -92,6 +112,8 @@ void interrupts_arch_handle(void)
             // WARNING("unkown interrupt");
             break;
     }
+
+    exit_stats_end();
 }
 
 bool interrupts_arch_check(irqid_t int_id)
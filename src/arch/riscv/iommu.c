@@ -7,7 +7,7 @@
 #include <config.h>
 #include <interrupts.h>
 #include <string.h>
-#include <arch/spinlock.h>
+#include <spinlock.h>
 #include <bitmap.h>
 
 // We initially use a 1-LVL DDT with DC in extended format
@@ -8,7 +8,7 @@
 
 #include <bao.h>
 #include <aplic.h>
-#include <arch/spinlock.h>
+#include <spinlock.h>
 #include <bitmap.h>
 #include <emul.h>
 
@@ -9,6 +9,7 @@
 #include <emul.h>
 #include <mem.h>
 #include <interrupts.h>
+#include <irq_lat.h>
 #include <arch/csrs.h>
 
 #define APLIC_MIN_PRIO             (0xFF)
@@ -845,6 +846,8 @@ static uint32_t vaplic_get_claimi(struct vcpu* vcpu, idcid_t idc_id)
     if (idc_id < vaplic->idc_num) {
         ret = vaplic->topi_claimi[idc_id];
         CLR_INTP_REG(vaplic->ip, (ret >> IDC_CLAIMI_INTP_ID_SHIFT));
+        /* In direct delivery mode claiming is the last step the guest takes on an interrupt */
+        irq_lat_complete((irqid_t)(ret >> IDC_CLAIMI_INTP_ID_SHIFT), 0);
         /** Spurious intp*/
         if (ret == 0) {
             bitmap_clear(vaplic->iforce, idc_id);
@@ -1117,6 +1120,7 @@ void vaplic_inject(struct vcpu* vcpu, irqid_t intp_id)
     spin_lock(&vaplic->lock);
     /** If the intp was successfully injected, update the heart line. */
     if (vaplic_set_pend(vcpu, intp_id)) {
+        irq_lat_inject(intp_id, 0, vcpu->mem_throt.throttled);
         vaplic_update_hart(vcpu, vaplic_get_hart_index(vcpu, intp_id));
     }
     spin_unlock(&vaplic->lock);
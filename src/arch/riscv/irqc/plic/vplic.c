@@ -9,6 +9,7 @@
 #include <mem.h>
 #include <vm.h>
 #include <interrupts.h>
+#include <irq_lat.h>
 #include <arch/csrs.h>
 
 static ssize_t vplic_vcntxt_to_pcntxt(struct vcpu* vcpu, size_t vcntxt_id)
@@ -221,6 +222,7 @@ static void vplic_complete(struct vcpu* vcpu, size_t vcntxt, irqid_t int_id)
 {
     if (vplic_get_hw(vcpu, int_id)) {
         plic_hart[cpu()->arch.plic_cntxt].complete = int_id;
+        irq_lat_complete(int_id, 0);
     }
 
     spin_lock(&vcpu->vm->arch.vplic.lock);
@@ -241,6 +243,7 @@ void vplic_inject(struct vcpu* vcpu, irqid_t id)
             struct plic_cntxt vcntxt = { vcpu->id, PRIV_S };
             ssize_t vcntxt_id = plic_plat_cntxt_to_id(vcntxt);
             vplic_update_hart_line(vcpu, (size_t)vcntxt_id);
+            irq_lat_inject(id, 0, vcpu->mem_throt.throttled);
         } else {
             for (size_t i = 0; i < vplic->cntxt_num; i++) {
                 if (plic_plat_id_to_cntxt(i).mode != PRIV_S) {
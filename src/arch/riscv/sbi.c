@@ -10,6 +10,7 @@
 #include <bit.h>
 #include <fences.h>
 #include <hypercall.h>
+#include <exit_stats.h>
 
 #define SBI_EXTID_BASE                  (0x10)
 #define SBI_GET_SBI_SPEC_VERSION_FID    (0)
@@ -208,18 +209,22 @@ static struct sbiret sbi_time_handler(unsigned long fid)
     if (CPU_HAS_EXTENSION(CPU_EXT_SSTC)) {
         csrs_vstimecmp_write(stime_value);
     } else {
-        sbi_set_timer(stime_value); // assumes always success
+        /**
+         * Without Sstc the supervisor timer is shared with the hypervisor, so the guest deadline
+         * is multiplexed as just another event in the cpu's timer queue.
+         */
         csrs_hvip_clear(HIP_VSTIP);
-        csrs_sie_set(SIE_STIE);
+        timer_event_add(&cpu()->vcpu->arch.sbi_timer, stime_value);
     }
 
     return (struct sbiret){ SBI_SUCCESS };
 }
 
-static void sbi_timer_irq_handler()
+void sbi_timer_event_handler(struct timer_event* event)
 {
+    UNUSED_ARG(event);
+
     csrs_hvip_set(HIP_VSTIP);
-    csrs_sie_clear(SIE_STIE);
 }
 
 static struct sbiret sbi_ipi_handler(unsigned long fid)
@@ -235,17 +240,20 @@ static struct sbiret sbi_ipi_handler(unsigned long fid)
         .handler = (uint32_t)SBI_MSG_ID,
         .event = SEND_IPI,
     };
+    cpumap_t phart_mask = 0;
 
     for (size_t i = 0; i < sizeof(hart_mask) * 8; i++) {
         if (bit_get(hart_mask, i)) {
             vcpuid_t vhart_id = hart_mask_base + i;
             cpuid_t phart_id = vm_translate_to_pcpuid(cpu()->vcpu->vm, vhart_id);
             if (phart_id != INVALID_CPUID) {
-                cpu_send_msg(phart_id, &msg);
+                phart_mask |= 1UL << phart_id;
             }
         }
     }
 
+    cpu_send_msg_mask(phart_mask, &msg);
+
     return (struct sbiret){ SBI_SUCCESS };
 }
 
@@ -406,6 +414,8 @@ size_t sbi_vs_handler()
     unsigned long fid = vcpu_readreg(cpu()->vcpu, REG_A6);
     struct sbiret ret;
 
+    exit_stats_classify(EXIT_REASON_HVC, extid);
+
     switch (extid) {
         case SBI_EXTID_BASE:
             ret = sbi_base_handler(fid);
@@ -452,8 +462,4 @@ void sbi_init()
             ERROR("sbi does not support ext 0x%x", ext_table[i]);
         }
     }
-
-    if (!interrupts_reserve(TIMR_INT_ID, sbi_timer_irq_handler)) {
-        ERROR("Failed to reserve SBI TIMR_INT_ID interrupt");
-    }
 }
@@ -9,6 +9,8 @@
 #include <arch/encoding.h>
 #include <arch/csrs.h>
 #include <arch/instructions.h>
+#include <trace.h>
+#include <exit_stats.h>
 
 static void internal_exception_handler(unsigned long gprs[])
 {
@@ -82,8 +84,16 @@ static size_t guest_page_fault_handler()
 {
     vaddr_t addr = csrs_htval_read() << 2;
 
-    emul_handler_t handler = vm_emul_get_mem(cpu()->vcpu->vm, addr);
-    if (handler != NULL) {
+    /* First accesses to lazily mapped memory, including by the guest's page table walks */
+    if (vm_mem_fault(cpu()->vcpu->vm, addr)) {
+        return 0;
+    }
+
+    struct emul_mem* emu = vm_emul_get_mem_region(cpu()->vcpu->vm, addr);
+    if (emu != NULL) {
+        emul_handler_t handler = emu->handler;
+        exit_stats_classify(EXIT_REASON_MMIO, emu->va_base);
+
         unsigned long ins = csrs_htinst_read();
         size_t ins_size;
         if (ins == 0) {
@@ -117,6 +127,7 @@ static size_t guest_page_fault_handler()
          */
 
         if (handler(&emul)) {
+            TRACE_EVENT(MMIO, TRACE_MMIO, emul.write, addr, vcpu_readreg(cpu()->vcpu, emul.reg));
             return ins_size;
         } else {
             ERROR("emulation handler failed (0x%x at 0x%x)", addr, csrs_sepc_read());
@@ -126,8 +137,21 @@ static size_t guest_page_fault_handler()
     }
 }
 
+static size_t guest_inst_page_fault_handler()
+{
+    vaddr_t addr = csrs_htval_read() << 2;
+
+    if (!vm_mem_fault(cpu()->vcpu->vm, addr)) {
+        ERROR("no handler for instruction guest page fault (0x%x at 0x%x)", addr,
+            csrs_sepc_read());
+    }
+
+    return 0;
+}
+
 sync_handler_t sync_handler_table[] = {
     [SCAUSE_CODE_ECV] = sbi_vs_handler,
+    [SCAUSE_CODE_IGPF] = guest_inst_page_fault_handler,
     [SCAUSE_CODE_LGPF] = guest_page_fault_handler,
     [SCAUSE_CODE_SGPF] = guest_page_fault_handler,
 };
@@ -140,12 +164,16 @@ void sync_exception_handler(void)
     size_t pc_step = 0;
     unsigned long _scause = csrs_scause_read();
 
+    exit_stats_begin();
+
     if (!(csrs_hstatus_read() & HSTATUS_SPV)) {
         internal_exception_handler(&cpu()->vcpu->regs.x[0]);
     }
 
     // TODO: Do we need to check call comes from VS-mode and not VU-mode or U-mode ?
 
+    TRACE_EVENT(EXIT, TRACE_VM_EXIT, _scause, csrs_htval_read(), csrs_stval_read());
+
     if (_scause < sync_handler_table_size && sync_handler_table[_scause]) {
         pc_step = sync_handler_table[_scause]();
     } else {
@@ -153,4 +181,6 @@ void sync_exception_handler(void)
     }
 
     cpu()->vcpu->regs.sepc += pc_step;
+
+    exit_stats_end();
 }
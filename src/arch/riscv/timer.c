@@ -0,0 +1,17 @@
+/**
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (c) Bao Project and Contributors. All rights reserved
+ */
+
+#include <arch/timer.h>
+#include <arch/interrupts.h>
+
+void timer_arch_init(void)
+{
+    timer_arch_disarm();
+}
+
+irqid_t timer_arch_irq_id(void)
+{
+    return TIMR_INT_ID;
+}
@@ -30,6 +30,8 @@ void vcpu_arch_init(struct vcpu* vcpu, struct vm* vm)
 
     vcpu->arch.sbi_ctx.lock = SPINLOCK_INITVAL;
     vcpu->arch.sbi_ctx.state = vcpu->id == 0 ? STARTED : STOPPED;
+
+    timer_event_init(&vcpu->arch.sbi_timer, sbi_timer_event_handler, vcpu);
 }
 
 void vcpu_arch_reset(struct vcpu* vcpu, vaddr_t entry)
@@ -45,12 +47,23 @@ void vcpu_arch_reset(struct vcpu* vcpu, vaddr_t entry)
     vcpu->regs.a1 = 0; // according to sbi it should be the dtb load address
 
     if (CPU_HAS_EXTENSION(CPU_EXT_SSTC)) {
-        csrs_stimecmp_write(~0U);
+        csrs_vstimecmp_write(~0ULL);
+    } else {
+        timer_event_cancel(&vcpu->arch.sbi_timer);
     }
 
     csrs_hcounteren_write(HCOUNTEREN_TM);
     csrs_htimedelta_write(0);
     csrs_vsstatus_write(SSTATUS_SD | SSTATUS_FS_DIRTY | SSTATUS_XS_DIRTY);
+
+    /**
+     * When V=1 both sstatus.VS and vsstatus.VS gate guest vector instructions, so both must be
+     * enabled for the guest to use the vector extension.
+     */
+    if (cpu()->arch.vector) {
+        vcpu->regs.sstatus |= SSTATUS_VS_INITIAL;
+        csrs_vsstatus_set(SSTATUS_VS_INITIAL);
+    }
     csrs_hie_write(0);
     csrs_vstvec_write(0);
     csrs_vsscratch_write(0);
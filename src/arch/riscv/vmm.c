@@ -39,6 +39,16 @@ void vmm_arch_init()
         csrs_henvcfg_clear(HENVCFG_STCE);
     }
 
+    /**
+     * Detect the vector extension. sstatus.VS is WARL and hardwired to zero when V is not
+     * implemented, so probe it by trying to set it. The hypervisor itself is built without vector
+     * support and each vcpu owns its physical hart, so the vector register file is left untouched
+     * (and never saved/restored) and VS is turned off again for the hypervisor.
+     */
+    csrs_sstatus_set(SSTATUS_VS_INITIAL);
+    cpu()->arch.vector = (csrs_sstatus_read() & SSTATUS_VS_MSK) != 0;
+    csrs_sstatus_clear(SSTATUS_VS_MSK);
+
     /**
      * TODO: consider delegating other exceptions e.g. breakpoint or ins misaligned
      */
@@ -4,6 +4,7 @@
  */
 
 #include <cache.h>
+#include <string.h>
 
 static struct cache cache_dscr;
 
@@ -47,3 +48,8 @@ void cache_enumerate(void)
     cache_arch_enumerate(&cache_dscr);
     cache_calc_colors(&cache_dscr, PAGE_SIZE);
 }
+
+__attribute__((weak)) void cache_copy_stream(void* dst, const void* src, size_t size)
+{
+    memcpy(dst, src, size);
+}
@@ -6,21 +6,10 @@
 #include <cpu.h>
 #include <interrupts.h>
 #include <platform.h>
-#include <objpool.h>
 #include <vm.h>
 #include <fences.h>
-
-struct cpu_msg_node {
-    node_t node;
-    struct cpu_msg msg;
-};
-
-#define CPU_MSG_POOL_SIZE_DEFAULT (128)
-#ifndef CPU_MSG_POOL_SIZE
-#define CPU_MSG_POOL_SIZE CPU_MSG_POOL_SIZE_DEFAULT
-#endif
-
-OBJPOOL_ALLOC(msg_pool, struct cpu_msg_node, CPU_MSG_POOL_SIZE);
+#include <atomic.h>
+#include <trace.h>
 
 struct cpu_synctoken cpu_glb_sync = { .ready = false };
 
@@ -31,6 +20,66 @@ size_t ipi_cpumsg_handler_num;
 
 struct cpuif cpu_interfaces[PLAT_CPU_NUM];
 
+/**
+ * The message rings follow D. Vyukov's bounded queue. Each slot's sequence number tells whose turn
+ * it is: it equals the ring position a producer must claim to fill the slot, and that position
+ * plus one once the message is ready to be consumed. Producers claim positions by advancing the
+ * tail with a compare-and-swap, so there is neither allocation nor a shared lock on the send path.
+ * Dequeuing returns the slot to the producer that will claim it on the next lap.
+ */
+
+static void cpu_msg_ring_init(struct cpu_msg_ring* ring)
+{
+    ring->tail = 0;
+    ring->signalled = false;
+    for (uint32_t i = 0; i < CPU_MSG_RING_SIZE; i++) {
+        ring->slots[i].seq = i;
+    }
+}
+
+static bool cpu_msg_ring_push(struct cpu_msg_ring* ring, struct cpu_msg* msg)
+{
+    uint32_t pos = atomic_load_acquire(&ring->tail);
+    struct cpu_msg_slot* slot;
+
+    while (true) {
+        slot = &ring->slots[pos % CPU_MSG_RING_SIZE];
+        int32_t diff = (int32_t)(atomic_load_acquire(&slot->seq) - pos);
+        if (diff == 0) {
+            uint32_t tail = atomic_cmpxchg(&ring->tail, pos, pos + 1);
+            if (tail == pos) {
+                break;
+            }
+            pos = tail;
+        } else if (diff < 0) {
+            /* The slot still holds the message from the previous lap: the ring is full */
+            return false;
+        } else {
+            pos = atomic_load_acquire(&ring->tail);
+        }
+    }
+
+    slot->msg = *msg;
+    atomic_store_release(&slot->seq, pos + 1);
+
+    return true;
+}
+
+static bool cpu_msg_ring_pop(struct cpu_msg_ring* ring, uint32_t* head, struct cpu_msg* msg)
+{
+    struct cpu_msg_slot* slot = &ring->slots[*head % CPU_MSG_RING_SIZE];
+
+    if (atomic_load_acquire(&slot->seq) != (*head + 1)) {
+        return false;
+    }
+
+    *msg = slot->msg;
+    atomic_store_release(&slot->seq, *head + CPU_MSG_RING_SIZE);
+    (*head)++;
+
+    return true;
+}
+
 void cpu_init(cpuid_t cpu_id, paddr_t load_addr)
 {
     cpu()->id = cpu_id;
@@ -39,7 +88,8 @@ void cpu_init(cpuid_t cpu_id, paddr_t load_addr)
 
     cpu_arch_init(cpu_id, load_addr);
 
-    list_init(&cpu()->interface->event_list);
+    cpu_msg_ring_init(&cpu()->interface->msg_ring);
+    cpu()->msg_head = 0;
 
     if (cpu_is_master()) {
         cpu_sync_init(&cpu_glb_sync, platform.cpu_num);
@@ -53,34 +103,79 @@ void cpu_init(cpuid_t cpu_id, paddr_t load_addr)
     cpu_sync_barrier(&cpu_glb_sync);
 }
 
+static void cpu_msg_signal(cpumap_t* pending)
+{
+    if (*pending != 0) {
+        fence_sync_write();
+        interrupts_cpu_sendipi_mask(*pending, IPI_CPU_MSG);
+        *pending = 0;
+    }
+}
+
+/**
+ * Queue msg on the target's ring and add the target to pending if it must be signalled. A target
+ * is only signalled for the first message queued since it last started draining its ring: it will
+ * find any later ones in the same pass.
+ *
+ * A full ring is a fatal error, as running out of message nodes was before the rings. The sender
+ * must not wait for the target to drain it: the target may itself be waiting on the sender, or
+ * need a lock the sender holds. Each ring holds as many messages as the old global pool did, so
+ * any load that pool could take can not fill a ring.
+ */
+static void cpu_msg_enqueue(cpuid_t trgtcpu, struct cpu_msg* msg, cpumap_t* pending)
+{
+    struct cpu_msg_ring* ring = &cpu_if(trgtcpu)->msg_ring;
+
+    TRACE_EVENT(IPI, TRACE_IPI_SEND, trgtcpu, msg->handler, msg->event);
+
+    if (!cpu_msg_ring_push(ring, msg)) {
+        ERROR("cpu%d message ring full (handler %d, event %d)", trgtcpu, msg->handler,
+            msg->event);
+    }
+
+    if (atomic_cmpxchg(&ring->signalled, false, true) == false) {
+        *pending |= 1UL << trgtcpu;
+    }
+}
+
 void cpu_send_msg(cpuid_t trgtcpu, struct cpu_msg* msg)
 {
-    struct cpu_msg_node* node = objpool_alloc(&msg_pool);
-    if (node == NULL) {
-        ERROR("cant allocate msg node");
+    cpumap_t pending = 0;
+
+    cpu_msg_enqueue(trgtcpu, msg, &pending);
+    cpu_msg_signal(&pending);
+}
+
+/* Send msg to every cpu in cpus, signalling them all at once */
+void cpu_send_msg_mask(cpumap_t cpus, struct cpu_msg* msg)
+{
+    cpumap_t pending = 0;
+
+    for (cpuid_t cpu_id = 0; cpu_id < platform.cpu_num; cpu_id++) {
+        if (cpus & (1UL << cpu_id)) {
+            cpu_msg_enqueue(cpu_id, msg, &pending);
+        }
     }
-    node->msg = *msg;
-    list_push(&cpu_if(trgtcpu)->event_list, (node_t*)node);
-    fence_sync_write();
-    interrupts_cpu_sendipi(trgtcpu, IPI_CPU_MSG);
+
+    cpu_msg_signal(&pending);
 }
 
 bool cpu_get_msg(struct cpu_msg* msg)
 {
-    struct cpu_msg_node* node = NULL;
-    if ((node = (struct cpu_msg_node*)list_pop(&cpu()->interface->event_list)) != NULL) {
-        *msg = node->msg;
-        objpool_free(&msg_pool, node);
-        return true;
-    }
-    return false;
+    return cpu_msg_ring_pop(&cpu()->interface->msg_ring, &cpu()->msg_head, msg);
 }
 
 void cpu_msg_handler(void)
 {
     cpu()->handling_msgs = true;
+
+    /* Re-arm signalling before draining, so that messages queued from now on raise a new IPI */
+    atomic_store_release(&cpu()->interface->msg_ring.signalled, false);
+    fence_ord();
+
     struct cpu_msg msg;
     while (cpu_get_msg(&msg)) {
+        TRACE_EVENT(IPI, TRACE_IPI_RECV, 0, msg.handler, msg.event);
         if (msg.handler < ipi_cpumsg_handler_num && ipi_cpumsg_handlers[msg.handler]) {
             ipi_cpumsg_handlers[msg.handler](msg.event, msg.data);
         }
@@ -88,6 +183,27 @@ void cpu_msg_handler(void)
     cpu()->handling_msgs = false;
 }
 
+void cpu_sync_wait(struct cpu_synctoken* token, uint32_t gen, bool handle_msgs)
+{
+    uint64_t timeout = timer_get_ticks() + timer_us_to_ticks(CPU_SYNC_TIMEOUT_US);
+    bool warned = false;
+
+    while (atomic_load_acquire(&token->gen) == gen) {
+        if (!handle_msgs) {
+            atomic_wait_while_eq(&token->gen, gen);
+        } else if (!cpu()->handling_msgs) {
+            /* Message IPIs are masked here and would not wake up a waiting cpu, so poll instead */
+            cpu_msg_handler();
+        }
+
+        if (!warned && (timer_get_ticks() > timeout)) {
+            WARNING("cpu%d: waiting on barrier for over %dus, %d of %d cpus arrived", cpu()->id,
+                CPU_SYNC_TIMEOUT_US, token->count, token->n);
+            warned = true;
+        }
+    }
+}
+
 void cpu_idle(void)
 {
     if(cpu()->is_handling_irq)
@@ -0,0 +1,328 @@
+/**
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (c) Bao Project and Contributors. All rights reserved
+ */
+
+#include <events.h>
+#include <cpu.h>
+#include <trace.h>
+#include <exit_stats.h>
+
+static inline struct events_mux* events_mux_get(void)
+{
+    return &cpu()->events_mux;
+}
+
+/* Scale count by enabled/running without overflowing 64-bit intermediates */
+static uint64_t events_scale(uint64_t count, uint64_t enabled, uint64_t running)
+{
+    if (running == 0) {
+        return 0;
+    }
+    if (running >= enabled) {
+        return count;
+    }
+
+    while ((enabled >> 32) != 0) {
+        enabled >>= 1;
+        running >>= 1;
+    }
+    if (running == 0) {
+        return 0;
+    }
+
+    return ((count / running) * enabled) + (((count % running) * enabled) / running);
+}
+
+static void events_vcntr_update(struct events_vcntr* vcntr, uint64_t now)
+{
+    uint64_t delta = now - vcntr->timestamp;
+
+    vcntr->time_enabled += delta;
+    if (vcntr->hw_cntr != EVENTS_VCNTR_UNMAPPED) {
+        vcntr->time_running += delta;
+        /**
+         * The hardware counter holds phase + count as of the last fold, so what it counted since
+         * is the difference, modulo its 32 bits. The mux timer folds often enough for it not to
+         * wrap twice in between.
+         */
+        uint32_t hw_value = (uint32_t)events_get_cntr_value(vcntr->hw_cntr);
+        vcntr->count += (uint32_t)(hw_value - (uint32_t)(vcntr->phase + vcntr->count));
+    }
+    vcntr->timestamp = now;
+}
+
+static void events_vcntr_map(struct events_vcntr* vcntr, size_t hw_cntr)
+{
+    vcntr->hw_cntr = hw_cntr;
+    events_cntr_irq_disable(hw_cntr);
+    if (vcntr->raw) {
+        events_set_evtyper_raw(hw_cntr, vcntr->evtyper);
+    } else {
+        events_set_evtyper(hw_cntr, vcntr->event);
+    }
+    events_cntr_write(hw_cntr, (uint32_t)(vcntr->phase + vcntr->count));
+    events_clear_cntr_ovs(hw_cntr);
+    events_cntr_set_owner(hw_cntr, vcntr->owner, vcntr->handler, vcntr->ctx);
+    if (vcntr->handler != NULL) {
+        events_cntr_irq_enable(hw_cntr);
+    }
+    events_cntr_enable(hw_cntr);
+}
+
+static void events_vcntr_unmap(struct events_vcntr* vcntr)
+{
+    size_t hw_cntr = vcntr->hw_cntr;
+
+    events_cntr_disable(hw_cntr);
+    events_cntr_irq_disable(hw_cntr);
+    vcntr->hw_cntr = EVENTS_VCNTR_UNMAPPED;
+
+    /* An overflow not taken as an interrupt yet is handed over before the counter is reused */
+    if (events_cntr_ovs(hw_cntr)) {
+        events_clear_cntr_ovs(hw_cntr);
+        if (vcntr->handler != NULL) {
+            vcntr->handler(hw_cntr, vcntr->ctx);
+        }
+    }
+    events_cntr_set_owner(hw_cntr, EVENTS_OWNER_TELEMETRY, NULL, NULL);
+}
+
+static void events_mux_unmap_all(struct events_mux* mux)
+{
+    uint64_t now = timer_get_ticks();
+
+    for (size_t i = 0; i < mux->vcntr_num; i++) {
+        events_vcntr_update(mux->vcntrs[i], now);
+        if (mux->vcntrs[i]->hw_cntr != EVENTS_VCNTR_UNMAPPED) {
+            events_vcntr_unmap(mux->vcntrs[i]);
+        }
+    }
+}
+
+/**
+ * Map a window of hw_cntr_num virtual counters starting at mux->next. The timer runs whenever any
+ * virtual counter exists, both to rotate the window and to fold hardware counts before they wrap.
+ */
+static void events_mux_schedule(struct events_mux* mux)
+{
+    events_mux_unmap_all(mux);
+
+    if (mux->vcntr_num == 0) {
+        timer_event_cancel(&mux->timer);
+        return;
+    }
+
+    size_t mapped = min(mux->hw_cntr_num, mux->vcntr_num);
+    for (size_t i = 0; i < mapped; i++) {
+        events_vcntr_map(mux->vcntrs[(mux->next + i) % mux->vcntr_num], mux->hw_cntrs[i]);
+    }
+
+    if (!timer_event_pending(&mux->timer)) {
+        timer_event_add_us(&mux->timer, EVENTS_MUX_PERIOD_US);
+    }
+}
+
+static void events_mux_timer_handler(struct timer_event* event)
+{
+    struct events_mux* mux = (struct events_mux*)event->data;
+
+    if (mux->vcntr_num > mux->hw_cntr_num) {
+        mux->next = (mux->next + mux->hw_cntr_num) % mux->vcntr_num;
+        events_mux_schedule(mux);
+    } else if (mux->vcntr_num > 0) {
+        uint64_t now = timer_get_ticks();
+        for (size_t i = 0; i < mux->vcntr_num; i++) {
+            events_vcntr_update(mux->vcntrs[i], now);
+        }
+        timer_event_add_us(event, EVENTS_MUX_PERIOD_US);
+    }
+}
+
+/* Take free hardware counters until every virtual counter has one, or none are left */
+static void events_mux_grow(struct events_mux* mux)
+{
+    while (mux->hw_cntr_num < mux->vcntr_num) {
+        size_t hw_cntr = events_arch_cntr_alloc();
+        if (hw_cntr == (size_t)ERROR_NO_MORE_EVENT_COUNTERS) {
+            break;
+        }
+        events_cntr_set_owner(hw_cntr, EVENTS_OWNER_TELEMETRY, NULL, NULL);
+        mux->hw_cntrs[mux->hw_cntr_num++] = hw_cntr;
+    }
+}
+
+/* Give back hardware counters that no virtual counter needs */
+static void events_mux_shrink(struct events_mux* mux)
+{
+    while (mux->hw_cntr_num > mux->vcntr_num) {
+        events_cntr_free(mux->hw_cntrs[--mux->hw_cntr_num]);
+    }
+}
+
+size_t events_cntr_alloc(void)
+{
+    struct events_mux* mux = events_mux_get();
+    size_t counter = events_arch_cntr_alloc();
+
+    /**
+     * Pinned counters take precedence over virtual ones. If the hardware is exhausted, reclaim a
+     * counter from the multiplexer: its virtual counters keep counting, just for less time.
+     */
+    if ((counter == (size_t)ERROR_NO_MORE_EVENT_COUNTERS) && (mux->hw_cntr_num > 0)) {
+        events_mux_unmap_all(mux);
+        counter = mux->hw_cntrs[--mux->hw_cntr_num];
+        if (mux->vcntr_num > 0) {
+            mux->next %= mux->vcntr_num;
+        }
+        events_mux_schedule(mux);
+    }
+
+    return counter;
+}
+
+void events_cntr_free(size_t counter)
+{
+    events_cntr_set_owner(counter, EVENTS_OWNER_NONE, NULL, NULL);
+    events_arch_cntr_free(counter);
+}
+
+void events_cntr_set_owner(size_t counter, events_owner_t owner, events_ovf_handler_t handler,
+    void* ctx)
+{
+    struct events_cntr_owner* cntr_owner = &cpu()->events_owners[counter];
+
+    cntr_owner->owner = owner;
+    cntr_owner->handler = handler;
+    cntr_owner->ctx = ctx;
+}
+
+static void events_dispatch(uint64_t ovs)
+{
+    while (ovs != 0) {
+        size_t counter = (size_t)__builtin_ctzll(ovs);
+        struct events_cntr_owner* cntr_owner = &cpu()->events_owners[counter];
+
+        ovs &= ovs - 1;
+        if (cntr_owner->handler != NULL) {
+            cntr_owner->handler(counter, cntr_owner->ctx);
+        }
+    }
+}
+
+/* Called by the arch PMU interrupt handler with the (already acknowledged) overflowed counters */
+void events_handle_overflow(uint64_t ovs)
+{
+    uint64_t regulator = 0;
+
+    TRACE_EVENT(PMU, TRACE_PMU_OVERFLOW, 0, ovs, 0);
+    exit_stats_classify(EXIT_REASON_PMU, 0);
+
+    for (uint64_t pending = ovs; pending != 0; pending &= pending - 1) {
+        size_t counter = (size_t)__builtin_ctzll(pending);
+        if (cpu()->events_owners[counter].owner == EVENTS_OWNER_REGULATOR) {
+            regulator |= (uint64_t)1 << counter;
+        }
+    }
+
+    events_dispatch(ovs & ~regulator);
+    events_dispatch(regulator);
+}
+
+static bool events_vcntr_insert(struct events_vcntr* vcntr)
+{
+    struct events_mux* mux = events_mux_get();
+
+    if (mux->vcntr_num >= EVENTS_VCNTR_MAX) {
+        return false;
+    }
+
+    if (mux->timer.handler == NULL) {
+        timer_event_init(&mux->timer, events_mux_timer_handler, mux);
+    }
+
+    events_enable();
+
+    vcntr->hw_cntr = EVENTS_VCNTR_UNMAPPED;
+    vcntr->count = 0;
+    vcntr->time_enabled = 0;
+    vcntr->time_running = 0;
+    vcntr->timestamp = timer_get_ticks();
+
+    mux->vcntrs[mux->vcntr_num++] = vcntr;
+    events_mux_grow(mux);
+    events_mux_schedule(mux);
+
+    return true;
+}
+
+bool events_vcntr_add(struct events_vcntr* vcntr, events_enum event)
+{
+    vcntr->event = event;
+    vcntr->raw = false;
+    vcntr->phase = 0;
+    vcntr->owner = EVENTS_OWNER_TELEMETRY;
+    vcntr->handler = NULL;
+    vcntr->ctx = NULL;
+
+    return events_vcntr_insert(vcntr);
+}
+
+bool events_vcntr_add_raw(struct events_vcntr* vcntr, uint64_t evtyper, uint32_t phase,
+    events_owner_t owner, events_ovf_handler_t handler, void* ctx)
+{
+    vcntr->raw = true;
+    vcntr->evtyper = evtyper;
+    vcntr->phase = phase;
+    vcntr->owner = owner;
+    vcntr->handler = handler;
+    vcntr->ctx = ctx;
+
+    return events_vcntr_insert(vcntr);
+}
+
+void events_vcntr_remove(struct events_vcntr* vcntr)
+{
+    struct events_mux* mux = events_mux_get();
+
+    events_mux_unmap_all(mux);
+
+    for (size_t i = 0; i < mux->vcntr_num; i++) {
+        if (mux->vcntrs[i] == vcntr) {
+            mux->vcntrs[i] = mux->vcntrs[--mux->vcntr_num];
+            mux->vcntrs[mux->vcntr_num] = NULL;
+            break;
+        }
+    }
+
+    events_mux_shrink(mux);
+    if (mux->vcntr_num > 0) {
+        mux->next %= mux->vcntr_num;
+    } else {
+        mux->next = 0;
+    }
+    events_mux_schedule(mux);
+}
+
+uint64_t events_vcntr_read_raw(struct events_vcntr* vcntr, uint64_t* time_enabled,
+    uint64_t* time_running)
+{
+    events_vcntr_update(vcntr, timer_get_ticks());
+
+    if (time_enabled != NULL) {
+        *time_enabled = vcntr->time_enabled;
+    }
+    if (time_running != NULL) {
+        *time_running = vcntr->time_running;
+    }
+
+    return vcntr->count;
+}
+
+uint64_t events_vcntr_read(struct events_vcntr* vcntr)
+{
+    uint64_t enabled, running;
+    uint64_t count = events_vcntr_read_raw(vcntr, &enabled, &running);
+
+    return events_scale(count, enabled, running);
+}
@@ -0,0 +1,120 @@
+/**
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (c) Bao Project and Contributors. All rights reserved.
+ */
+
+#include <exit_stats.h>
+#include <cpu.h>
+#include <vm.h>
+#include <hypercall.h>
+
+static inline bool exit_reason_keyed(enum exit_reason reason)
+{
+    return (reason == EXIT_REASON_MMIO) || (reason == EXIT_REASON_HVC) ||
+        (reason == EXIT_REASON_SMC);
+}
+
+static struct exit_stat* exit_stats_keyed_get(struct exit_stats* stats, enum exit_reason reason,
+    unsigned long key)
+{
+    struct exit_stat_keyed* keyed = stats->keyed[reason];
+
+    for (size_t i = 0; i < (EXIT_STATS_KEYS - 1); i++) {
+        if ((keyed[i].stat.count == 0) || (keyed[i].key == key)) {
+            keyed[i].key = key;
+            return &keyed[i].stat;
+        }
+    }
+
+    return &keyed[EXIT_STATS_KEYS - 1].stat;
+}
+
+void exit_stats_begin(void)
+{
+    struct vcpu* vcpu = cpu()->vcpu;
+
+    if (vcpu == NULL) {
+        return;
+    }
+
+    vcpu->exit_stats.entry = timer_get_ticks();
+    vcpu->exit_stats.reason = EXIT_REASON_OTHER;
+    vcpu->exit_stats.key = 0;
+    vcpu->exit_stats.pending = true;
+}
+
+void exit_stats_classify(enum exit_reason reason, unsigned long key)
+{
+    struct vcpu* vcpu = cpu()->vcpu;
+
+    if ((vcpu == NULL) || !vcpu->exit_stats.pending) {
+        return;
+    }
+
+    vcpu->exit_stats.reason = reason;
+    vcpu->exit_stats.key = key;
+}
+
+/**
+ * Called when returning to the guest and when a vcpu is resumed from standby, so that exits whose
+ * handler never returns (e.g., throttling) are charged with the whole time the cpu spent in the
+ * hypervisor.
+ */
+void exit_stats_end(void)
+{
+    struct vcpu* vcpu = cpu()->vcpu;
+
+    if ((vcpu == NULL) || !vcpu->exit_stats.pending) {
+        return;
+    }
+
+    struct exit_stats* stats = &vcpu->exit_stats;
+    uint64_t ticks = timer_get_ticks() - stats->entry;
+
+    stats->reasons[stats->reason].count++;
+    stats->reasons[stats->reason].ticks += ticks;
+
+    if (exit_reason_keyed(stats->reason)) {
+        struct exit_stat* stat = exit_stats_keyed_get(stats, stats->reason, stats->key);
+        stat->count++;
+        stat->ticks += ticks;
+    }
+
+    stats->pending = false;
+}
+
+/**
+ * sel selects the class in its lowest byte. Its second byte selects the keyed breakdown slot plus
+ * one, or zero for the class total. field is one of enum exit_stats_field.
+ */
+long int exit_stats_hypercall(unsigned long vcpu_id, unsigned long sel, unsigned long field)
+{
+    struct vm* vm = cpu()->vcpu->vm;
+    enum exit_reason reason = (enum exit_reason)(sel & 0xff);
+    size_t slot = (sel >> 8) & 0xff;
+
+    if ((vcpu_id >= vm->cpu_num) || (reason >= EXIT_REASON_NUM) || (field > EXIT_STATS_KEY)) {
+        return -HC_E_INVAL_ARGS;
+    }
+
+    struct exit_stats* stats = &vm_get_vcpu(vm, vcpu_id)->exit_stats;
+    struct exit_stat* stat = &stats->reasons[reason];
+    unsigned long key = 0;
+
+    if (slot != 0) {
+        if (!exit_reason_keyed(reason) || (slot > EXIT_STATS_KEYS)) {
+            return -HC_E_INVAL_ARGS;
+        }
+        stat = &stats->keyed[reason][slot - 1].stat;
+        key = stats->keyed[reason][slot - 1].key;
+    }
+
+    switch (field) {
+        case EXIT_STATS_COUNT:
+            return (long int)stat->count;
+        case EXIT_STATS_TICKS:
+            return (long int)stat->ticks;
+        default:
+            return (long int)key;
+    }
+}
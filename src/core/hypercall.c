@@ -7,6 +7,9 @@
 #include <cpu.h>
 #include <vm.h>
 #include <ipc.h>
+#include <exit_stats.h>
+#include <irq_lat.h>
+#include <recolor.h>
 
 long int hypercall(unsigned long id)
 {
@@ -20,6 +23,15 @@ long int hypercall(unsigned long id)
         case HC_IPC:
             ret = ipc_hypercall(ipc_id, arg1, arg2);
             break;
+        case HC_EXIT_STATS:
+            ret = exit_stats_hypercall(ipc_id, arg1, arg2);
+            break;
+        case HC_IRQ_LAT:
+            ret = irq_lat_hypercall(ipc_id, arg1, arg2);
+            break;
+        case HC_RECOLOR:
+            ret = recolor_hypercall(ipc_id, arg1, arg2);
+            break;
         default:
             WARNING("Unknown hypercall id %d", id);
     }
@@ -0,0 +1,24 @@
+/**
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (c) Bao Project and Contributors. All rights reserved.
+ */
+
+#ifndef __ATOMIC_H__
+#define __ATOMIC_H__
+
+#include <arch/atomic.h>
+
+/**
+ * Minimal set of 32-bit atomic operations for lock-free hypervisor data structures, implemented
+ * per architecture:
+ *   - atomic_load_acquire: no later access is ordered before the load;
+ *   - atomic_store_release: no earlier access is ordered after the store;
+ *   - atomic_cmpxchg: if *ptr equals expected, replace it by desired, with acquire and release
+ *     semantics. Returns the value read, i.e., the exchange succeeded if it equals expected;
+ *   - atomic_fetch_add: add val to *ptr, with acquire and release semantics. Returns the previous
+ *     value;
+ *   - atomic_wait_while_eq: if *ptr equals val, wait in a low-power state for it to be written
+ *     by another cpu. It may return early, so callers must check *ptr again.
+ */
+
+#endif /* __ATOMIC_H__ */
@@ -25,6 +25,12 @@ extern size_t COLOR_SIZE;
 void cache_enumerate(void);
 void cache_flush_range(vaddr_t base, size_t size);
 
+/**
+ * Copy memory while hinting the caches not to keep it, where the architecture allows, so large
+ * copies do not evict the working set from the shared cache. The copy is not cleaned to memory.
+ */
+void cache_copy_stream(void* dst, const void* src, size_t size);
+
 void cache_arch_enumerate(struct cache* dscrp);
 
 #endif /* __CACHE_H__ */
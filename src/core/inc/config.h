@@ -49,9 +49,28 @@
         .separately_loaded = true,                                                      \
     }
 
+/**
+ * LZ4 compressed images (see lz4.h), decompressed into the VM's memory at boot. image_size is the
+ * size of the decompressed image, as it must be known before the image is read.
+ */
+#define VM_IMAGE_BUILTIN_LZ4(img_name, image_base_addr, image_size)             \
+    {                                                                           \
+        .base_addr = image_base_addr, .load_addr = VM_IMAGE_OFFSET(img_name),   \
+        .size = image_size, .separately_loaded = false, .format = VM_IMAGE_LZ4, \
+        .load_size = VM_IMAGE_SIZE(img_name),                                   \
+    }
+
+#define VM_IMAGE_LOADED_LZ4(image_base_addr, image_load_addr, image_size, image_load_size) \
+    {                                                                                      \
+        .base_addr = image_base_addr, .load_addr = image_load_addr, .size = image_size,    \
+        .separately_loaded = true, .format = VM_IMAGE_LZ4, .load_size = image_load_size,   \
+    }
+
 /* CONFIG_HEADER is just defined for compatibility with older configs */
 #define CONFIG_HEADER
 
+enum vm_image_format { VM_IMAGE_RAW, VM_IMAGE_LZ4 };
+
 struct vm_config {
     /**
      * To setup the image field either the VM_IMAGE_BUILTIN or VM_IMAGE_LOADED macros should be
@@ -70,6 +89,10 @@ struct vm_config {
         bool separately_loaded;
         /* Dont copy the image */
         bool inplace;
+        /* Format of the image as loaded. Compressed images can not be used in place. */
+        enum vm_image_format format;
+        /* Size of the image as loaded, if compressed. Raw images take size bytes. */
+        size_t load_size;
     } image;
 
     /* Entry point address in VM's address space */
@@ -87,6 +110,13 @@ struct vm_config {
      */
     colormap_t colors;
 
+    /**
+     * A bitmap for the assigned DRAM banks of the VM, as numbered by the platform's bank masks.
+     * Combined with colors, the VM only gets pages in both. This value is truncated depending on
+     * the number of banks the platform describes.
+     */
+    bankmap_t banks;
+
     struct {
         uint64_t period_us;
         uint64_t vm_budget;
@@ -101,6 +131,13 @@ struct vm_config {
     struct vm_platform platform;
 };
 
+/* Size of the VM's image as loaded, before any decompression */
+static inline size_t vm_config_image_load_size(const struct vm_config* vm_config)
+{
+    return (vm_config->image.format == VM_IMAGE_RAW) ? vm_config->image.size :
+                                                       vm_config->image.load_size;
+}
+
 extern struct config {
     struct {
         /**
@@ -120,6 +157,18 @@ extern struct config {
     size_t shmemlist_size;
     struct shmem* shmemlist;
 
+    /* Export the hypervisor trace buffers to a monitor VM through a shared memory region */
+    struct {
+        bool export;
+        size_t shmem_id;
+    } trace;
+
+    /* Let a management VM change the other VMs' colors at runtime through HC_RECOLOR */
+    struct {
+        bool enable;
+        vmid_t mgmt_vm;
+    } recolor;
+
     /* The number of VMs specified by this configuration */
     size_t vmlist_size;
 
@@ -14,12 +14,45 @@
 #include <list.h>
 #include <bitmap.h>
 #include <events.h>
+#include <timer.h>
 #include <mem_throt.h>
+#include <atomic.h>
+#include <fences.h>
 
 #ifndef __ASSEMBLER__
 
+struct cpu_msg {
+    uint32_t handler;
+    uint32_t event;
+    uint64_t data;
+};
+
+#ifndef CPU_MSG_RING_SIZE
+#define CPU_MSG_RING_SIZE (128)
+#endif
+
+#if (CPU_MSG_RING_SIZE & (CPU_MSG_RING_SIZE - 1)) != 0
+#error "CPU_MSG_RING_SIZE must be a power of two"
+#endif
+
+struct cpu_msg_slot {
+    volatile uint32_t seq;
+    struct cpu_msg msg;
+};
+
+/**
+ * Bounded multi-producer, single-consumer message ring. Any cpu may enqueue without taking a lock;
+ * only the owner cpu dequeues, so its read position lives in its private struct cpu. signalled is
+ * set while an IPI for the queued messages is on its way.
+ */
+struct cpu_msg_ring {
+    volatile uint32_t tail;
+    volatile uint32_t signalled;
+    struct cpu_msg_slot slots[CPU_MSG_RING_SIZE];
+};
+
 struct cpuif {
-    struct list event_list;
+    struct cpu_msg_ring msg_ring;
 
 } __attribute__((aligned(PAGE_SIZE)));
 
@@ -29,6 +62,7 @@ struct cpu {
     cpuid_t id;
 
     bool handling_msgs;
+    uint32_t msg_head;
 
     struct addr_space as;
 
@@ -42,20 +76,21 @@ struct cpu {
 
     BITMAP_ALLOC(events_bitmap, EVENTS_CNTR_MAX_NUM);
 
-    irq_handler_t array_interrupt_functions[EVENTS_CNTR_MAX_NUM];
+    struct events_cntr_owner events_owners[EVENTS_CNTR_MAX_NUM];
 
     uint64_t implemented_event_counters;
 
+    bool events_irq_reserved;
+
+    struct events_mux events_mux;
+
+    struct timer_queue timers;
+
     struct cpuif* interface;
 
     uint8_t stack[STACK_SIZE] __attribute__((aligned(PAGE_SIZE)));
 
 } __attribute__((aligned(PAGE_SIZE)));
-struct cpu_msg {
-    uint32_t handler;
-    uint32_t event;
-    uint64_t data;
-};
 
 void cpu_send_msg(cpuid_t cpu, struct cpu_msg* msg);
 
@@ -66,17 +101,27 @@ typedef void (*cpu_msg_handler_t)(uint32_t event, uint64_t data);
     cpu_msg_handler_t __cpumsg_handler_##handler = handler; \
     __attribute__((section(".ipi_cpumsg_handlers_id"), used)) volatile const size_t handler_id;
 
+/**
+ * Sense-reversing barrier, with a generation number standing for the sense so that no per-cpu
+ * state is needed. Each cpu samples the generation and atomically counts itself in; the last one
+ * to arrive resets the count and advances the generation, releasing the others.
+ */
 struct cpu_synctoken {
-    spinlock_t lock;
-    volatile size_t n;
+    volatile uint32_t count;
+    volatile uint32_t gen;
+    size_t n;
     volatile bool ready;
-    volatile size_t count;
 };
 
+#ifndef CPU_SYNC_TIMEOUT_US
+#define CPU_SYNC_TIMEOUT_US (1000000)
+#endif
+
 extern struct cpu_synctoken cpu_glb_sync;
 
 void cpu_init(cpuid_t cpu_id, paddr_t load_addr);
 void cpu_send_msg(cpuid_t cpu, struct cpu_msg* msg);
+void cpu_send_msg_mask(cpumap_t cpus, struct cpu_msg* msg);
 bool cpu_get_msg(struct cpu_msg* msg);
 void cpu_msg_handler(void);
 void cpu_msg_set_handler(cpuid_t id, cpu_msg_handler_t handler);
@@ -100,45 +145,45 @@ static inline bool cpu_is_master(void)
     return cpu()->id == CPU_MASTER;
 }
 
+void cpu_sync_wait(struct cpu_synctoken* token, uint32_t gen, bool handle_msgs);
+
 static inline void cpu_sync_init(struct cpu_synctoken* token, size_t n)
 {
-    token->lock = SPINLOCK_INITVAL;
     token->n = n;
     token->count = 0;
+    fence_ord_write();
     token->ready = true;
 }
 
-static inline void cpu_sync_barrier(struct cpu_synctoken* token)
+/* Returns the generation the caller arrived in, which is over once token->gen moves past it */
+static inline uint32_t cpu_sync_arrive(struct cpu_synctoken* token)
 {
-    // TODO: no fence/barrier needed in this function?
-
-    size_t next_count = 0;
-
     while (!token->ready) { }
 
-    spin_lock(&token->lock);
-    token->count++;
-    next_count = ALIGN(token->count, token->n);
-    spin_unlock(&token->lock);
+    uint32_t gen = atomic_load_acquire(&token->gen);
+    if (atomic_fetch_add(&token->count, 1) == (token->n - 1)) {
+        token->count = 0;
+        atomic_store_release(&token->gen, gen + 1);
+    }
 
-    while (token->count < next_count) { }
+    return gen;
 }
 
-static inline void cpu_sync_and_clear_msgs(struct cpu_synctoken* token)
+static inline void cpu_sync_barrier(struct cpu_synctoken* token)
 {
-    size_t next_count = 0;
+    uint32_t gen = cpu_sync_arrive(token);
 
-    while (!token->ready) { }
+    if (atomic_load_acquire(&token->gen) == gen) {
+        cpu_sync_wait(token, gen, false);
+    }
+}
 
-    spin_lock(&token->lock);
-    token->count++;
-    next_count = ALIGN(token->count, token->n);
-    spin_unlock(&token->lock);
+static inline void cpu_sync_and_clear_msgs(struct cpu_synctoken* token)
+{
+    uint32_t gen = cpu_sync_arrive(token);
 
-    while (token->count < next_count) {
-        if (!cpu()->handling_msgs) {
-            cpu_msg_handler();
-        }
+    if (atomic_load_acquire(&token->gen) == gen) {
+        cpu_sync_wait(token, gen, true);
     }
 
     if (!cpu()->handling_msgs) {
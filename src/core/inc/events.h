@@ -7,6 +7,7 @@
 #define __EVENTS_H__
 
 #include <arch/events.h>
+#include <timer.h>
 
 #define EVENTS_CNTR_MAX_NUM    EVENTS_ARCH_CNTR_MAX_NUM
 
@@ -19,14 +20,89 @@ typedef enum {
     l2_cache_refill            // L2 cache refill event.
 } events_enum;
 
+/**
+ * Every allocated counter has an owner. On overflow, the handler registered by the owner is called
+ * with the counter index and the owner's opaque context. Regulator handlers may put the cpu in
+ * standby and never return, so they are always dispatched after every other owner.
+ */
+typedef enum {
+    EVENTS_OWNER_NONE = 0,
+    EVENTS_OWNER_REGULATOR,
+    EVENTS_OWNER_TELEMETRY,
+    EVENTS_OWNER_VPMU,
+    EVENTS_OWNER_SAMPLER,
+} events_owner_t;
 
-static inline size_t events_cntr_alloc() {
-    return events_arch_cntr_alloc();
-}
+typedef void (*events_ovf_handler_t)(size_t counter, void* ctx);
+
+struct events_cntr_owner {
+    events_owner_t owner;
+    events_ovf_handler_t handler;
+    void* ctx;
+};
+
+/**
+ * Hardware counters obtained with events_cntr_alloc() are pinned: they belong to their consumer
+ * until freed and can raise overflow interrupts (e.g., for bandwidth regulation). Consumers that
+ * only need counts (telemetry, profiling, the guests' virtual PMUs) use virtual counters instead.
+ * Virtual counters are round-robin scheduled on a per-cpu timer onto the hardware counters nobody
+ * has pinned, so there can be more of them than there are hardware counters. Each virtual counter
+ * keeps track of how long it was enabled and how long it was actually running on hardware, and
+ * its value is scaled by enabled/running time. Virtual counters are per-cpu and count the events
+ * of the cpu they were added on.
+ *
+ * Virtual counters added with events_vcntr_add_raw() take an architectural event type and may
+ * have an overflow handler. While mapped, their hardware counter holds phase + count, so it
+ * overflows whenever the consumer's own 32-bit view of the count does.
+ */
+
+#ifndef EVENTS_VCNTR_MAX
+#define EVENTS_VCNTR_MAX        (16)
+#endif
+
+#ifndef EVENTS_MUX_PERIOD_US
+#define EVENTS_MUX_PERIOD_US    (1000)
+#endif
+
+#define EVENTS_VCNTR_UNMAPPED   ((size_t)-1)
+
+struct events_vcntr {
+    events_enum event;
+    bool raw;
+    uint64_t evtyper;
+    uint32_t phase;
+    events_owner_t owner;
+    events_ovf_handler_t handler;
+    void* ctx;
+    size_t hw_cntr;
+    uint64_t count;
+    uint64_t time_enabled;
+    uint64_t time_running;
+    uint64_t timestamp;
+};
+
+struct events_mux {
+    struct events_vcntr* vcntrs[EVENTS_VCNTR_MAX];
+    size_t vcntr_num;
+    size_t hw_cntrs[EVENTS_CNTR_MAX_NUM];
+    size_t hw_cntr_num;
+    size_t next;
+    struct timer_event timer;
+};
+
+size_t events_cntr_alloc(void);
+void events_cntr_free(size_t counter);
+void events_cntr_set_owner(size_t counter, events_owner_t owner, events_ovf_handler_t handler,
+    void* ctx);
+void events_handle_overflow(uint64_t ovs);
+bool events_vcntr_add(struct events_vcntr* vcntr, events_enum event);
+bool events_vcntr_add_raw(struct events_vcntr* vcntr, uint64_t evtyper, uint32_t phase,
+    events_owner_t owner, events_ovf_handler_t handler, void* ctx);
+void events_vcntr_remove(struct events_vcntr* vcntr);
+uint64_t events_vcntr_read(struct events_vcntr* vcntr);
+uint64_t events_vcntr_read_raw(struct events_vcntr* vcntr, uint64_t* time_enabled,
+    uint64_t* time_running);
 
-static inline void events_cntr_free(size_t counter) {
-    events_arch_cntr_free(counter);
-}
 
 static inline void events_enable(void) {
     events_arch_enable();
@@ -48,6 +124,10 @@ static inline void events_cntr_set(size_t counter, unsigned long value) {
     events_arch_cntr_set(counter, value);
 }
 
+static inline void events_cntr_write(size_t counter, uint32_t value) {
+    events_arch_cntr_write(counter, value);
+}
+
 static inline uint64_t events_get_cntr_value(size_t counter) {
     return events_arch_get_cntr_value(counter);
 }
@@ -56,6 +136,10 @@ static inline void events_set_evtyper(size_t counter, events_enum event) {
     events_arch_set_evtyper(counter, event);
 }
 
+static inline void events_set_evtyper_raw(size_t counter, uint64_t evtyper) {
+    events_arch_set_evtyper_raw(counter, evtyper);
+}
+
 static inline void events_interrupt_enable(uint64_t cpu_id) {
     events_arch_interrupt_enable(cpu_id);
 }
@@ -72,12 +156,12 @@ static inline void events_cntr_irq_disable(size_t counter) {
     events_arch_cntr_irq_disable(counter);
 }
 
-static inline void events_clear_cntr_ovs(size_t counter) {
-    events_arch_clear_cntr_ovs(counter);
+static inline bool events_cntr_ovs(size_t counter) {
+    return events_arch_cntr_ovs(counter);
 }
 
-static inline void events_cntr_set_irq_callback(irq_handler_t handler, size_t counter) {
-    events_arch_cntr_set_irq_callback(handler, counter);
+static inline void events_clear_cntr_ovs(size_t counter) {
+    events_arch_clear_cntr_ovs(counter);
 }
 
 #endif /* __EVENTS_H__ */
\ No newline at end of file
@@ -0,0 +1,67 @@
+/**
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (c) Bao Project and Contributors. All rights reserved.
+ */
+
+#ifndef __EXIT_STATS_H__
+#define __EXIT_STATS_H__
+
+#include <bao.h>
+
+/**
+ * Per-vcpu VM exit accounting. Every exit from the guest is timestamped on entry to the
+ * hypervisor, classified by the handler that ends up serving it, and charged to its class when
+ * the vcpu is resumed. Emulated MMIO accesses are additionally broken down by device (emulated
+ * region base address), and hypervisor/secure monitor calls by function id. The statistics are
+ * read by guests through the HC_EXIT_STATS hypercall.
+ */
+
+enum exit_reason {
+    EXIT_REASON_MMIO,
+    EXIT_REASON_SYSREG,
+    EXIT_REASON_HVC,
+    EXIT_REASON_SMC,
+    EXIT_REASON_WFX,
+    EXIT_REASON_IRQ,
+    EXIT_REASON_PMU,
+    EXIT_REASON_OTHER,
+    EXIT_REASON_NUM
+};
+
+enum exit_stats_field {
+    EXIT_STATS_COUNT,
+    EXIT_STATS_TICKS,
+    EXIT_STATS_KEY,
+};
+
+#ifndef EXIT_STATS_KEYS
+#define EXIT_STATS_KEYS (8)
+#endif
+
+struct exit_stat {
+    uint64_t count;
+    uint64_t ticks;
+};
+
+struct exit_stat_keyed {
+    unsigned long key;
+    struct exit_stat stat;
+};
+
+struct exit_stats {
+    struct exit_stat reasons[EXIT_REASON_NUM];
+    /* Breakdown of the MMIO, HVC and SMC classes. The last slot collects keys that do not fit. */
+    struct exit_stat_keyed keyed[EXIT_REASON_SMC + 1][EXIT_STATS_KEYS];
+
+    uint64_t entry;
+    enum exit_reason reason;
+    unsigned long key;
+    bool pending;
+};
+
+void exit_stats_begin(void);
+void exit_stats_classify(enum exit_reason reason, unsigned long key);
+void exit_stats_end(void);
+long int exit_stats_hypercall(unsigned long vcpu_id, unsigned long sel, unsigned long field);
+
+#endif /* __EXIT_STATS_H__ */
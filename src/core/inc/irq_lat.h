@@ -0,0 +1,83 @@
+/**
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (c) Bao Project and Contributors. All rights reserved.
+ */
+
+#ifndef __IRQ_LAT_H__
+#define __IRQ_LAT_H__
+
+#include <bao.h>
+
+/**
+ * Interrupt latency instrumentation, compiled in with IRQ_LATENCY=y. Every physical interrupt
+ * assigned to a VM gets a set of log2 histograms, bucket n counting latencies in [2^n, 2^(n+1))
+ * nanoseconds, measured from its physical arrival at the hypervisor to:
+ *   - its injection, i.e., the list register write (GIC) or it becoming virtually pending
+ *     (PLIC/APLIC);
+ *   - its completion by the guest, i.e., the list register retiring (GIC), or the guest
+ *     completing (PLIC) or claiming (APLIC) it.
+ * Interrupts that arrive or are injected while their vcpu is throttled by the memory bandwidth
+ * regulator are accounted in a separate set of histograms, so regulation cost is visible.
+ *
+ * Only one instance of each interrupt is tracked at a time: an interrupt arriving while the
+ * previous instance is still in flight is counted as a drop. The histograms are read or dumped
+ * to the console through the HC_IRQ_LAT hypercall.
+ */
+
+#ifndef IRQ_LAT_MAX
+#define IRQ_LAT_MAX (32)
+#endif
+
+#define IRQ_LAT_BUCKETS (32)
+
+enum irq_lat_hist {
+    IRQ_LAT_INJECT,
+    IRQ_LAT_COMPLETE,
+    IRQ_LAT_THROTTLED_INJECT,
+    IRQ_LAT_THROTTLED_COMPLETE,
+    IRQ_LAT_HIST_NUM
+};
+
+/* HC_IRQ_LAT commands, passed in the first hypercall argument */
+enum irq_lat_cmd {
+    IRQ_LAT_CMD_READ,  /* arg1: irq id, arg2: (hist << 8) | bucket; bucket 0xff reads drops */
+    IRQ_LAT_CMD_DUMP,  /* print the calling VM's histograms to the console */
+    IRQ_LAT_CMD_RESET, /* clear the calling VM's histograms */
+};
+
+#define IRQ_LAT_DROPS (0xff)
+
+void irq_lat_track(irqid_t id);
+void irq_lat_record_arrival(irqid_t id, bool throttled);
+void irq_lat_record_inject(irqid_t id, unsigned long cookie, bool throttled);
+void irq_lat_record_complete(irqid_t id, unsigned long cookie);
+long int irq_lat_hypercall(unsigned long cmd, unsigned long arg1, unsigned long arg2);
+
+/**
+ * The cookie passed on injection must match the one passed on completion for the instance to be
+ * completed. It lets callers that observe completion indirectly (e.g., by scanning for retired
+ * list registers) tell the tracked instance apart from stale state.
+ */
+
+static inline void irq_lat_arrival(irqid_t id, bool throttled)
+{
+    if (DEFINED(IRQ_LATENCY)) {
+        irq_lat_record_arrival(id, throttled);
+    }
+}
+
+static inline void irq_lat_inject(irqid_t id, unsigned long cookie, bool throttled)
+{
+    if (DEFINED(IRQ_LATENCY)) {
+        irq_lat_record_inject(id, cookie, throttled);
+    }
+}
+
+static inline void irq_lat_complete(irqid_t id, unsigned long cookie)
+{
+    if (DEFINED(IRQ_LATENCY)) {
+        irq_lat_record_complete(id, cookie);
+    }
+}
+
+#endif /* __IRQ_LAT_H__ */
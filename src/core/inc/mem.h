@@ -19,6 +19,21 @@ struct ppages {
     paddr_t base;
     size_t num_pages;
     colormap_t colors;
+    bankmap_t banks;
+};
+
+/**
+ * Page pools are buddy allocators over naturally aligned (in physical address) blocks of 2^order
+ * pages. Free blocks are kept in per-order doubly linked lists threaded through the per-page
+ * pages array, and orders marks the first page of each free block with its order. An allocation
+ * bitmap is kept alongside for colored allocation, which searches it a word at a time. With
+ * PP_CHECK set, every allocation and free checks the free blocks and the bitmap agree.
+ */
+#define PP_ORDER_NUM (32)
+
+struct pp_page {
+    uint32_t next;
+    uint32_t prev;
 };
 
 struct page_pool {
@@ -27,6 +42,9 @@ struct page_pool {
     size_t size;
     size_t free;
     size_t last;
+    struct pp_page* pages;
+    uint8_t* orders;
+    uint32_t free_list[PP_ORDER_NUM];
     bitmap_t* bitmap;
     spinlock_t lock;
 };
@@ -51,7 +69,7 @@ struct shmem {
 
 static inline struct ppages mem_ppages_get(paddr_t base, size_t num_pages)
 {
-    return (struct ppages){ .colors = 0, .base = base, .num_pages = num_pages };
+    return (struct ppages){ .colors = 0, .banks = 0, .base = base, .num_pages = num_pages };
 }
 
 static inline bool all_clrs(colormap_t clrs)
@@ -61,9 +79,55 @@ static inline bool all_clrs(colormap_t clrs)
     return (masked_colors == 0) || (masked_colors == mask);
 }
 
+/**
+ * DRAM bank partitioning. The platform describes each bit of the bank index as a mask of physical
+ * address bits, whose parity gives the bit's value: a single address bit for plain bank
+ * selection, or several for XOR-hashed selection. Banks are numbered by their index, and a
+ * bankmap_t selects a set of banks the same way a colormap_t selects a set of colors. All pages
+ * share bank 0 if the platform describes no bank bits.
+ */
+#define DRAM_BANK_MASKS_MAX (5)
+
+extern size_t DRAM_BANK_NUM;
+/* Number of consecutive, aligned pages always in the same bank */
+extern size_t DRAM_BANK_SPAN;
+
+size_t mem_page_bank(paddr_t pa);
+
+static inline bool all_banks(bankmap_t banks)
+{
+    bankmap_t mask = BIT_MASK(0, DRAM_BANK_NUM);
+    bankmap_t masked_banks = banks & mask;
+    return (masked_banks == 0) || (masked_banks == mask);
+}
+
+/* Whether colors and banks together leave out any memory */
+static inline bool all_clrs_banks(colormap_t clrs, bankmap_t banks)
+{
+    return all_clrs(clrs) && all_banks(banks);
+}
+
+static inline bool mem_page_in_banks(paddr_t pa, bankmap_t banks)
+{
+    return all_banks(banks) || (bit_get(banks, mem_page_bank(pa)) != 0);
+}
+
+static inline bool mem_page_in_clrs_banks(paddr_t pa, colormap_t clrs, bankmap_t banks)
+{
+    return (all_clrs(clrs) || (bit_get(clrs, (pa / PAGE_SIZE / COLOR_SIZE) % COLOR_NUM) != 0)) &&
+        mem_page_in_banks(pa, banks);
+}
+
 void mem_init(paddr_t load_addr);
 void* mem_alloc_page(size_t num_pages, enum AS_SEC sec, bool phys_aligned);
-struct ppages mem_alloc_ppages(colormap_t colors, size_t num_pages, bool aligned);
+struct ppages mem_alloc_ppages_banks(colormap_t colors, bankmap_t banks, size_t num_pages,
+    bool aligned);
+
+static inline struct ppages mem_alloc_ppages(colormap_t colors, size_t num_pages, bool aligned)
+{
+    return mem_alloc_ppages_banks(colors, 0, num_pages, aligned);
+}
+
 vaddr_t mem_alloc_map(struct addr_space* as, enum AS_SEC section, struct ppages* page, vaddr_t at,
     size_t num_pages, mem_flags_t flags);
 vaddr_t mem_alloc_map_dev(struct addr_space* as, enum AS_SEC section, vaddr_t at, paddr_t pa,
@@ -71,16 +135,28 @@ vaddr_t mem_alloc_map_dev(struct addr_space* as, enum AS_SEC section, vaddr_t at
 void mem_unmap(struct addr_space* as, vaddr_t at, size_t num_pages, bool free_ppages);
 bool mem_map_reclr(struct addr_space* as, vaddr_t va, struct ppages* ppages, size_t num_pages,
     mem_flags_t flags);
+bool mem_reclr_pages(struct addr_space* as, vaddr_t va, size_t num_pages, colormap_t colors,
+    size_t* reclrd_num);
 vaddr_t mem_map_cpy(struct addr_space* ass, struct addr_space* asd, vaddr_t vas, vaddr_t vad,
     size_t num_pages);
 bool pp_alloc(struct page_pool* pool, size_t num_pages, bool aligned, struct ppages* ppages);
 
+size_t pp_meta_pages(size_t num_pages);
+void pp_setup(struct page_pool* pool, void* meta);
+
+/* Page indexes are relative to the pool base. These must be called with the pool lock held. */
+bool pp_page_is_free(struct page_pool* pool, size_t index);
+bool pp_range_is_free(struct page_pool* pool, size_t index, size_t num_pages);
+bool pp_take(struct page_pool* pool, size_t index, size_t num_pages);
+void pp_free(struct page_pool* pool, size_t index, size_t num_pages);
+
 void mem_prot_init(void);
 size_t mem_cpu_boot_alloc_size(void);
 
 void mem_color_hypervisor(const paddr_t load_addr, struct mem_region* root_region);
-bool pp_alloc_clr(struct page_pool* pool, size_t num_pages, colormap_t colors,
+bool pp_alloc_clr(struct page_pool* pool, size_t num_pages, colormap_t colors, bankmap_t banks,
     struct ppages* ppages);
+size_t mem_part_num_pages(colormap_t colors, bankmap_t banks);
 
 /* Functions implemented in architecture dependent files */
 
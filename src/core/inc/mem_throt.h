@@ -14,12 +14,15 @@
 typedef struct mem_throt_info {
 	bool is_initialized;
 	bool throttled;			 
+	/* Set on a vcpu once it holds the regulator counter, counter_id, which may have run out */
+	bool regulated;
 	size_t counter_id;
 	size_t period_us;
 	size_t period_counts;
 	size_t budget; 
 	int64_t budget_left;
 	size_t assign_ratio;
+	struct timer_event period_timer;
 }mem_throt_t;
 
 extern size_t global_num_ticket_hypervisor;
@@ -28,14 +31,24 @@ void mem_throt_config(size_t period_us, size_t vm_budget, size_t* cpu_ratio);
 
 void mem_throt_init();
 
-void mem_throt_period_timer_callback(irqid_t);
+void mem_throt_period_timer_callback(struct timer_event* event);
 
 /* budget is used up. PMU generate an interrupt */
-void mem_throt_event_overflow_callback(irqid_t); 
+void mem_throt_event_overflow_callback(size_t counter, void* ctx);
 void mem_throt_process_overflow(void);
 
-void mem_throt_timer_init(irq_handler_t hander);
-void mem_throt_events_init(events_enum event, unsigned long budget, irq_handler_t handler);
+void mem_throt_timer_init(timer_handler_t handler);
+bool mem_throt_events_init(events_enum event, unsigned long budget, events_ovf_handler_t handler);
 void mem_throt_budget_change(uint64_t budget);
 
+/**
+ * Hypervisor work done on behalf of the current vcpu is not seen by its counter, which does not
+ * count at EL2. Charge it explicitly, in bytes moved, as if the guest had made the accesses.
+ */
+#ifndef MEM_THROT_ACCESS_SIZE
+#define MEM_THROT_ACCESS_SIZE (64)
+#endif
+
+void mem_throt_charge(size_t bytes);
+
 #endif /* __mem_throt_H__ */
\ No newline at end of file
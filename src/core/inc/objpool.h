@@ -7,31 +7,71 @@
 #define OBJPOOL_H
 
 #include <bao.h>
-#include <bitmap.h>
-#include <arch/spinlock.h>
+#include <platform_defs.h>
+#include <spinlock.h>
+
+/**
+ * Fixed-size object pools with O(1) allocation and free. The shared pool hands out objects that
+ * were never allocated in index order and keeps freed ones on a list threaded through the objects
+ * themselves, so objects must be able to hold a pointer. Each cpu caches a small magazine of free
+ * objects, refilled from and flushed to the shared pool in batches, so most operations take no
+ * lock. Magazines are sized so that they can never hold more than half of the pool.
+ */
+
+#ifndef OBJPOOL_MAG_SIZE
+#define OBJPOOL_MAG_SIZE (8)
+#endif
+
+#define OBJPOOL_MAG_SIZE_FOR(N) min((size_t)OBJPOOL_MAG_SIZE, (size_t)(N) / (2 * PLAT_CPU_NUM))
+
+struct objpool_magazine {
+    size_t num;
+    void* objs[OBJPOOL_MAG_SIZE];
+};
 
 struct objpool {
     void* pool;
-    bitmap_t* bitmap;
     size_t objsize;
     size_t num;
-    size_t count;
+    size_t mag_size;
+    struct objpool_magazine* mags;
     spinlock_t lock;
+    /* Shared pool state, protected by lock */
+    void* free_list;
+    size_t fresh;
+    size_t used;
+    size_t high_watermark;
+    size_t failures;
+};
+
+/**
+ * Occupancy is measured at the shared pool: used counts the objects handed out from it, whether in
+ * use or cached in a magazine, so it is an upper bound of the objects actually in use.
+ */
+struct objpool_stats {
+    size_t num;
+    size_t used;
+    size_t high_watermark;
+    size_t failures;
 };
 
-#define OBJPOOL_ALLOC(NAME, TYPE, N)         \
-    TYPE _##NAME##_array[N];                 \
-    BITMAP_ALLOC(_##NAME##_array_bitmap, N); \
-    struct objpool NAME = {                  \
-        .pool = _##NAME##_array,             \
-        .bitmap = _##NAME##_array_bitmap,    \
-        .objsize = sizeof(TYPE),             \
-        .num = N,                            \
-        .lock = SPINLOCK_INITVAL,            \
-    }
+#define OBJPOOL_ALLOC(NAME, TYPE, N)                                                    \
+    TYPE _##NAME##_array[N];                                                            \
+    struct objpool_magazine _##NAME##_mags[PLAT_CPU_NUM];                               \
+    struct objpool NAME = {                                                             \
+        .pool = _##NAME##_array,                                                        \
+        .objsize = sizeof(TYPE),                                                        \
+        .num = N,                                                                       \
+        .mag_size = OBJPOOL_MAG_SIZE_FOR(N),                                            \
+        .mags = _##NAME##_mags,                                                         \
+        .lock = SPINLOCK_INITVAL,                                                       \
+    };                                                                                  \
+    _Static_assert((sizeof(TYPE) >= sizeof(void*)) && (_Alignof(TYPE) >= _Alignof(void*)), \
+        "objpool objects must be able to hold a pointer")
 
 void objpool_init(struct objpool* objpool);
 void* objpool_alloc(struct objpool* objpool);
 void objpool_free(struct objpool* objpool, void* obj);
+void objpool_get_stats(struct objpool* objpool, struct objpool_stats* stats);
 
 #endif /* OBJPOOL_H */
@@ -27,6 +27,16 @@ struct platform {
 
     struct cache cache;
 
+    /**
+     * Bank index bits, least significant first, each given as a mask of physical address bits
+     * whose parity is the bit's value. Masks must not include bits within a page. Leave
+     * bank_mask_num at zero to disable bank partitioning.
+     */
+    struct {
+        size_t bank_mask_num;
+        paddr_t bank_masks[DRAM_BANK_MASKS_MAX];
+    } dram;
+
     struct arch_platform arch;
 };
 
@@ -0,0 +1,50 @@
+/**
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (c) Bao Project and Contributors. All rights reserved.
+ */
+
+#ifndef __RECOLOR_H__
+#define __RECOLOR_H__
+
+#include <bao.h>
+
+/**
+ * Online recoloring. The management VM named in the configuration may change the colors of any
+ * other running VM through the HC_RECOLOR hypercall. The VM's memory regions are then migrated
+ * to the new colors by its master cpu, in steps of RECOLOR_CHUNK_PAGES pages every
+ * RECOLOR_STEP_US microseconds, so the guest keeps running in between. During each step all of
+ * the VM's vcpus are paused while its pages outside the new colors are copied, remapped and the
+ * old ones freed. Each step is charged to the VM's memory bandwidth budget, and no step is taken
+ * while the VM is throttled.
+ *
+ * Regions placed at fixed physical addresses, shared memory and the VM's page tables keep their
+ * colors. New colors take effect for the VM's later allocations once migration is done.
+ */
+
+#ifndef RECOLOR_CHUNK_PAGES
+#define RECOLOR_CHUNK_PAGES (256)
+#endif
+
+#ifndef RECOLOR_STEP_US
+#define RECOLOR_STEP_US (1000)
+#endif
+
+/* HC_RECOLOR commands, passed in the first hypercall argument */
+enum recolor_cmd {
+    RECOLOR_CMD_START,  /* arg1: vm id, arg2: new colors */
+    RECOLOR_CMD_STATUS, /* arg1: vm id; returns an enum recolor_state */
+};
+
+enum recolor_state {
+    RECOLOR_IDLE,
+    RECOLOR_RUNNING,
+    RECOLOR_DONE,
+    RECOLOR_FAILED,
+};
+
+struct vm;
+
+void recolor_vm_init(struct vm* vm);
+long int recolor_hypercall(unsigned long cmd, unsigned long vm_id, unsigned long colors);
+
+#endif /* __RECOLOR_H__ */
@@ -6,6 +6,38 @@
 #ifndef __SPINLOCK_H__
 #define __SPINLOCK_H__
 
+#ifdef SPINLOCK_MCS
+
+#include <bao.h>
+
+/**
+ * Queued (MCS) spinlock, selected at build time with SPINLOCK=mcs in place of the architecture's
+ * ticket lock. Each waiter spins on a flag in its own queue node instead of on the shared lock
+ * word, so a release only invalidates the cache line of the next waiter. The lock word holds the
+ * tail of the queue, encoded as in spinlock.c, or zero if the lock is free.
+ *
+ * Queue nodes are per cpu, so a cpu may hold at most SPINLOCK_MCS_NODES locks at a time.
+ */
+typedef struct {
+    volatile uint32_t tail;
+} spinlock_t;
+
+#define SPINLOCK_MCS_NODES (4)
+
+static const spinlock_t SPINLOCK_INITVAL = { 0 };
+
+static inline void spinlock_init(spinlock_t* lock)
+{
+    lock->tail = 0;
+}
+
+void spin_lock(spinlock_t* lock);
+void spin_unlock(spinlock_t* lock);
+
+#else
+
 #include <arch/spinlock.h>
 
+#endif
+
 #endif /* __SPINLOCK_H__ */
@@ -1,36 +1,79 @@
 /**
- * SPDX-License-Identifier: Apache-2.0 
+ * SPDX-License-Identifier: Apache-2.0
  * Copyright (c) Bao Project and Contributors. All rights reserved
  */
 
-#ifndef __TIMER_MOD_H__
-#define __TIMER_MOD_H__s
+#ifndef __TIMER_H__
+#define __TIMER_H__
 
-#include <interrupts.h>
+#include <bao.h>
 #include <arch/timer.h>
 
-static inline uint64_t timer_init(uint64_t period) {
-    return timer_arch_init(period);
+/**
+ * Each cpu keeps its pending timer events in a binary min-heap ordered by absolute deadline (in
+ * system counter ticks). The hardware timer is always programmed with the deadline at the top of
+ * the heap, so any number of hypervisor modules can share the single per-cpu hypervisor timer.
+ * The queue is strictly per-cpu and only ever touched with interrupts masked, so no locking is
+ * needed. Events may be (re)armed or cancelled from their own or other event handlers.
+ */
+
+#ifndef TIMER_EVENTS_MAX
+#define TIMER_EVENTS_MAX (16)
+#endif
+
+#define TIMER_EVENT_IDLE ((size_t)-1)
+
+struct timer_event;
+
+typedef void (*timer_handler_t)(struct timer_event* event);
+
+struct timer_event {
+    uint64_t deadline;
+    timer_handler_t handler;
+    void* data;
+    size_t index;
+};
+
+struct timer_queue {
+    struct timer_event* heap[TIMER_EVENTS_MAX];
+    size_t size;
+    bool dispatching;
+};
+
+void timer_init(void);
+void timer_event_init(struct timer_event* event, timer_handler_t handler, void* data);
+void timer_event_add(struct timer_event* event, uint64_t deadline);
+void timer_event_cancel(struct timer_event* event);
+
+static inline bool timer_event_pending(struct timer_event* event)
+{
+    return event->index != TIMER_EVENT_IDLE;
 }
 
-static inline void timer_enable() {
-    timer_arch_enable();
+static inline uint64_t timer_get_ticks(void)
+{
+    return timer_arch_get_counter();
 }
 
-static inline void timer_disable() {
-    timer_arch_disable();
+static inline uint64_t timer_get_freq(void)
+{
+    return timer_arch_get_freq();
 }
 
-static inline void timer_define_irq_callback(irq_handler_t handler) {
-    timer_arch_define_irq_callback(handler);
+static inline uint64_t timer_us_to_ticks(uint64_t us)
+{
+    return (us * timer_arch_get_freq()) / 1000000;
 }
 
-static inline void timer_reschedule_interrupt(uint64_t count) {
-    timer_arch_reschedule_interrupt(count);
+static inline uint64_t timer_ticks_to_ns(uint64_t ticks)
+{
+    uint64_t freq = timer_arch_get_freq();
+    return ((ticks / freq) * 1000000000) + (((ticks % freq) * 1000000000) / freq);
 }
 
-static inline uint64_t timer_reschedule_interrupt_us(uint64_t period) {
-    return timer_arch_reschedule_interrupt_us(period);
+static inline void timer_event_add_us(struct timer_event* event, uint64_t us)
+{
+    timer_event_add(event, timer_get_ticks() + timer_us_to_ticks(us));
 }
 
-#endif /* __TIMER_MOD_H__ */
\ No newline at end of file
+#endif /* __TIMER_H__ */
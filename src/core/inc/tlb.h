@@ -21,6 +21,20 @@ static inline void tlb_inv_va(struct addr_space* as, vaddr_t va)
     }
 }
 
+/**
+ * Invalidate [va, va + size) with as few operations as the architecture allows, or the whole
+ * address space when that is cheaper.
+ */
+static inline void tlb_inv_range(struct addr_space* as, vaddr_t va, size_t size)
+{
+    if (as->type == AS_HYP) {
+        tlb_hyp_inv_range(va, size);
+    } else if (as->type == AS_VM) {
+        tlb_vm_inv_range(as->id, va, size);
+        // TODO: inval iommu tlbs
+    }
+}
+
 static inline void tlb_inv_all(struct addr_space* as)
 {
     if (as->type == AS_HYP) {
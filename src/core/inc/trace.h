@@ -0,0 +1,107 @@
+/**
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (c) Bao Project and Contributors. All rights reserved.
+ */
+
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <bao.h>
+#include <cpu.h>
+#include <timer.h>
+#include <fences.h>
+
+/**
+ * Binary event tracing. Each cpu owns a ring of fixed-size records stamped with the system
+ * counter. Only the owning cpu ever writes its ring, always with interrupts masked, so emitting a
+ * record is a handful of stores followed by a write barrier and the head update; no locks or
+ * atomics are needed. The head is a free-running record index: readers sample it, copy the
+ * records they are interested in, sample it again and discard any record older than
+ * (head - size), which may have been overwritten in the meantime.
+ *
+ * Tracing is selected at compile time per category with the TRACE make variable, e.g.,
+ * TRACE="IRQ PMU THROTTLE". Trace points of disabled categories compile to nothing. If
+ * config.trace.export is set, the rings are placed in the shared memory region
+ * config.trace.shmem_id so that a monitor VM mapping that region can read them.
+ */
+
+#define TRACE_MAGIC   (0x45434152544f4142ULL) /* "BAOTRACE" */
+#define TRACE_VERSION (1)
+
+#ifndef TRACE_RING_SIZE
+#define TRACE_RING_SIZE (1024)
+#endif
+
+enum trace_event {
+    TRACE_VM_EXIT,        /* arg0: exception class/cause, arg1: syndrome, arg2: fault address */
+    TRACE_IRQ_ARRIVAL,    /* arg0: irq id */
+    TRACE_IRQ_INJECT,     /* arg0: irq id, arg1: vcpu id */
+    TRACE_PMU_OVERFLOW,   /* arg1: overflowed counter mask */
+    TRACE_THROTTLE_ENTER, /* arg0: vm id, arg1: vm budget left */
+    TRACE_THROTTLE_EXIT,  /* arg0: vm id */
+    TRACE_PERIOD_REFILL,  /* arg0: vm id, arg1: vcpu budget */
+    TRACE_IPI_SEND,       /* arg0: target cpu, arg1: handler, arg2: event */
+    TRACE_IPI_RECV,       /* arg1: handler, arg2: event */
+    TRACE_MMIO,           /* arg0: write, arg1: address, arg2: value */
+};
+
+struct trace_record {
+    uint64_t timestamp;
+    uint32_t event;
+    uint32_t arg0;
+    uint64_t arg1;
+    uint64_t arg2;
+};
+
+struct trace_ring {
+    volatile uint64_t head;
+    uint64_t size;
+    struct trace_record records[];
+};
+
+/* Layout of the exported buffer: a header followed by cpu_num rings of ring_size records */
+struct trace_header {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t cpu_num;
+    uint64_t ring_size;
+    uint64_t record_size;
+    uint64_t timer_freq;
+    uint64_t rings_offset;
+    uint64_t ring_stride;
+};
+
+#define TRACE_ON(CAT) DEFINED(TRACE_CAT_##CAT)
+
+#define TRACE_EVENT(CAT, EVENT, ARG0, ARG1, ARG2)                                      \
+    do {                                                                               \
+        if (TRACE_ON(CAT)) {                                                           \
+            trace_emit((EVENT), (uint32_t)(ARG0), (uint64_t)(ARG1), (uint64_t)(ARG2)); \
+        }                                                                              \
+    } while (0)
+
+extern struct trace_ring* trace_rings[PLAT_CPU_NUM];
+
+void trace_init(void);
+
+static inline void trace_emit(enum trace_event event, uint32_t arg0, uint64_t arg1, uint64_t arg2)
+{
+    struct trace_ring* ring = trace_rings[cpu()->id];
+
+    if (ring == NULL) {
+        return;
+    }
+
+    uint64_t head = ring->head;
+    struct trace_record* record = &ring->records[head & (ring->size - 1)];
+    record->timestamp = timer_get_ticks();
+    record->event = event;
+    record->arg0 = arg0;
+    record->arg1 = arg1;
+    record->arg2 = arg2;
+
+    fence_ord_write();
+    ring->head = head + 1;
+}
+
+#endif /* __TRACE_H__ */
@@ -37,6 +37,7 @@ typedef size_t mpid_t;
 #define INVALID_MPID ((mpid_t)-1)
 
 typedef unsigned long colormap_t;
+typedef unsigned long bankmap_t;
 
 typedef unsigned long cpuid_t;
 typedef unsigned long vcpuid_t;
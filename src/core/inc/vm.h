@@ -17,6 +17,17 @@
 #include <bitmap.h>
 #include <io.h>
 #include <ipc.h>
+#include <trace.h>
+#include <exit_stats.h>
+#include <lz4.h>
+
+#ifndef VM_INSTALL_CHUNK
+#define VM_INSTALL_CHUNK (0x100000)
+#endif
+
+#ifndef VM_LAZY_CHUNK
+#define VM_LAZY_CHUNK (0x200000)
+#endif
 
 struct vm_mem_region {
     paddr_t base;
@@ -24,6 +35,13 @@ struct vm_mem_region {
     colormap_t colors;
     bool place_phys;
     paddr_t phys;
+    /**
+     * Map the region on the guest's first access to each of its VM_LAZY_CHUNK aligned chunks
+     * instead of at boot, except for the chunks holding the VM's image. Devices do not fault memory
+     * in, so the region must not be the target of DMA before the guest touches it. Ignored on
+     * MPU platforms.
+     */
+    bool lazy;
 };
 
 struct vm_dev_region {
@@ -66,6 +84,8 @@ struct vm {
     spinlock_t lock;
     struct cpu_synctoken sync;
     cpuid_t master;
+    /* Set when the VM can not go on, e.g., when a lazily mapped region runs out of memory */
+    volatile bool stopped;
 
     struct vcpu* vcpus;
     size_t cpu_num;
@@ -75,6 +95,23 @@ struct vm {
 
     struct addr_space as;
 
+    /**
+     * Image install shared out among the VM's cpus at boot, in chunks or, for compressed images,
+     * in blocks. Compressed blocks are claimed under lock, as each block's header gives the
+     * offset of the next.
+     */
+    struct {
+        vaddr_t src;
+        size_t src_size;
+        vaddr_t dst;
+        size_t size;
+        volatile uint32_t next_chunk;
+        spinlock_t lock;
+        struct lz4_frame frame;
+        size_t next_offset;
+        size_t done;
+    } install;
+
     struct vm_arch arch;
 
     struct list emul_mem_list;
@@ -100,6 +137,8 @@ struct vcpu {
 
     mem_throt_t mem_throt;
 
+    struct exit_stats exit_stats;
+
     struct vm* vm;
 };
 
@@ -114,7 +153,9 @@ struct vm* vm_init(struct vm_allocation* vm_alloc, const struct vm_config* confi
     vmid_t vm_id);
 void vm_start(struct vm* vm, vaddr_t entry);
 void vm_emul_add_mem(struct vm* vm, struct emul_mem* emu);
+bool vm_mem_fault(struct vm* vm, vaddr_t addr);
 void vm_emul_add_reg(struct vm* vm, struct emul_reg* emu);
+struct emul_mem* vm_emul_get_mem_region(struct vm* vm, vaddr_t addr);
 emul_handler_t vm_emul_get_mem(struct vm* vm, vaddr_t addr);
 emul_handler_t vm_emul_get_reg(struct vm* vm, vaddr_t addr);
 void vcpu_init(struct vcpu* vcpu, struct vm* vm, vaddr_t entry);
@@ -157,11 +198,13 @@ static inline bool vm_has_interrupt(struct vm* vm, irqid_t int_id)
 
 static inline void vcpu_inject_hw_irq(struct vcpu* vcpu, irqid_t id)
 {
+    TRACE_EVENT(IRQ, TRACE_IRQ_INJECT, id, vcpu->id, 0);
     vcpu_arch_inject_hw_irq(vcpu, id);
 }
 
 static inline void vcpu_inject_irq(struct vcpu* vcpu, irqid_t id)
 {
+    TRACE_EVENT(IRQ, TRACE_IRQ_INJECT, id, vcpu->id, 0);
     vcpu_arch_inject_irq(vcpu, id);
 }
 
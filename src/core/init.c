@@ -12,6 +12,7 @@
 #include <printk.h>
 #include <platform.h>
 #include <vmm.h>
+#include <timer.h>
 
 void init(cpuid_t cpu_id, paddr_t load_addr)
 {
@@ -32,6 +33,8 @@ void init(cpuid_t cpu_id, paddr_t load_addr)
 
     interrupts_init();
 
+    timer_init();
+
     vmm_init();
 
     /* Should never reach here */
@@ -9,6 +9,8 @@
 #include <vm.h>
 #include <bitmap.h>
 #include <string.h>
+#include <trace.h>
+#include <irq_lat.h>
 
 BITMAP_ALLOC(hyp_interrupt_bitmap, MAX_INTERRUPTS);
 BITMAP_ALLOC(global_interrupt_bitmap, MAX_INTERRUPTS);
@@ -21,6 +23,11 @@ inline void interrupts_cpu_sendipi(cpuid_t target_cpu, irqid_t ipi_id)
     interrupts_arch_ipi_send(target_cpu, ipi_id);
 }
 
+inline void interrupts_cpu_sendipi_mask(cpumap_t targets, irqid_t ipi_id)
+{
+    interrupts_arch_ipi_send_mask(targets, ipi_id);
+}
+
 inline void interrupts_cpu_enable(irqid_t int_id, bool en)
 {
     interrupts_arch_enable(int_id, en);
@@ -69,7 +76,10 @@ static inline bool interrupt_assigned(irqid_t int_id)
 
 enum irq_res interrupts_handle(irqid_t int_id)
 {
+    TRACE_EVENT(IRQ, TRACE_IRQ_ARRIVAL, int_id, 0, 0);
+
     if (vm_has_interrupt(cpu()->vcpu->vm, int_id)) {
+        irq_lat_arrival(int_id, cpu()->vcpu->mem_throt.throttled);
         vcpu_inject_hw_irq(cpu()->vcpu, int_id);
 
         return FORWARD_TO_VM;
@@ -95,6 +105,7 @@ bool interrupts_vm_assign(struct vm* vm, irqid_t id)
 
         bitmap_set(vm->interrupt_bitmap, id);
         bitmap_set(global_interrupt_bitmap, id);
+        irq_lat_track(id);
     }
     spin_unlock(&irq_reserve_lock);
 
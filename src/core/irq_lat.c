@@ -0,0 +1,193 @@
+/**
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (c) Bao Project and Contributors. All rights reserved.
+ */
+
+#include <irq_lat.h>
+#include <interrupts.h>
+#include <cpu.h>
+#include <vm.h>
+#include <timer.h>
+#include <spinlock.h>
+#include <string.h>
+#include <hypercall.h>
+
+struct irq_lat_entry {
+    spinlock_t lock;
+    irqid_t id;
+    bool inflight;
+    bool injected;
+    bool throttled;
+    unsigned long cookie;
+    uint64_t arrival;
+    uint32_t drops;
+    uint32_t hist[IRQ_LAT_HIST_NUM][IRQ_LAT_BUCKETS];
+};
+
+static struct irq_lat_entry irq_lat_entries[IRQ_LAT_MAX];
+static size_t irq_lat_entry_num;
+
+/* Entry index plus one of each tracked interrupt, zero if untracked */
+static uint16_t irq_lat_slot[MAX_INTERRUPTS];
+
+static const char* const irq_lat_hist_names[IRQ_LAT_HIST_NUM] = {
+    [IRQ_LAT_INJECT] = "inject",
+    [IRQ_LAT_COMPLETE] = "complete",
+    [IRQ_LAT_THROTTLED_INJECT] = "throttled inject",
+    [IRQ_LAT_THROTTLED_COMPLETE] = "throttled complete",
+};
+
+static inline struct irq_lat_entry* irq_lat_get(irqid_t id)
+{
+    if ((id >= MAX_INTERRUPTS) || (irq_lat_slot[id] == 0)) {
+        return NULL;
+    }
+    return &irq_lat_entries[irq_lat_slot[id] - 1];
+}
+
+static inline size_t irq_lat_bucket(uint64_t ns)
+{
+    size_t bucket = (ns == 0) ? 0 : (size_t)(63 - __builtin_clzll(ns));
+    return (bucket < IRQ_LAT_BUCKETS) ? bucket : (IRQ_LAT_BUCKETS - 1);
+}
+
+static inline void irq_lat_account(struct irq_lat_entry* entry, enum irq_lat_hist hist)
+{
+    uint64_t ns = timer_ticks_to_ns(timer_get_ticks() - entry->arrival);
+    entry->hist[hist][irq_lat_bucket(ns)]++;
+}
+
+/* Called with the interrupt reservation lock held when an interrupt is assigned to a VM */
+void irq_lat_track(irqid_t id)
+{
+    if (!DEFINED(IRQ_LATENCY) || (id >= MAX_INTERRUPTS) || (irq_lat_slot[id] != 0)) {
+        return;
+    }
+
+    if (irq_lat_entry_num >= IRQ_LAT_MAX) {
+        WARNING("irq_lat: no free entry to track interrupt %d", id);
+        return;
+    }
+
+    struct irq_lat_entry* entry = &irq_lat_entries[irq_lat_entry_num];
+    entry->lock = SPINLOCK_INITVAL;
+    entry->id = id;
+    irq_lat_slot[id] = (uint16_t)(++irq_lat_entry_num);
+}
+
+void irq_lat_record_arrival(irqid_t id, bool throttled)
+{
+    struct irq_lat_entry* entry = irq_lat_get(id);
+
+    if (entry == NULL) {
+        return;
+    }
+
+    spin_lock(&entry->lock);
+    if (entry->inflight) {
+        entry->drops++;
+    } else {
+        entry->inflight = true;
+        entry->injected = false;
+        entry->throttled = throttled;
+        entry->arrival = timer_get_ticks();
+    }
+    spin_unlock(&entry->lock);
+}
+
+void irq_lat_record_inject(irqid_t id, unsigned long cookie, bool throttled)
+{
+    struct irq_lat_entry* entry = irq_lat_get(id);
+
+    if (entry == NULL) {
+        return;
+    }
+
+    spin_lock(&entry->lock);
+    /* A spilled interrupt may be written to a list register more than once; keep the first */
+    if (entry->inflight && !entry->injected) {
+        entry->injected = true;
+        entry->throttled |= throttled;
+        entry->cookie = cookie;
+        irq_lat_account(entry, entry->throttled ? IRQ_LAT_THROTTLED_INJECT : IRQ_LAT_INJECT);
+    } else if (entry->inflight) {
+        entry->cookie = cookie;
+    }
+    spin_unlock(&entry->lock);
+}
+
+void irq_lat_record_complete(irqid_t id, unsigned long cookie)
+{
+    struct irq_lat_entry* entry = irq_lat_get(id);
+
+    if (entry == NULL) {
+        return;
+    }
+
+    spin_lock(&entry->lock);
+    if (entry->inflight && entry->injected && (entry->cookie == cookie)) {
+        irq_lat_account(entry, entry->throttled ? IRQ_LAT_THROTTLED_COMPLETE : IRQ_LAT_COMPLETE);
+        entry->inflight = false;
+    }
+    spin_unlock(&entry->lock);
+}
+
+static void irq_lat_dump(struct irq_lat_entry* entry)
+{
+    INFO("irq_lat: interrupt %d, %d dropped", entry->id, entry->drops);
+    for (size_t hist = 0; hist < IRQ_LAT_HIST_NUM; hist++) {
+        for (size_t bucket = 0; bucket < IRQ_LAT_BUCKETS; bucket++) {
+            if (entry->hist[hist][bucket] != 0) {
+                INFO("irq_lat:   %s [2^%d ns]: %d", irq_lat_hist_names[hist], bucket,
+                    entry->hist[hist][bucket]);
+            }
+        }
+    }
+}
+
+static void irq_lat_reset(struct irq_lat_entry* entry)
+{
+    entry->drops = 0;
+    memset(entry->hist, 0, sizeof(entry->hist));
+}
+
+long int irq_lat_hypercall(unsigned long cmd, unsigned long arg1, unsigned long arg2)
+{
+    struct vm* vm = cpu()->vcpu->vm;
+
+    if (!DEFINED(IRQ_LATENCY)) {
+        return -HC_E_INVAL_ID;
+    }
+
+    if (cmd == IRQ_LAT_CMD_READ) {
+        size_t hist = (arg2 >> 8) & 0xff;
+        size_t bucket = arg2 & 0xff;
+        struct irq_lat_entry* entry = irq_lat_get((irqid_t)arg1);
+        if ((entry == NULL) || !vm_has_interrupt(vm, (irqid_t)arg1) ||
+            ((bucket != IRQ_LAT_DROPS) && ((hist >= IRQ_LAT_HIST_NUM) ||
+                                              (bucket >= IRQ_LAT_BUCKETS)))) {
+            return -HC_E_INVAL_ARGS;
+        }
+        return (long int)((bucket == IRQ_LAT_DROPS) ? entry->drops : entry->hist[hist][bucket]);
+    }
+
+    if ((cmd != IRQ_LAT_CMD_DUMP) && (cmd != IRQ_LAT_CMD_RESET)) {
+        return -HC_E_INVAL_ARGS;
+    }
+
+    for (size_t i = 0; i < irq_lat_entry_num; i++) {
+        struct irq_lat_entry* entry = &irq_lat_entries[i];
+        if (!vm_has_interrupt(vm, entry->id)) {
+            continue;
+        }
+        spin_lock(&entry->lock);
+        if (cmd == IRQ_LAT_CMD_DUMP) {
+            irq_lat_dump(entry);
+        } else {
+            irq_lat_reset(entry);
+        }
+        spin_unlock(&entry->lock);
+    }
+
+    return HC_E_SUCCESS;
+}
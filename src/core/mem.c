@@ -18,89 +18,45 @@ extern uint8_t _image_start, _image_load_end, _image_end, _vm_image_start, _vm_i
 
 struct list page_pool_list;
 
-bool pp_alloc(struct page_pool* pool, size_t num_pages, bool aligned, struct ppages* ppages)
-{
-    ppages->colors = 0;
-    ppages->num_pages = 0;
+size_t DRAM_BANK_NUM = 1;
+size_t DRAM_BANK_SPAN = ((size_t)1) << ((sizeof(size_t) * 8) - 1);
 
-    bool ok = false;
+size_t mem_page_bank(paddr_t pa)
+{
+    size_t bank = 0;
 
-    if (num_pages == 0) {
-        return true;
+    for (size_t i = 0; i < platform.dram.bank_mask_num; i++) {
+        bank |= ((size_t)__builtin_parityl(pa & platform.dram.bank_masks[i])) << i;
     }
 
-    spin_lock(&pool->lock);
-
-    /**
-     * If we need a contigous segment aligned to its size, lets start at an already aligned index.
-     */
-    size_t start = aligned ? pool->base / PAGE_SIZE % num_pages : 0;
-    size_t curr = pool->last + ((pool->last + start) % num_pages);
-
-    /**
-     * Lets make two searches:
-     *  - one starting from the last known free index.
-     *  - in case this does not work, start from index 0.
-     */
-    for (size_t i = 0; i < 2 && !ok; i++) {
-        while (pool->free != 0) {
-            ssize_t bit = bitmap_find_consec(pool->bitmap, pool->size, curr, num_pages, false);
-
-            if (bit < 0) {
-                /**
-                 * No num_page page sement was found. If this is the first iteration set position
-                 * to 0 to start next search from index
-                 * 0.
-                 */
-                size_t next_aligned =
-                    (num_pages - ((pool->base / PAGE_SIZE) % num_pages)) % num_pages;
-                curr = aligned ? next_aligned : 0;
-                break;
-            } else if (aligned && (((((size_t)bit) + start) % num_pages) != 0)) {
-                /**
-                 * If we're looking for an aligned segment and the found contigous segment is not
-                 * aligned, start the search again from the last aligned index
-                 */
-                curr = ((size_t)bit) + ((((size_t)bit) + start) % num_pages);
-            } else {
-                /**
-                 * We've found our pages. Fill output argument info, mark them as allocated, and
-                 * update page pool bookkeeping.
-                 */
-                ppages->base = pool->base + (((size_t)bit) * PAGE_SIZE);
-                ppages->num_pages = num_pages;
-                bitmap_set_consecutive(pool->bitmap, ((size_t)bit), num_pages);
-                pool->free -= num_pages;
-                pool->last = ((size_t)bit) + num_pages;
-                ok = true;
-                break;
-            }
-        }
-    }
-    spin_unlock(&pool->lock);
-
-    return ok;
+    return bank;
 }
 
-static bool mem_are_ppages_reserved_in_pool(struct page_pool* ppool, struct ppages* ppages)
+static void mem_dram_init(void)
 {
-    bool reserved = false;
-    bool rgn_found = range_in_range(ppages->base, ppages->num_pages * PAGE_SIZE, ppool->base,
-        ppool->size * PAGE_SIZE);
-    if (rgn_found) {
-        size_t pageoff = NUM_PAGES(ppages->base - ppool->base);
-
-        // verify these pages arent allocated yet
-        bool is_alloced = bitmap_get(ppool->bitmap, pageoff);
-        size_t avlbl_contig_pp =
-            bitmap_count_consecutive(ppool->bitmap, ppool->size, pageoff, ppages->num_pages);
-
-        if (is_alloced || avlbl_contig_pp < ppages->num_pages) {
-            reserved = true;
+    paddr_t all_masks = 0;
+    size_t num = platform.dram.bank_mask_num;
+
+    if (num > DRAM_BANK_MASKS_MAX) {
+        WARNING("dram: %d bank masks, at most %d supported", num, DRAM_BANK_MASKS_MAX);
+        num = 0;
+    }
+
+    for (size_t i = 0; i < num; i++) {
+        paddr_t mask = platform.dram.bank_masks[i];
+        if ((mask == 0) || ((mask & (PAGE_SIZE - 1)) != 0)) {
+            WARNING("dram: invalid bank mask 0x%lx", mask);
+            num = 0;
         }
+        all_masks |= mask;
     }
 
-    return reserved;
+    /* An invalid description disables bank partitioning rather than mapping banks wrongly */
+    platform.dram.bank_mask_num = num;
+    if (num > 0) {
+        DRAM_BANK_NUM = ((size_t)1) << num;
+        DRAM_BANK_SPAN = (((paddr_t)1) << bit_ffs(all_masks)) / PAGE_SIZE;
+    }
 }
 
 static bool mem_reserve_ppool_ppages(struct page_pool* pool, struct ppages* ppages)
@@ -113,15 +69,7 @@ static bool mem_reserve_ppool_ppages(struct page_pool* pool, struct ppages* ppag
 
     size_t pageoff = NUM_PAGES(ppages->base - pool->base);
 
-    bool was_free = true;
-    if (mem_are_ppages_reserved_in_pool(pool, ppages)) {
-        was_free = false;
-    }
-
-    bitmap_set_consecutive(pool->bitmap, pageoff, ppages->num_pages);
-    pool->free -= ppages->num_pages;
-
-    return is_in_rgn && was_free;
+    return pp_take(pool, pageoff, ppages->num_pages);
 }
 
 void* mem_alloc_page(size_t num_pages, enum AS_SEC sec, bool phys_aligned)
@@ -136,26 +84,24 @@ void* mem_alloc_page(size_t num_pages, enum AS_SEC sec, bool phys_aligned)
     return (void*)vpage;
 }
 
-static bool root_pool_set_up_bitmap(paddr_t load_addr, struct page_pool* root_pool)
+static bool root_pool_set_up_meta(paddr_t load_addr, struct page_pool* root_pool)
 {
     size_t image_size = (size_t)(&_image_end - &_image_start);
     size_t vm_image_size = (size_t)(&_vm_image_end - &_vm_image_start);
     size_t cpu_size = platform.cpu_num * mem_cpu_boot_alloc_size();
 
-    size_t bitmap_num_pages =
-        root_pool->size / (8 * PAGE_SIZE) + ((root_pool->size % (8 * PAGE_SIZE) != 0) ? 1 : 0);
-    if (root_pool->size <= bitmap_num_pages) {
+    size_t meta_num_pages = pp_meta_pages(root_pool->size);
+    if (root_pool->size <= meta_num_pages) {
         return false;
     }
-    size_t bitmap_base = load_addr + image_size + vm_image_size + cpu_size;
+    size_t meta_base = load_addr + image_size + vm_image_size + cpu_size;
 
-    struct ppages bitmap_pp = mem_ppages_get(bitmap_base, bitmap_num_pages);
-    bitmap_t* root_bitmap = (bitmap_t*)mem_alloc_map(&cpu()->as, SEC_HYP_GLOBAL, &bitmap_pp,
-        INVALID_VA, bitmap_num_pages, PTE_HYP_FLAGS);
-    root_pool->bitmap = root_bitmap;
-    memset((void*)root_pool->bitmap, 0, bitmap_num_pages * PAGE_SIZE);
+    struct ppages meta_pp = mem_ppages_get(meta_base, meta_num_pages);
+    void* root_meta = (void*)mem_alloc_map(&cpu()->as, SEC_HYP_GLOBAL, &meta_pp, INVALID_VA,
+        meta_num_pages, PTE_HYP_FLAGS);
+    pp_setup(root_pool, root_meta);
 
-    return mem_reserve_ppool_ppages(root_pool, &bitmap_pp);
+    return mem_reserve_ppool_ppages(root_pool, &meta_pp);
 }
 
 static bool pp_root_reserve_hyp_mem(paddr_t load_addr, struct page_pool* root_pool)
@@ -185,22 +131,18 @@ static bool pp_root_init(paddr_t load_addr, struct mem_region* root_region)
     root_pool->base = ALIGN(root_region->base, PAGE_SIZE);
     root_pool->size = root_region->size / PAGE_SIZE; /* TODO: what if not
                                                         aligned? */
-    root_pool->free = root_pool->size;
 
-    if (!root_pool_set_up_bitmap(load_addr, root_pool)) {
-        return false;
-    }
-    if (!pp_root_reserve_hyp_mem(load_addr, root_pool)) {
+    if (!root_pool_set_up_meta(load_addr, root_pool)) {
         return false;
     }
 
-    root_pool->last = 0;
-    return true;
+    return pp_root_reserve_hyp_mem(load_addr, root_pool);
 }
 
 static void pp_init(struct page_pool* pool, paddr_t base, size_t size)
 {
     struct ppages pages;
+    void* meta;
 
     if (pool == NULL) {
         return;
@@ -209,26 +151,23 @@ static void pp_init(struct page_pool* pool, paddr_t base, size_t size)
     memset((void*)pool, 0, sizeof(struct page_pool));
     pool->base = ALIGN(base, PAGE_SIZE);
     pool->size = NUM_PAGES(size);
-    size_t bitmap_size = pool->size / (8 * PAGE_SIZE) + !!(pool->size % (8 * PAGE_SIZE) != 0);
+    size_t meta_size = pp_meta_pages(pool->size);
 
-    if (size <= bitmap_size) {
+    if (pool->size <= meta_size) {
         return;
     }
 
-    pages = mem_alloc_ppages(cpu()->as.colors, bitmap_size, false);
-    if (pages.num_pages != bitmap_size) {
+    pages = mem_alloc_ppages(cpu()->as.colors, meta_size, false);
+    if (pages.num_pages != meta_size) {
         return;
     }
 
-    if ((pool->bitmap = (bitmap_t*)mem_alloc_map(&cpu()->as, SEC_HYP_GLOBAL, &pages, INVALID_VA,
-             bitmap_size, PTE_HYP_FLAGS)) == NULL) {
+    if ((meta = (void*)mem_alloc_map(&cpu()->as, SEC_HYP_GLOBAL, &pages, INVALID_VA, meta_size,
+             PTE_HYP_FLAGS)) == NULL) {
         return;
     }
 
-    memset((void*)pool->bitmap, 0, bitmap_size * PAGE_SIZE);
-
-    pool->last = 0;
-    pool->free = pool->size;
+    pp_setup(pool, meta);
 }
 
 static bool mem_vm_img_in_phys_rgn(struct vm_config* vm_config)
@@ -240,7 +179,7 @@ static bool mem_vm_img_in_phys_rgn(struct vm_config* vm_config)
             vaddr_t rgn_base = vm_config->platform.regions[i].phys;
             size_t rgn_size = vm_config->platform.regions[i].size;
             paddr_t img_base = vm_config->image.load_addr;
-            size_t img_size = vm_config->image.size;
+            size_t img_size = vm_config_image_load_size(vm_config);
             if (range_in_range(img_base, img_size, rgn_base, rgn_size)) {
                 img_in_rgn = true;
                 break;
@@ -259,7 +198,7 @@ static bool mem_reserve_physical_memory(struct page_pool* pool)
 
     for (size_t i = 0; i < config.vmlist_size; i++) {
         struct vm_config* vm_cfg = &config.vmlist[i];
-        size_t n_pg = NUM_PAGES(vm_cfg->image.size);
+        size_t n_pg = NUM_PAGES(vm_config_image_load_size(vm_cfg));
         struct ppages ppages = mem_ppages_get(vm_cfg->image.load_addr, n_pg);
 
         // If the vm image is part of a statically allocated region of the same vm, we defer the
@@ -376,25 +315,40 @@ __attribute__((weak)) bool mem_map_reclr(struct addr_space* as, vaddr_t va, stru
     ERROR("Trying to recolor section but there is no coloring implementation");
 }
 
+__attribute__((weak)) bool mem_reclr_pages(struct addr_space* as, vaddr_t va, size_t num_pages,
+    colormap_t colors, size_t* reclrd_num)
+{
+    UNUSED_ARG(as);
+    UNUSED_ARG(va);
+    UNUSED_ARG(num_pages);
+    UNUSED_ARG(colors);
+    UNUSED_ARG(reclrd_num);
+
+    ERROR("Trying to recolor mapped pages but there is no coloring implementation");
+}
+
 __attribute__((weak)) bool pp_alloc_clr(struct page_pool* pool, size_t num_pages, colormap_t colors,
-    struct ppages* ppages)
+    bankmap_t banks, struct ppages* ppages)
 {
     UNUSED_ARG(pool);
     UNUSED_ARG(num_pages);
     UNUSED_ARG(colors);
+    UNUSED_ARG(banks);
     UNUSED_ARG(ppages);
 
     ERROR("Trying to allocate colored pages but there is no coloring "
           "implementation");
 }
 
-struct ppages mem_alloc_ppages(colormap_t colors, size_t num_pages, bool aligned)
+struct ppages mem_alloc_ppages_banks(colormap_t colors, bankmap_t banks, size_t num_pages,
+    bool aligned)
 {
     struct ppages pages = { .num_pages = 0 };
 
     list_foreach (page_pool_list, struct page_pool, pool) {
-        bool ok = (!all_clrs(colors) && !aligned) ? pp_alloc_clr(pool, num_pages, colors, &pages) :
-                                                    pp_alloc(pool, num_pages, aligned, &pages);
+        bool ok = (!all_clrs_banks(colors, banks) && !aligned) ?
+            pp_alloc_clr(pool, num_pages, colors, banks, &pages) :
+            pp_alloc(pool, num_pages, aligned, &pages);
         if (ok) {
             break;
         }
@@ -403,6 +357,35 @@ struct ppages mem_alloc_ppages(colormap_t colors, size_t num_pages, bool aligned
     return pages;
 }
 
+/**
+ * Count the pages of all pools within a color and bank partition. Pages in the same aligned
+ * segment of both COLOR_SIZE and DRAM_BANK_SPAN pages are in the same partition, so the count
+ * goes a segment at a time.
+ */
+size_t mem_part_num_pages(colormap_t colors, bankmap_t banks)
+{
+    size_t step = DRAM_BANK_SPAN;
+    size_t num_pages = 0;
+
+    while ((COLOR_SIZE % step) != 0) {
+        step /= 2;
+    }
+
+    list_foreach (page_pool_list, struct page_pool, pool) {
+        size_t pfn = pool->base / PAGE_SIZE;
+        size_t end = pfn + pool->size;
+        while (pfn < end) {
+            size_t next = min(ALIGN(pfn + 1, step), end);
+            if (mem_page_in_clrs_banks(pfn * PAGE_SIZE, colors, banks)) {
+                num_pages += next - pfn;
+            }
+            pfn = next;
+        }
+    }
+
+    return num_pages;
+}
+
 void mem_init(paddr_t load_addr)
 {
     mem_prot_init();
@@ -411,6 +394,7 @@ void mem_init(paddr_t load_addr)
 
     if (cpu_is_master()) {
         cache_enumerate();
+        mem_dram_init();
 
         if (!mem_setup_root_pool(load_addr, &root_mem_region)) {
             ERROR("couldn't not initialize root pool");
@@ -7,17 +7,27 @@
 #include <cpu.h>
 #include <vm.h>
 #include <spinlock.h>
+#include <trace.h>
 
 spinlock_t lock;
 
-void mem_throt_period_timer_callback(irqid_t int_id) {
-    timer_disable();
+void mem_throt_period_timer_callback(struct timer_event* event) {
+    uint64_t next_deadline = event->deadline + cpu()->vcpu->vm->mem_throt.period_counts;
+
+    /* Re-arm on the absolute period boundary so regulation periods do not drift */
+    if (next_deadline <= timer_get_ticks()) {
+        next_deadline = timer_get_ticks() + cpu()->vcpu->vm->mem_throt.period_counts;
+    }
+    timer_event_add(event, next_deadline);
+
     events_cntr_disable(cpu()->vcpu->vm->mem_throt.counter_id);
-    timer_reschedule_interrupt(cpu()->vcpu->vm->mem_throt.period_counts);
     events_cntr_set(cpu()->vcpu->vm->mem_throt.counter_id, cpu()->vcpu->mem_throt.budget);
 
+    TRACE_EVENT(THROTTLE, TRACE_PERIOD_REFILL, cpu()->vcpu->vm->id, cpu()->vcpu->mem_throt.budget, 0);
+
     if (cpu()->vcpu->mem_throt.throttled)  
     {
+        TRACE_EVENT(THROTTLE, TRACE_THROTTLE_EXIT, cpu()->vcpu->vm->id, 0, 0);
         events_cntr_irq_enable(cpu()->vcpu->vm->mem_throt.counter_id);
         cpu()->vcpu->mem_throt.throttled = false;
     }
@@ -25,11 +35,11 @@ void mem_throt_period_timer_callback(irqid_t int_id) {
     
     if (cpu()->vcpu->vm->master) 
         cpu()->vcpu->vm->mem_throt.budget_left = cpu()->vcpu->vm->mem_throt.budget;
-    
-    timer_enable();
-
 }
-void mem_throt_event_overflow_callback(irqid_t int_id) {
+
+void mem_throt_event_overflow_callback(size_t counter, void* ctx) {
+    UNUSED_ARG(counter);
+    UNUSED_ARG(ctx);
 
     events_clear_cntr_ovs(cpu()->vcpu->vm->mem_throt.counter_id);
     events_cntr_disable(cpu()->vcpu->vm->mem_throt.counter_id);
@@ -40,31 +50,42 @@ void mem_throt_event_overflow_callback(irqid_t int_id) {
     spin_unlock(&lock);
     
     cpu()->vcpu->mem_throt.throttled = true;  
+    TRACE_EVENT(THROTTLE, TRACE_THROTTLE_ENTER, cpu()->vcpu->vm->id, cpu()->vcpu->vm->mem_throt.budget_left, 0);
     cpu_standby();
 
 }
 
 
-void mem_throt_timer_init(irq_handler_t handler) {
-    timer_define_irq_callback(handler);
-    cpu()->vcpu->vm->mem_throt.period_counts = timer_init(cpu()->vcpu->vm->mem_throt.period_us);
+void mem_throt_timer_init(timer_handler_t handler) {
+    cpu()->vcpu->vm->mem_throt.period_counts = timer_us_to_ticks(cpu()->vcpu->vm->mem_throt.period_us);
+    timer_event_init(&cpu()->vcpu->mem_throt.period_timer, handler, NULL);
+    timer_event_add(&cpu()->vcpu->mem_throt.period_timer,
+        timer_get_ticks() + cpu()->vcpu->vm->mem_throt.period_counts);
 }
 
 
-void mem_throt_events_init(events_enum event, unsigned long budget, irq_handler_t handler) {
+bool mem_throt_events_init(events_enum event, unsigned long budget, events_ovf_handler_t handler) {
 
-    if ((cpu()->vcpu->vm->mem_throt.counter_id = events_cntr_alloc()) == ERROR_NO_MORE_EVENT_COUNTERS) {
-        ERROR("No more event counters!");
+    /* Regulation needs a pinned counter; running out only leaves this cpu unregulated */
+    size_t counter = events_cntr_alloc();
+    if (counter == (size_t)ERROR_NO_MORE_EVENT_COUNTERS) {
+        WARNING("cpu%d: no event counter left, memory bandwidth not regulated", cpu()->id);
+        return false;
     }
+    cpu()->vcpu->vm->mem_throt.counter_id = counter;
+    cpu()->vcpu->mem_throt.counter_id = counter;
+    cpu()->vcpu->mem_throt.regulated = true;
 
     events_set_evtyper(cpu()->vcpu->vm->mem_throt.counter_id, event);
     events_cntr_set(cpu()->vcpu->vm->mem_throt.counter_id, budget);
-    events_cntr_set_irq_callback(handler, cpu()->vcpu->vm->mem_throt.counter_id);
+    events_cntr_set_owner(cpu()->vcpu->vm->mem_throt.counter_id, EVENTS_OWNER_REGULATOR, handler, cpu()->vcpu);
     events_clear_cntr_ovs(cpu()->vcpu->vm->mem_throt.counter_id);
     events_interrupt_enable(cpu()->id);
     events_cntr_irq_enable(cpu()->vcpu->vm->mem_throt.counter_id);
     events_enable();
     events_cntr_enable(cpu()->vcpu->vm->mem_throt.counter_id);
+
+    return true;
 }
 
 inline void mem_throt_budget_change(size_t budget) {
@@ -73,6 +94,17 @@ inline void mem_throt_budget_change(size_t budget) {
     events_cntr_irq_enable(cpu()->vcpu->vm->mem_throt.counter_id);
 }
 
+void mem_throt_charge(size_t bytes) {
+    if (!cpu()->vcpu->mem_throt.regulated) return;
+
+    size_t counter = cpu()->vcpu->mem_throt.counter_id;
+    uint64_t left = UINT32_MAX - events_get_cntr_value(counter);
+    uint64_t accesses = bytes / MEM_THROT_ACCESS_SIZE;
+
+    /* Leaving nothing makes the counter overflow, and the vcpu be throttled, on its next access */
+    events_cntr_set(counter, (left > accesses) ? (left - accesses) : 0);
+}
+
 void mem_throt_config(size_t period_us, size_t vm_budget, size_t* cpu_ratio) {
     if(vm_budget == 0) return;
 
@@ -116,7 +148,9 @@ void mem_throt_init() {
 
     cpu()->vcpu->vm->mem_throt.budget -= cpu()->vcpu->mem_throt.budget;
     
-    mem_throt_events_init(bus_access, cpu()->vcpu->mem_throt.budget, mem_throt_event_overflow_callback);
+    if (!mem_throt_events_init(bus_access, cpu()->vcpu->mem_throt.budget, mem_throt_event_overflow_callback)) {
+        return;
+    }
     mem_throt_timer_init(mem_throt_period_timer_callback);
 }
 
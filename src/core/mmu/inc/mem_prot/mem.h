@@ -16,6 +16,7 @@ struct addr_space {
     struct page_table pt;
     enum AS_TYPE type;
     colormap_t colors;
+    bankmap_t banks;
     asid_t id;
     spinlock_t lock;
 };
@@ -25,4 +26,9 @@ typedef pte_t mem_flags_t;
 void as_init(struct addr_space* as, enum AS_TYPE type, asid_t id, pte_t* root_pt, colormap_t colors);
 vaddr_t mem_alloc_vpage(struct addr_space* as, enum AS_SEC section, vaddr_t at, size_t n);
 
+/* The MMU backend keeps no pools worth reporting */
+static inline void mem_prot_report(void)
+{
+}
+
 #endif /* __MEM_PROT_H__ */
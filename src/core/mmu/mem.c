@@ -15,6 +15,7 @@
 #include <fences.h>
 #include <tlb.h>
 #include <config.h>
+#include <atomic.h>
 
 extern uint8_t _image_start, _image_load_end, _image_end, _dmem_phys_beg, _dmem_beg,
     _cpu_private_beg, _cpu_private_end, _vm_beg, _vm_end, _vm_image_start, _vm_image_end;
@@ -62,12 +63,14 @@ size_t mem_cpu_boot_alloc_size(void)
     return size;
 }
 
-static inline size_t pp_next_clr(paddr_t base, size_t from, colormap_t colors)
+static inline size_t pp_next_clr(paddr_t base, size_t from, colormap_t colors, bankmap_t banks)
 {
     size_t clr_offset = (base / PAGE_SIZE) % (COLOR_NUM * COLOR_SIZE);
     size_t index = from;
+    bool any_clr = all_clrs(colors);
 
-    while (!((colors >> ((index + clr_offset) / COLOR_SIZE % COLOR_NUM)) & 1)) {
+    while (!(any_clr || ((colors >> ((index + clr_offset) / COLOR_SIZE % COLOR_NUM)) & 1)) ||
+        !mem_page_in_banks(base + (index * PAGE_SIZE), banks)) {
         index++;
     }
 
@@ -80,85 +83,123 @@ static void mem_free_ppages(struct ppages* ppages)
         spin_lock(&pool->lock);
         if (in_range(ppages->base, pool->base, pool->size * PAGE_SIZE)) {
             size_t index = (ppages->base - pool->base) / PAGE_SIZE;
-            if (!all_clrs(ppages->colors)) {
+            if (!all_clrs_banks(ppages->colors, ppages->banks)) {
                 for (size_t i = 0; i < ppages->num_pages; i++) {
-                    index = pp_next_clr(pool->base, index, ppages->colors);
-                    bitmap_clear(pool->bitmap, index++);
+                    index = pp_next_clr(pool->base, index, ppages->colors, ppages->banks);
+                    pp_free(pool, index++, 1);
                 }
             } else {
-                bitmap_clear_consecutive(pool->bitmap, index, ppages->num_pages);
+                pp_free(pool, index, ppages->num_pages);
             }
         }
         spin_unlock(&pool->lock);
     }
 }
 
-bool pp_alloc_clr(struct page_pool* pool, size_t n, colormap_t colors, struct ppages* ppages)
+/**
+ * Bitmap of the pages with one of the given colors, and in one of the given banks, among those
+ * covered by a pool bitmap word. Colors change every COLOR_SIZE pages and banks at most every
+ * DRAM_BANK_SPAN pages, so this costs one step per segment in the word.
+ */
+static bitmap_granule_t pp_clr_pattern(struct page_pool* pool, size_t word, colormap_t colors,
+    bankmap_t banks)
 {
-    size_t allocated = 0;
+    size_t clr_offset = (pool->base / PAGE_SIZE) % (COLOR_NUM * COLOR_SIZE);
+    size_t base_pfn = pool->base / PAGE_SIZE;
+    size_t first = word * BITMAP_GRANULE_LEN;
+    size_t last = first + BITMAP_GRANULE_LEN;
+    bitmap_granule_t pattern = 0;
+
+    for (size_t page = first; page < last;) {
+        size_t clr_page = page + clr_offset;
+        size_t seg_end = min(last, page + COLOR_SIZE - (clr_page % COLOR_SIZE));
+        seg_end = min(seg_end, page + DRAM_BANK_SPAN - ((base_pfn + page) % DRAM_BANK_SPAN));
+        if (mem_page_in_clrs_banks(pool->base + (page * PAGE_SIZE), colors, banks)) {
+            pattern |= BITMAP_GRANULE_MASK(page - first, seg_end - page);
+        }
+        page = seg_end;
+    }
+
+    return pattern;
+}
 
-    size_t first_index = 0;
+bool pp_alloc_clr(struct page_pool* pool, size_t n, colormap_t colors, bankmap_t banks,
+    struct ppages* ppages)
+{
+    size_t run = 0;
+    size_t run_start = 0;
     bool ok = false;
 
+    /**
+     * If the color pattern period divides a bitmap word, all words share the same pattern. Bank
+     * patterns are not periodic in general, with hashed bank bits.
+     */
+    bool periodic = all_banks(banks) && ((BITMAP_GRANULE_LEN % (COLOR_NUM * COLOR_SIZE)) == 0);
+    bitmap_granule_t pattern = pp_clr_pattern(pool, 0, colors, banks);
+
     ppages->colors = colors;
+    ppages->banks = banks;
     ppages->num_pages = 0;
 
     spin_lock(&pool->lock);
 
     /**
-     * Lets start the search at the first available color after the last known free position to the
-     * top of the pool.
-     */
-    size_t index = pp_next_clr(pool->base, pool->last, colors);
-    size_t top = pool->size;
-
-    /**
-     * Two iterations. One starting from the last known free page, other starting from the
-     * beggining of page pool to the start of the previous iteration.
+     * Two iterations. One starting from the last known free page to the top of the pool, other
+     * starting from the beggining of page pool.
+     *
+     * The search looks for n free pages contiguous on the target colors, i.e., with no allocated
+     * page of those colors in between, going through the allocation bitmap a word at a time.
      */
+    size_t start = pool->last;
     for (size_t i = 0; i < 2 && !ok; i++) {
-        while ((allocated < n) && (index < top)) {
-            allocated = 0;
-
-            /* Find first free page on the target colors */
-            while ((index < top) && bitmap_get(pool->bitmap, index)) {
-                index = pp_next_clr(pool->base, ++index, colors);
+        run = 0;
+        for (size_t word = start / BITMAP_GRANULE_LEN;
+             (run < n) && ((word * BITMAP_GRANULE_LEN) < pool->size); word++) {
+            size_t first = word * BITMAP_GRANULE_LEN;
+            bitmap_granule_t in_clr =
+                periodic ? pattern : pp_clr_pattern(pool, word, colors, banks);
+
+            if (first < start) {
+                in_clr &= ~BITMAP_GRANULE_MASK(0, start - first);
             }
-            first_index = index;
-
-            /**
-             * Count the number of free pages contigous on the target color segement until n pages
-             * are found or we reach top page of the search.
-             */
-            while ((index < top) && (bitmap_get(pool->bitmap, index) == 0) && (allocated < n)) {
-                allocated++;
-                index = pp_next_clr(pool->base, ++index, colors);
+            if ((pool->size - first) < BITMAP_GRANULE_LEN) {
+                in_clr &= BITMAP_GRANULE_MASK(0, pool->size - first);
             }
 
-            index++;
+            /* Each allocated page of the target colors ends the current run */
+            bitmap_granule_t used = pool->bitmap[word] & in_clr;
+            while (true) {
+                bitmap_granule_t next_used = used & (~used + 1);
+                bitmap_granule_t free = (next_used == 0) ? in_clr : (in_clr & (next_used - 1));
+                if ((run == 0) && (free != 0)) {
+                    run_start = first + (size_t)__builtin_ctz(free);
+                }
+                run += (size_t)__builtin_popcount(free);
+                if ((run >= n) || (next_used == 0)) {
+                    break;
+                }
+                run = 0;
+                in_clr &= ~(next_used | (next_used - 1));
+                used &= ~next_used;
+            }
         }
 
-        if (allocated == n) {
+        if (run >= n) {
             /**
              * We've found n contigous free pages that fit the color pattern, Fill the output ppage
              * arg, mark the pages as allocated and update page pool internal state.
              */
+            size_t index = run_start;
             ppages->num_pages = n;
-            ppages->base = pool->base + (first_index * PAGE_SIZE);
+            ppages->base = pool->base + (run_start * PAGE_SIZE);
             for (size_t j = 0; j < n; j++) {
-                first_index = pp_next_clr(pool->base, first_index, colors);
-                bitmap_set(pool->bitmap, first_index++);
+                index = pp_next_clr(pool->base, index, colors, banks);
+                pp_take(pool, index++, 1);
             }
-            pool->free -= n;
-            pool->last = first_index;
+            pool->last = index;
             ok = true;
-            break;
         } else {
-            /**
-             * If this is the first iteration, setup index and top to search from base of the page
-             * pool until the previous iteration start point
-             */
-            index = 0;
+            start = 0;
         }
     }
 
@@ -191,7 +232,8 @@ static inline pte_t* mem_alloc_pt(struct addr_space* as, pte_t* parent, size_t l
 {
     /* Must have lock on as and va section to call */
     size_t ptsize = NUM_PAGES(pt_size(&as->pt, lvl + 1));
-    struct ppages ppage = mem_alloc_ppages(as->colors, ptsize, ptsize > 1 ? true : false);
+    struct ppages ppage =
+        mem_alloc_ppages_banks(as->colors, as->banks, ptsize, ptsize > 1 ? true : false);
     if (ppage.num_pages == 0) {
         return NULL;
     }
@@ -411,11 +453,87 @@ vaddr_t mem_alloc_vpage(struct addr_space* as, enum AS_SEC section, vaddr_t at,
     return vpage;
 }
 
+/* Physical page runs kept back from freeing until the batch is flushed */
+#define MEM_TLB_BATCH_FREES (8)
+
+/**
+ * TLB invalidations pending for an operation on an address space, kept as a single range issued at
+ * once by mem_tlb_batch_flush. Covering unmapped gaps in between is harmless, as the operation owns
+ * the whole range. Pages to be freed are only freed after the flush, so no cpu is left with a
+ * translation to a page that has already been reused.
+ */
+struct mem_tlb_batch {
+    struct addr_space* as;
+    vaddr_t base;
+    vaddr_t top;
+    size_t free_num;
+    struct {
+        paddr_t base;
+        size_t num_pages;
+    } frees[MEM_TLB_BATCH_FREES];
+};
+
+static inline void mem_tlb_batch_init(struct mem_tlb_batch* batch, struct addr_space* as)
+{
+    batch->as = as;
+    batch->base = 0;
+    batch->top = 0;
+    batch->free_num = 0;
+}
+
+static void mem_tlb_batch_flush(struct mem_tlb_batch* batch)
+{
+    if (batch->top > batch->base) {
+        tlb_inv_range(batch->as, batch->base, batch->top - batch->base);
+    }
+    batch->base = 0;
+    batch->top = 0;
+
+    for (size_t i = 0; i < batch->free_num; i++) {
+        struct ppages ppages = mem_ppages_get(batch->frees[i].base, batch->frees[i].num_pages);
+        mem_free_ppages(&ppages);
+    }
+    batch->free_num = 0;
+}
+
+static inline void mem_tlb_batch_add(struct mem_tlb_batch* batch, vaddr_t va, size_t size)
+{
+    if (batch->top == batch->base) {
+        batch->base = va;
+        batch->top = va + size;
+    } else {
+        batch->base = min(batch->base, va);
+        batch->top = max(batch->top, va + size);
+    }
+}
+
+static void mem_tlb_batch_free(struct mem_tlb_batch* batch, paddr_t base, size_t num_pages)
+{
+    if (batch->free_num > 0) {
+        size_t last = batch->free_num - 1;
+        if ((batch->frees[last].base + (batch->frees[last].num_pages * PAGE_SIZE)) == base) {
+            batch->frees[last].num_pages += num_pages;
+            return;
+        }
+    }
+
+    if (batch->free_num == MEM_TLB_BATCH_FREES) {
+        mem_tlb_batch_flush(batch);
+    }
+
+    batch->frees[batch->free_num].base = base;
+    batch->frees[batch->free_num].num_pages = num_pages;
+    batch->free_num++;
+}
+
 void mem_unmap(struct addr_space* as, vaddr_t at, size_t num_pages, bool free_ppages)
 {
     vaddr_t vaddr = at;
     vaddr_t top = at + (num_pages * PAGE_SIZE);
     size_t lvl = 0;
+    struct mem_tlb_batch batch;
+
+    mem_tlb_batch_init(&batch, as);
 
     spin_lock(&as->lock);
 
@@ -448,14 +566,13 @@ void mem_unmap(struct addr_space* as, vaddr_t at, size_t num_pages, bool free_pp
                         break;
                     }
 
-                    if (free_ppages) {
-                        paddr_t paddr = pte_addr(pte);
-                        struct ppages ppages = mem_ppages_get(paddr, lvlsz / PAGE_SIZE);
-                        mem_free_ppages(&ppages);
-                    }
+                    paddr_t paddr = pte_addr(pte);
 
                     *pte = 0;
-                    tlb_inv_va(&cpu()->as, vaddr);
+                    mem_tlb_batch_add(&batch, vaddr, lvlsz);
+                    if (free_ppages) {
+                        mem_tlb_batch_free(&batch, paddr, lvlsz / PAGE_SIZE);
+                    }
 
                 } else {
                     break;
@@ -475,6 +592,8 @@ void mem_unmap(struct addr_space* as, vaddr_t at, size_t num_pages, bool free_pp
         }
     }
 
+    mem_tlb_batch_flush(&batch);
+
     if (sec->shared) {
         spin_unlock(&sec->lock);
     }
@@ -505,20 +624,20 @@ static bool mem_map(struct addr_space* as, vaddr_t va, struct ppages* ppages, si
      */
 
     struct ppages temp_ppages;
-    if (ppages == NULL && !all_clrs(as->colors)) {
-        temp_ppages = mem_alloc_ppages(as->colors, num_pages, false);
+    if (ppages == NULL && !all_clrs_banks(as->colors, as->banks)) {
+        temp_ppages = mem_alloc_ppages_banks(as->colors, as->banks, num_pages, false);
         if (temp_ppages.num_pages < num_pages) {
             ERROR("failed to alloc colored physical pages");
         }
         ppages = &temp_ppages;
     }
 
-    if (ppages && !all_clrs(ppages->colors)) {
+    if (ppages && !all_clrs_banks(ppages->colors, ppages->banks)) {
         size_t index = 0;
         mem_inflate_pt(as, vaddr, num_pages * PAGE_SIZE);
         for (size_t i = 0; i < ppages->num_pages; i++) {
             pte = pt_get_pte(&as->pt, as->pt.dscr->lvls - 1, vaddr);
-            index = pp_next_clr(ppages->base, index, ppages->colors);
+            index = pp_next_clr(ppages->base, index, ppages->colors, ppages->banks);
             paddr_t paddr = ppages->base + (index * PAGE_SIZE);
             pte_set(pte, paddr, PTE_PAGE, flags);
             vaddr += PAGE_SIZE;
@@ -549,7 +668,8 @@ static bool mem_map(struct addr_space* as, vaddr_t va, struct ppages* ppages, si
             while ((entry < nentries) && (count < num_pages) &&
                 (num_pages - count >= lvlsz / PAGE_SIZE)) {
                 if (ppages == NULL) {
-                    struct ppages temp = mem_alloc_ppages(as->colors, lvlsz / PAGE_SIZE, true);
+                    struct ppages temp =
+                        mem_alloc_ppages_banks(as->colors, as->banks, lvlsz / PAGE_SIZE, true);
                     if (temp.num_pages < lvlsz / PAGE_SIZE) {
                         if (lvl == (as->pt.dscr->lvls - 1)) {
                             // TODO: free previously allocated pages
@@ -585,6 +705,78 @@ static bool mem_map(struct addr_space* as, vaddr_t va, struct ppages* ppages, si
     return true;
 }
 
+/**
+ * Recoloring plan, shared with the cpus helping with the copy. dst holds the destination of each
+ * original page, which is its own address if it is already within the colors. Each page moved
+ * takes the next slot in the recolored range, chunk_slot holding the first slot of each chunk.
+ */
+#ifndef MEM_RECLR_CHUNK_PAGES
+#define MEM_RECLR_CHUNK_PAGES (64)
+#endif
+
+#define MEM_RECLR_MOVE ((paddr_t)-1)
+
+struct mem_reclr_plan {
+    paddr_t base;
+    size_t num_pages;
+    size_t chunk_num;
+    vaddr_t phys_va;
+    vaddr_t reclrd_va;
+    paddr_t* dst;
+    size_t* chunk_slot;
+    volatile uint32_t next_chunk;
+    volatile uint32_t done_chunks;
+    volatile uint32_t workers;
+};
+
+static void mem_reclr_handler(uint32_t event, uint64_t data);
+CPU_MSG_HANDLER(mem_reclr_handler, MEM_RECLR_CPUMSG_ID)
+
+/* Copy chunks of the plan until none is left, cleaning each one's copies right after it */
+static void mem_reclr_work(struct mem_reclr_plan* plan)
+{
+    size_t chunk = 0;
+
+    while ((chunk = atomic_fetch_add(&plan->next_chunk, 1)) < plan->chunk_num) {
+        size_t first = chunk * MEM_RECLR_CHUNK_PAGES;
+        size_t last = min(first + MEM_RECLR_CHUNK_PAGES, plan->num_pages);
+        size_t first_slot = plan->chunk_slot[chunk];
+        size_t slot = first_slot;
+
+        for (size_t i = first; i < last; i++) {
+            if (plan->dst[i] != (plan->base + (i * PAGE_SIZE))) {
+                cache_copy_stream((void*)(plan->reclrd_va + (slot * PAGE_SIZE)),
+                    (void*)(plan->phys_va + (i * PAGE_SIZE)), PAGE_SIZE);
+                slot++;
+            }
+        }
+
+        if (slot > first_slot) {
+            cache_flush_range(plan->reclrd_va + (first_slot * PAGE_SIZE),
+                (slot - first_slot) * PAGE_SIZE);
+        }
+
+        atomic_fetch_add(&plan->done_chunks, 1);
+    }
+
+    fence_sync();
+}
+
+static void mem_reclr_handler(uint32_t event, uint64_t data)
+{
+    UNUSED_ARG(event);
+
+    struct mem_reclr_plan* plan = (struct mem_reclr_plan*)(uintptr_t)data;
+
+    mem_reclr_work(plan);
+    atomic_fetch_add(&plan->workers, (uint32_t)-1);
+}
+
+/**
+ * Map num_pages pages of ppages at va, moving those outside the address space's colors and banks
+ * to pages within them. The copy is shared with the current VM's other cpus, if any, which must
+ * be handling messages meanwhile, as they are while the VM master sets up the VM's memory.
+ */
 bool mem_map_reclr(struct addr_space* as, vaddr_t va, struct ppages* ppages, size_t num_pages,
     mem_flags_t flags)
 {
@@ -593,88 +785,214 @@ bool mem_map_reclr(struct addr_space* as, vaddr_t va, struct ppages* ppages, siz
     }
 
     /**
-     * Count how many pages are not colored in original images. Allocate the necessary colored
-     * pages. Mapped onto hypervisor address space.
+     * If the address space was not assigned any specific color or bank, defer to vanilla mapping.
      */
-    size_t reclrd_num = num_pages / (COLOR_NUM * COLOR_SIZE) * COLOR_SIZE *
-        bit_count(~(as->colors & BIT_MASK(0, COLOR_NUM)));
-    size_t clr_offset = (ppages->base / PAGE_SIZE) % (COLOR_NUM * COLOR_SIZE);
-    for (size_t i = 0; i < (num_pages % (COLOR_NUM * COLOR_SIZE)); i++) {
-        if (!bit_get(as->colors, (i + clr_offset) / COLOR_SIZE % COLOR_NUM)) {
+    if (all_clrs_banks(as->colors, as->banks)) {
+        return mem_map(as, va, ppages, num_pages, flags);
+    }
+
+    /**
+     * Plan where each page of the original image goes, counting how many are outside the address
+     * space's colors and banks.
+     */
+    size_t chunk_num = ALIGN(num_pages, MEM_RECLR_CHUNK_PAGES) / MEM_RECLR_CHUNK_PAGES;
+    size_t plan_size = sizeof(struct mem_reclr_plan) + (num_pages * sizeof(paddr_t)) +
+        (chunk_num * sizeof(size_t));
+    struct mem_reclr_plan* plan =
+        (struct mem_reclr_plan*)mem_alloc_page(NUM_PAGES(plan_size), SEC_HYP_GLOBAL, false);
+    if (plan == NULL) {
+        ERROR("failed to allocate recoloring plan");
+    }
+
+    plan->base = ppages->base;
+    plan->num_pages = num_pages;
+    plan->chunk_num = chunk_num;
+    plan->dst = (paddr_t*)&plan[1];
+    plan->chunk_slot = (size_t*)&plan->dst[num_pages];
+    plan->next_chunk = 0;
+    plan->done_chunks = 0;
+
+    size_t reclrd_num = 0;
+    for (size_t i = 0; i < num_pages; i++) {
+        paddr_t paddr = ppages->base + (i * PAGE_SIZE);
+        if ((i % MEM_RECLR_CHUNK_PAGES) == 0) {
+            plan->chunk_slot[i / MEM_RECLR_CHUNK_PAGES] = reclrd_num;
+        }
+        plan->dst[i] = paddr;
+        if (!mem_page_in_clrs_banks(paddr, as->colors, as->banks)) {
+            plan->dst[i] = MEM_RECLR_MOVE;
             reclrd_num++;
         }
     }
 
     /**
-     * If the address space was not assigned any specific color, or there are no pages to recolor
-     * defer to vanilla mapping.
+     * If there are no pages to recolor defer to vanilla mapping.
      */
-    if (all_clrs(as->colors) || (reclrd_num == 0)) {
+    if (reclrd_num == 0) {
+        mem_unmap(&cpu()->as, (vaddr_t)plan, NUM_PAGES(plan_size), true);
         return mem_map(as, va, ppages, num_pages, flags);
     }
 
-    vaddr_t reclrd_va_base = mem_alloc_vpage(&cpu()->as, SEC_HYP_VM, INVALID_VA, reclrd_num);
-    struct ppages reclrd_ppages = mem_alloc_ppages(as->colors, reclrd_num, false);
-    mem_map(&cpu()->as, reclrd_va_base, &reclrd_ppages, reclrd_num, PTE_HYP_FLAGS);
+    struct ppages reclrd_ppages = mem_alloc_ppages_banks(as->colors, as->banks, reclrd_num, false);
+    if (reclrd_ppages.num_pages < reclrd_num) {
+        ERROR("failed to alloc colored physical pages");
+    }
+
+    size_t index = 0;
+    for (size_t i = 0; i < num_pages; i++) {
+        if (plan->dst[i] == MEM_RECLR_MOVE) {
+            index = pp_next_clr(reclrd_ppages.base, index, as->colors, as->banks);
+            plan->dst[i] = reclrd_ppages.base + (index * PAGE_SIZE);
+            index++;
+        }
+    }
 
     /**
-     * Map original image onto hypervisor address space.
+     * Map the recolored pages and the original image onto the hypervisor address space, in the
+     * section shared by all cpus.
      */
-    vaddr_t phys_va_base = mem_alloc_vpage(&cpu()->as, SEC_HYP_VM, INVALID_VA, num_pages);
-    mem_map(&cpu()->as, phys_va_base, ppages, num_pages, PTE_HYP_FLAGS);
-
-    pte_t* pte = NULL;
-    vaddr_t vaddr = va & ~((vaddr_t)(PAGE_SIZE - 1));
-    paddr_t paddr = ppages->base;
-    vaddr_t clrd_vaddr = reclrd_va_base;
-    vaddr_t phys_va = phys_va_base;
-    size_t index = 0;
+    plan->reclrd_va = mem_alloc_map(&cpu()->as, SEC_HYP_GLOBAL, &reclrd_ppages, INVALID_VA,
+        reclrd_num, PTE_HYP_FLAGS);
+    plan->phys_va =
+        mem_alloc_map(&cpu()->as, SEC_HYP_GLOBAL, ppages, INVALID_VA, num_pages, PTE_HYP_FLAGS);
+
+    cpumap_t workers = 0;
+    if (cpu()->vcpu != NULL) {
+        workers = cpu()->vcpu->vm->cpus & ~(1UL << cpu()->id);
+    }
+    plan->workers = (uint32_t)bit_count(workers);
+    if (workers != 0) {
+        struct cpu_msg msg = { (uint32_t)MEM_RECLR_CPUMSG_ID, 0, (uintptr_t)plan };
+        cpu_send_msg_mask(workers, &msg);
+    }
 
     /**
-     * Inflate reserved page tables to the last level. This assumes coloring always needs the
-     * finest grained mapping possible.
+     * Meanwhile, set the final mappings, which no one uses yet. Inflate reserved page tables to
+     * the last level. This assumes coloring always needs the finest grained mapping possible.
      */
+    vaddr_t vaddr = va & ~((vaddr_t)(PAGE_SIZE - 1));
+    size_t lvl = as->pt.dscr->lvls - 1;
     mem_inflate_pt(as, vaddr, num_pages * PAGE_SIZE);
+    for (size_t chunk = 0; chunk < chunk_num; chunk++) {
+        size_t first = chunk * MEM_RECLR_CHUNK_PAGES;
+        size_t last = min(first + MEM_RECLR_CHUNK_PAGES, num_pages);
+        for (size_t i = first; i < last; i++) {
+            pte_t* pte = pt_get_pte(&as->pt, lvl, vaddr + (i * PAGE_SIZE));
+            pte_set(pte, plan->dst[i], PTE_PAGE, flags);
+        }
+        fence_sync_write();
+    }
+
+    mem_reclr_work(plan);
+    while ((atomic_load_acquire(&plan->done_chunks) < chunk_num) ||
+        (atomic_load_acquire(&plan->workers) != 0)) { }
 
+    /**
+     * Free the pages of the original image outside its colors and banks, a run at a time.
+     */
+    struct ppages unused_pages = mem_ppages_get(ppages->base, 0);
     for (size_t i = 0; i < num_pages; i++) {
-        pte = pt_get_pte(&as->pt, as->pt.dscr->lvls - 1, vaddr);
+        paddr_t paddr = ppages->base + (i * PAGE_SIZE);
+        if (plan->dst[i] == paddr) {
+            continue;
+        }
+        if ((unused_pages.base + (unused_pages.num_pages * PAGE_SIZE)) != paddr) {
+            if (unused_pages.num_pages > 0) {
+                mem_free_ppages(&unused_pages);
+            }
+            unused_pages = mem_ppages_get(paddr, 0);
+        }
+        unused_pages.num_pages++;
+    }
+    if (unused_pages.num_pages > 0) {
+        mem_free_ppages(&unused_pages);
+    }
 
-        /**
-         * If image page is already color, just map it. Otherwise first copy it to the previously
-         * allocated pages.
-         */
-        if (bit_get(as->colors, ((i + clr_offset) / COLOR_SIZE % COLOR_NUM))) {
-            pte_set(pte, paddr, PTE_PAGE, flags);
-        } else {
-            memcpy((void*)clrd_vaddr, (void*)phys_va, PAGE_SIZE);
-            index = pp_next_clr(reclrd_ppages.base, index, as->colors);
-            paddr_t clrd_paddr = reclrd_ppages.base + (index * PAGE_SIZE);
-            pte_set(pte, clrd_paddr, PTE_PAGE, flags);
+    mem_unmap(&cpu()->as, plan->reclrd_va, reclrd_num, false);
+    mem_unmap(&cpu()->as, plan->phys_va, num_pages, false);
+    mem_unmap(&cpu()->as, (vaddr_t)plan, NUM_PAGES(plan_size), true);
 
-            clrd_vaddr += PAGE_SIZE;
-            index++;
+    return true;
+}
+
+/**
+ * Move the pages mapped at [va, va + num_pages) in a VM address space that are outside colors
+ * (and the address space banks) to newly allocated pages within them, copying their contents and
+ * clearing the originals. The copies are remapped in place with a single TLB invalidation for the
+ * whole range, after which the original pages are freed. Superpages in the range are broken down
+ * first. Nothing may access the range meanwhile, i.e., the VM must be paused.
+ */
+bool mem_reclr_pages(struct addr_space* as, vaddr_t va, size_t num_pages, colormap_t colors,
+    size_t* reclrd_num)
+{
+    size_t lvl = as->pt.dscr->lvls - 1;
+    size_t num = 0;
+
+    *reclrd_num = 0;
+
+    spin_lock(&as->lock);
+
+    mem_inflate_pt(as, va, num_pages * PAGE_SIZE);
+
+    for (size_t i = 0; i < num_pages; i++) {
+        pte_t* pte = pt_get_pte(&as->pt, lvl, va + (i * PAGE_SIZE));
+        if (pte_valid(pte) && !mem_page_in_clrs_banks(pte_addr(pte), colors, as->banks)) {
+            num++;
         }
-        paddr += PAGE_SIZE;
-        phys_va += PAGE_SIZE;
-        vaddr += PAGE_SIZE;
     }
 
-    /**
-     * Flush the newly allocated colored pages to which parts of the image was copied, and might
-     * stayed in the cache system.
-     */
-    cache_flush_range(reclrd_va_base, reclrd_num * PAGE_SIZE);
+    if (num == 0) {
+        spin_unlock(&as->lock);
+        return true;
+    }
+
+    struct ppages reclrd_ppages = mem_alloc_ppages_banks(colors, as->banks, num, false);
+    if (reclrd_ppages.num_pages < num) {
+        spin_unlock(&as->lock);
+        return false;
+    }
 
     /**
-     * Free the uncolored pages of the original image.
+     * Map the new pages, and each original page as it is found, onto hypervisor address space.
      */
-    struct ppages unused_pages = { .base = ppages->base,
-        .num_pages = reclrd_num,
-        .colors = ~as->colors };
-    mem_free_ppages(&unused_pages);
+    vaddr_t reclrd_va_base =
+        mem_alloc_map(&cpu()->as, SEC_HYP_VM, &reclrd_ppages, INVALID_VA, num, PTE_HYP_FLAGS);
+    vaddr_t phys_va_base = mem_alloc_vpage(&cpu()->as, SEC_HYP_VM, INVALID_VA, num);
+    size_t index = 0;
+    size_t j = 0;
+
+    for (size_t i = 0; i < num_pages; i++) {
+        pte_t* pte = pt_get_pte(&as->pt, lvl, va + (i * PAGE_SIZE));
+        if (!pte_valid(pte) || mem_page_in_clrs_banks(pte_addr(pte), colors, as->banks)) {
+            continue;
+        }
+
+        struct ppages phys_ppage = mem_ppages_get(pte_addr(pte), 1);
+        vaddr_t phys_va = phys_va_base + (j * PAGE_SIZE);
+        vaddr_t clrd_va = reclrd_va_base + (j * PAGE_SIZE);
+        mem_map(&cpu()->as, phys_va, &phys_ppage, 1, PTE_HYP_FLAGS);
+        cache_copy_stream((void*)clrd_va, (void*)phys_va, PAGE_SIZE);
+        /* The original page goes back to the pool, which must not hand out the guest's data */
+        memset((void*)phys_va, 0, PAGE_SIZE);
+
+        index = pp_next_clr(reclrd_ppages.base, index, colors, as->banks);
+        pte_set(pte, reclrd_ppages.base + (index * PAGE_SIZE), PTE_PAGE, pte_flags(pte));
+        index++;
+        j++;
+    }
+
+    cache_flush_range(reclrd_va_base, num * PAGE_SIZE);
+    cache_flush_range(phys_va_base, num * PAGE_SIZE);
+    fence_sync();
+    tlb_inv_range(as, va, num_pages * PAGE_SIZE);
+
+    spin_unlock(&as->lock);
+
+    /* No stale translation to the original pages is left, so they can now be freed */
+    mem_unmap(&cpu()->as, phys_va_base, num, true);
+    mem_unmap(&cpu()->as, reclrd_va_base, num, false);
 
-    mem_unmap(&cpu()->as, reclrd_va_base, reclrd_num, false);
-    mem_unmap(&cpu()->as, phys_va_base, num_pages, false);
+    *reclrd_num = num;
 
     return true;
 }
@@ -741,7 +1059,7 @@ void mem_color_hypervisor(const paddr_t load_addr, struct mem_region* root_regio
     struct cpu* cpu_new;
     struct ppages p_cpu;
     struct ppages p_image;
-    struct ppages p_bitmap;
+    struct ppages p_meta;
 
     size_t image_load_size = (size_t)(&_image_load_end - &_image_start);
     size_t image_noload_size = (size_t)(&_image_end - &_image_load_end);
@@ -749,9 +1067,7 @@ void mem_color_hypervisor(const paddr_t load_addr, struct mem_region* root_regio
     size_t vm_image_size = (size_t)(&_vm_image_end - &_vm_image_start);
     size_t cpu_boot_size = mem_cpu_boot_alloc_size();
     struct page_pool* root_pool = &root_region->page_pool;
-    size_t bitmap_size =
-        (root_pool->size / (8 * PAGE_SIZE) + !!(root_pool->size % (8 * PAGE_SIZE) != 0)) *
-        PAGE_SIZE;
+    size_t meta_size = pp_meta_pages(root_pool->size) * PAGE_SIZE;
     colormap_t colors = config.hyp.colors;
 
     /* Set hypervisor colors in current address space */
@@ -791,9 +1107,9 @@ void mem_color_hypervisor(const paddr_t load_addr, struct mem_region* root_regio
     mem_map(&cpu_new->as, v_root_pt_addr, &p_root_pt_pages, root_pt_num_pages, PTE_HYP_FLAGS);
 
     /*
-     * Copy the Hypervisor image and root page pool bitmap into a colored region.
+     * Copy the Hypervisor image and root page pool metadata into a colored region.
      *
-     * CPU_MASTER allocates, copies and maps the image and the root page pool bitmap on a shared
+     * CPU_MASTER allocates, copies and maps the image and the root page pool metadata on a shared
      * space, whilst other CPUs only have to copy the image from the CPU_MASTER in order to be able
      * to access it.
      */
@@ -821,20 +1137,20 @@ void mem_color_hypervisor(const paddr_t load_addr, struct mem_region* root_regio
     /*
      * CPU_MASTER will also take care of mapping the configuration onto the new space.
      *
-     * The root page pool bitmap tracks all the physical allocation, so it needs to be the last
+     * The root page pool metadata tracks all the physical allocation, so it needs to be the last
      * thing to be copied, as after that, no physical allocation will be tracked.
      */
     if (cpu_is_master()) {
-        /* Copy root pool bitmap */
-        copy_space((void*)root_pool->bitmap, bitmap_size, &p_bitmap);
-        va = mem_alloc_vpage(&cpu_new->as, SEC_HYP_GLOBAL, (vaddr_t)root_pool->bitmap,
-            NUM_PAGES(bitmap_size));
+        /* Copy root pool metadata, which starts with its pages array */
+        copy_space((void*)root_pool->pages, meta_size, &p_meta);
+        va = mem_alloc_vpage(&cpu_new->as, SEC_HYP_GLOBAL, (vaddr_t)root_pool->pages,
+            NUM_PAGES(meta_size));
 
-        if (va != (vaddr_t)root_pool->bitmap) {
+        if (va != (vaddr_t)root_pool->pages) {
             ERROR("Can't allocate address for cpu interface");
         }
 
-        mem_map(&cpu_new->as, va, &p_bitmap, NUM_PAGES(bitmap_size), PTE_HYP_FLAGS);
+        mem_map(&cpu_new->as, va, &p_meta, NUM_PAGES(meta_size), PTE_HYP_FLAGS);
     }
     cpu_sync_barrier(&cpu_glb_sync);
 
@@ -868,7 +1184,7 @@ void mem_color_hypervisor(const paddr_t load_addr, struct mem_region* root_regio
      * Clear the old region that have been copied.
      *
      * CPU space regions and Hypervisor image region are contingent, starting from `load_addr`. The
-     * bitmap region is on top of the root pool region.
+     * metadata region is on top of the root pool region.
      */
     if (cpu_is_master()) {
         p_image = mem_ppages_get(load_addr, NUM_PAGES(image_load_size));
@@ -884,14 +1200,14 @@ void mem_color_hypervisor(const paddr_t load_addr, struct mem_region* root_regio
         memset((void*)va, 0, p_image.num_pages * PAGE_SIZE);
         mem_unmap(&cpu()->as, va, p_image.num_pages, true);
 
-        p_bitmap = mem_ppages_get(load_addr + image_size + vm_image_size +
+        p_meta = mem_ppages_get(load_addr + image_size + vm_image_size +
                 (cpu_boot_size * platform.cpu_num),
-            NUM_PAGES(bitmap_size));
+            NUM_PAGES(meta_size));
 
-        va = mem_alloc_vpage(&cpu()->as, SEC_HYP_GLOBAL, INVALID_VA, p_bitmap.num_pages);
-        mem_map(&cpu()->as, va, &p_bitmap, p_bitmap.num_pages, PTE_HYP_FLAGS);
-        memset((void*)va, 0, p_bitmap.num_pages * PAGE_SIZE);
-        mem_unmap(&cpu()->as, va, p_bitmap.num_pages, true);
+        va = mem_alloc_vpage(&cpu()->as, SEC_HYP_GLOBAL, INVALID_VA, p_meta.num_pages);
+        mem_map(&cpu()->as, va, &p_meta, p_meta.num_pages, PTE_HYP_FLAGS);
+        memset((void*)va, 0, p_meta.num_pages * PAGE_SIZE);
+        mem_unmap(&cpu()->as, va, p_meta.num_pages, true);
     }
 
     p_cpu = mem_ppages_get(load_addr + image_size + vm_image_size + (cpu_boot_size * cpu()->id),
@@ -907,6 +1223,7 @@ void as_init(struct addr_space* as, enum AS_TYPE type, asid_t id, pte_t* root_pt
     as->type = type;
     as->pt.dscr = type == AS_HYP || type == AS_HYP_CPY ? hyp_pt_dscr : vm_pt_dscr;
     as->colors = colors;
+    as->banks = 0;
     as->lock = SPINLOCK_INITVAL;
     as->id = id;
 
@@ -11,4 +11,5 @@
 void vm_mem_prot_init(struct vm* vm, const struct vm_config* vm_config)
 {
     as_init(&vm->as, AS_VM, vm->id, NULL, vm_config->colors);
+    vm->as.banks = vm_config->banks;
 }
@@ -9,7 +9,7 @@
 #include <bao.h>
 #include <bitmap.h>
 #include <arch/mem.h>
-#include <arch/spinlock.h>
+#include <spinlock.h>
 
 #define HYP_ASID         0
 #define VMPU_NUM_ENTRIES 64
@@ -25,6 +25,7 @@ struct addr_space {
     asid_t id;
     enum AS_TYPE type;
     colormap_t colors;
+    bankmap_t banks;
     struct mpe {
         enum { MPE_S_FREE, MPE_S_INVALID, MPE_S_VALID } state;
         struct mp_region region;
@@ -33,6 +34,7 @@ struct addr_space {
 };
 
 void as_init(struct addr_space* as, enum AS_TYPE type, asid_t id, colormap_t colors);
+void mem_prot_report(void);
 
 static inline bool mem_regions_overlap(struct mp_region* reg1, struct mp_region* reg2)
 {
@@ -10,6 +10,7 @@
 #include <fences.h>
 #include <platform_defs.h>
 #include <objpool.h>
+#include <atomic.h>
 #include <config.h>
 
 struct shared_region {
@@ -17,6 +18,7 @@ struct shared_region {
     asid_t asid;
     struct mp_region region;
     cpumap_t sharing_cpus;
+    volatile uint32_t refs;
 };
 
 void mem_handle_broadcast_region(uint32_t event, uint64_t data);
@@ -194,6 +196,7 @@ void as_init(struct addr_space* as, enum AS_TYPE type, asid_t id, colormap_t col
 
     as->type = type;
     as->colors = 0;
+    as->banks = 0;
     as->id = id;
     as_arch_init(as);
 
@@ -208,7 +211,7 @@ static void mem_free_ppages(struct ppages* ppages)
         spin_lock(&pool->lock);
         if (in_range(ppages->base, pool->base, pool->size * PAGE_SIZE)) {
             size_t index = (ppages->base - pool->base) / PAGE_SIZE;
-            bitmap_clear_consecutive(pool->bitmap, index, ppages->num_pages);
+            pp_free(pool, index, ppages->num_pages);
         }
         spin_unlock(&pool->lock);
     }
@@ -243,6 +246,16 @@ static cpumap_t mem_section_shared_cpus(struct addr_space* as, as_sec_t section)
     return cpus;
 }
 
+/* Shared region node usage so far, to size SHARED_REGION_POOL_SIZE */
+void mem_prot_report(void)
+{
+    struct objpool_stats stats;
+
+    objpool_get_stats(&shared_region_pool, &stats);
+    INFO("shared region pool: %d of %d nodes in use, high watermark %d, %d failed allocations",
+        stats.used, stats.num, stats.high_watermark, stats.failures);
+}
+
 static void mem_region_broadcast(struct addr_space* as, struct mp_region* mpr, uint32_t op)
 {
     cpumap_t shared_cpus = mem_section_shared_cpus(as, mpr->as_sec);
@@ -251,23 +264,25 @@ static void mem_region_broadcast(struct addr_space* as, struct mp_region* mpr, u
         return;
     }
 
-    struct shared_region shared_region = {
-        .as_type = as->type,
-        .asid = as->id,
-        .region = *mpr,
-    };
+    shared_cpus &= ~(1UL << cpu()->id);
+    if (shared_cpus == 0) {
+        return;
+    }
 
-    for (cpuid_t cpuid = 0; cpuid < PLAT_CPU_NUM; cpuid++) {
-        if ((cpu()->id != cpuid) && bit_get(shared_cpus, cpuid)) {
-            struct shared_region* node = objpool_alloc(&shared_region_pool);
-            if (node == NULL) {
-                ERROR("Failed allocating shared region node");
-            }
-            *node = shared_region;
-            struct cpu_msg msg = { (uint32_t)MEM_PROT_SYNC, op, (uintptr_t)node };
-            cpu_send_msg(cpuid, &msg);
-        }
+    /* A single node is shared by all targets and freed by the last one to handle it */
+    struct shared_region* node = objpool_alloc(&shared_region_pool);
+    if (node == NULL) {
+        mem_prot_report();
+        ERROR("Failed allocating shared region node");
     }
+    node->as_type = as->type;
+    node->asid = as->id;
+    node->region = *mpr;
+    node->sharing_cpus = shared_cpus;
+    node->refs = (uint32_t)bit_count(shared_cpus);
+
+    struct cpu_msg msg = { (uint32_t)MEM_PROT_SYNC, op, (uintptr_t)node };
+    cpu_send_msg_mask(shared_cpus, &msg);
 }
 
 static bool mem_vmpu_insert_region(struct addr_space* as, mpid_t mpid, struct mp_region* mpr,
@@ -351,7 +366,9 @@ void mem_handle_broadcast_region(uint32_t event, uint64_t data)
                 ERROR("unknown mem broadcast msg");
         }
 
-        objpool_free(&shared_region_pool, sh_reg);
+        if (atomic_fetch_add(&sh_reg->refs, (uint32_t)-1) == 1) {
+            objpool_free(&shared_region_pool, sh_reg);
+        }
     }
 }
 
@@ -3,6 +3,7 @@
 
 core-objs-y+=init.o
 core-objs-y+=mem.o
+core-objs-y+=page_pool.o
 core-objs-y+=cache.o
 core-objs-y+=interrupts.o
 core-objs-y+=cpu.o
@@ -12,6 +13,13 @@ core-objs-y+=config.o
 core-objs-y+=console.o
 core-objs-y+=ipc.o
 core-objs-y+=objpool.o
+core-objs-y+=spinlock.o
 core-objs-y+=hypercall.o
 core-objs-y+=shmem.o
 core-objs-y+=mem_throt.o
+core-objs-y+=events.o
+core-objs-y+=trace.o
+core-objs-y+=exit_stats.o
+core-objs-y+=irq_lat.o
+core-objs-y+=recolor.o
+core-objs-y+=timer.o
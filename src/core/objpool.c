@@ -4,39 +4,123 @@
  */
 
 #include <objpool.h>
+#include <cpu.h>
 #include <string.h>
 
 void objpool_init(struct objpool* objpool)
 {
     memset(objpool->pool, 0, objpool->objsize * objpool->num);
-    memset(objpool->bitmap, 0, BITMAP_SIZE(objpool->num));
+    memset(objpool->mags, 0, sizeof(struct objpool_magazine) * PLAT_CPU_NUM);
+    objpool->free_list = NULL;
+    objpool->fresh = 0;
+    objpool->used = 0;
+    objpool->high_watermark = 0;
+    objpool->failures = 0;
 }
 
-void* objpool_alloc(struct objpool* objpool)
+static inline struct objpool_magazine* objpool_mag(struct objpool* objpool)
+{
+    return (objpool->mag_size > 0) ? &objpool->mags[cpu()->id] : NULL;
+}
+
+static inline size_t objpool_batch(struct objpool* objpool)
+{
+    return max(objpool->mag_size / 2, (size_t)1);
+}
+
+/* Must be called with the pool lock held */
+static void* objpool_take(struct objpool* objpool)
 {
     void* obj = NULL;
-    spin_lock(&objpool->lock);
-    ssize_t n = bitmap_find_nth(objpool->bitmap, objpool->num, 1, 0, false);
-    if (n >= 0) {
-        bitmap_set(objpool->bitmap, (size_t)n);
-        obj = (void*)((uintptr_t)objpool->pool + (objpool->objsize * (size_t)n));
+
+    if (objpool->free_list != NULL) {
+        obj = objpool->free_list;
+        objpool->free_list = *(void**)obj;
+    } else if (objpool->fresh < objpool->num) {
+        obj = (void*)((uintptr_t)objpool->pool + (objpool->objsize * objpool->fresh++));
     }
-    spin_unlock(&objpool->lock);
+
+    if (obj != NULL) {
+        objpool->used++;
+        objpool->high_watermark = max(objpool->high_watermark, objpool->used);
+    } else {
+        objpool->failures++;
+    }
+
     return obj;
 }
 
+/* Must be called with the pool lock held */
+static void objpool_put(struct objpool* objpool, void* obj)
+{
+    *(void**)obj = objpool->free_list;
+    objpool->free_list = obj;
+    objpool->used--;
+}
+
+void* objpool_alloc(struct objpool* objpool)
+{
+    struct objpool_magazine* mag = objpool_mag(objpool);
+    void* obj = NULL;
+
+    if (mag == NULL) {
+        spin_lock(&objpool->lock);
+        obj = objpool_take(objpool);
+        spin_unlock(&objpool->lock);
+        return obj;
+    }
+
+    if (mag->num == 0) {
+        spin_lock(&objpool->lock);
+        for (size_t i = 0; i < objpool_batch(objpool); i++) {
+            if ((obj = objpool_take(objpool)) == NULL) {
+                break;
+            }
+            mag->objs[mag->num++] = obj;
+        }
+        spin_unlock(&objpool->lock);
+    }
+
+    return (mag->num > 0) ? mag->objs[--mag->num] : NULL;
+}
+
 void objpool_free(struct objpool* objpool, void* obj)
 {
     vaddr_t obj_addr = (vaddr_t)obj;
     vaddr_t pool_addr = (vaddr_t)objpool->pool;
     bool in_pool = in_range(obj_addr, pool_addr, objpool->objsize * objpool->num);
     bool aligned = IS_ALIGNED(obj_addr - pool_addr, objpool->objsize);
-    if (in_pool && aligned) {
-        size_t n = (obj_addr - pool_addr) / objpool->objsize;
+    struct objpool_magazine* mag = objpool_mag(objpool);
+
+    if (!in_pool || !aligned) {
+        WARNING("leaked while trying to free stray object");
+        return;
+    }
+
+    if (mag == NULL) {
         spin_lock(&objpool->lock);
-        bitmap_clear(objpool->bitmap, n);
+        objpool_put(objpool, obj);
+        spin_unlock(&objpool->lock);
+        return;
+    }
+
+    if (mag->num >= objpool->mag_size) {
+        spin_lock(&objpool->lock);
+        for (size_t i = 0; i < objpool_batch(objpool); i++) {
+            objpool_put(objpool, mag->objs[--mag->num]);
+        }
         spin_unlock(&objpool->lock);
-    } else {
-        WARNING("leaked while trying to free stray object");
     }
+
+    mag->objs[mag->num++] = obj;
+}
+
+void objpool_get_stats(struct objpool* objpool, struct objpool_stats* stats)
+{
+    spin_lock(&objpool->lock);
+    stats->num = objpool->num;
+    stats->used = objpool->used;
+    stats->high_watermark = objpool->high_watermark;
+    stats->failures = objpool->failures;
+    spin_unlock(&objpool->lock);
 }
@@ -0,0 +1,323 @@
+/**
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (c) Bao Project and Contributors. All rights reserved.
+ */
+
+#include <mem.h>
+
+#include <string.h>
+
+#define PP_FREE (0x80)
+#define PP_NIL  ((uint32_t)~0U)
+
+static inline size_t pp_pfn(struct page_pool* pool, size_t index)
+{
+    return (pool->base / PAGE_SIZE) + index;
+}
+
+static inline size_t pp_block_pages(size_t order)
+{
+    return ((size_t)1) << order;
+}
+
+/* Smallest order of a block holding num_pages */
+static inline size_t pp_order(size_t num_pages)
+{
+    size_t order = 0;
+    while ((order < PP_ORDER_NUM) && (pp_block_pages(order) < num_pages)) {
+        order++;
+    }
+    return order;
+}
+
+/* Largest order of a block starting at index and holding at most num_pages */
+static inline size_t pp_max_order(struct page_pool* pool, size_t index, size_t num_pages)
+{
+    size_t pfn = pp_pfn(pool, index);
+    size_t order = 0;
+    while (((order + 1) < PP_ORDER_NUM) && ((pfn & (pp_block_pages(order + 1) - 1)) == 0) &&
+        (pp_block_pages(order + 1) <= num_pages)) {
+        order++;
+    }
+    return order;
+}
+
+static void pp_list_push(struct page_pool* pool, size_t index, size_t order)
+{
+    uint32_t head = pool->free_list[order];
+
+    pool->pages[index].next = head;
+    pool->pages[index].prev = PP_NIL;
+    if (head != PP_NIL) {
+        pool->pages[head].prev = (uint32_t)index;
+    }
+    pool->free_list[order] = (uint32_t)index;
+    pool->orders[index] = (uint8_t)(order | PP_FREE);
+}
+
+static void pp_list_remove(struct page_pool* pool, size_t index)
+{
+    size_t order = pool->orders[index] & ~PP_FREE;
+    uint32_t next = pool->pages[index].next;
+    uint32_t prev = pool->pages[index].prev;
+
+    if (prev != PP_NIL) {
+        pool->pages[prev].next = next;
+    } else {
+        pool->free_list[order] = next;
+    }
+    if (next != PP_NIL) {
+        pool->pages[next].prev = prev;
+    }
+    pool->orders[index] = 0;
+}
+
+/* Free a block, merging it with its buddy for as long as the buddy is free */
+static void pp_block_put(struct page_pool* pool, size_t index, size_t order)
+{
+    size_t base_pfn = pp_pfn(pool, 0);
+
+    while ((order + 1) < PP_ORDER_NUM) {
+        size_t buddy_pfn = pp_pfn(pool, index) ^ pp_block_pages(order);
+        if (buddy_pfn < base_pfn) {
+            break;
+        }
+        size_t buddy = buddy_pfn - base_pfn;
+        if ((buddy >= pool->size) || (pool->orders[buddy] != (order | PP_FREE))) {
+            break;
+        }
+        pp_list_remove(pool, buddy);
+        index = min(index, buddy);
+        order++;
+    }
+
+    pp_list_push(pool, index, order);
+}
+
+static void pp_range_put(struct page_pool* pool, size_t index, size_t num_pages)
+{
+    while (num_pages > 0) {
+        size_t order = pp_max_order(pool, index, num_pages);
+        pp_block_put(pool, index, order);
+        index += pp_block_pages(order);
+        num_pages -= pp_block_pages(order);
+    }
+}
+
+/**
+ * Find the free block holding the page at index, if any. Blocks are aligned, so it is one of the
+ * at most PP_ORDER_NUM blocks starting at index rounded down to each order.
+ */
+static size_t pp_find_block(struct page_pool* pool, size_t index, size_t* order)
+{
+    size_t base_pfn = pp_pfn(pool, 0);
+    size_t pfn = pp_pfn(pool, index);
+
+    for (size_t i = 0; i < PP_ORDER_NUM; i++) {
+        size_t head_pfn = pfn & ~(pp_block_pages(i) - 1);
+        if (head_pfn < base_pfn) {
+            break;
+        }
+        size_t head = head_pfn - base_pfn;
+        if (pool->orders[head] == (i | PP_FREE)) {
+            *order = i;
+            return head;
+        }
+    }
+
+    return PP_NIL;
+}
+
+/* Check the free blocks agree with the allocation bitmap before updating it */
+static void pp_check(struct page_pool* pool, size_t index, size_t num_pages, bool allocated)
+{
+    if (!DEFINED(PP_CHECK)) {
+        return;
+    }
+
+    if ((bitmap_get(pool->bitmap, index) != (allocated ? 1U : 0U)) ||
+        (bitmap_count_consecutive(pool->bitmap, pool->size, index, num_pages) < num_pages)) {
+        ERROR("page pool 0x%lx: pages 0x%lx to 0x%lx not %s", pool->base, index,
+            index + num_pages - 1, allocated ? "allocated" : "free");
+    }
+}
+
+bool pp_page_is_free(struct page_pool* pool, size_t index)
+{
+    size_t order = 0;
+    return pp_find_block(pool, index, &order) != PP_NIL;
+}
+
+bool pp_range_is_free(struct page_pool* pool, size_t index, size_t num_pages)
+{
+    size_t end = index + num_pages;
+
+    if (end > pool->size) {
+        return false;
+    }
+
+    while (index < end) {
+        size_t order = 0;
+        size_t head = pp_find_block(pool, index, &order);
+        if (head == PP_NIL) {
+            return false;
+        }
+        index = head + pp_block_pages(order);
+    }
+
+    return true;
+}
+
+/**
+ * Mark a range of free pages as allocated. Each free block overlapping the range is removed, and
+ * its parts outside the range are given back.
+ */
+bool pp_take(struct page_pool* pool, size_t index, size_t num_pages)
+{
+    size_t end = index + num_pages;
+    size_t curr = index;
+
+    if (num_pages == 0) {
+        return true;
+    }
+
+    if (!pp_range_is_free(pool, index, num_pages)) {
+        return false;
+    }
+
+    pp_check(pool, index, num_pages, false);
+    bitmap_set_consecutive(pool->bitmap, index, num_pages);
+
+    while (curr < end) {
+        size_t order = 0;
+        size_t head = pp_find_block(pool, curr, &order);
+        size_t block_end = head + pp_block_pages(order);
+
+        pp_list_remove(pool, head);
+        pp_range_put(pool, head, curr - head);
+        if (block_end > end) {
+            pp_range_put(pool, end, block_end - end);
+        }
+        curr = block_end;
+    }
+
+    pool->free -= num_pages;
+
+    return true;
+}
+
+/* The pages must have been allocated. Freeing free pages breaks the pool. */
+void pp_free(struct page_pool* pool, size_t index, size_t num_pages)
+{
+    pp_check(pool, index, num_pages, true);
+    bitmap_clear_consecutive(pool->bitmap, index, num_pages);
+    pp_range_put(pool, index, num_pages);
+    pool->free += num_pages;
+}
+
+/**
+ * Buddy allocation fails for requests that only fit across blocks that can not be merged, or
+ * that need an alignment other than a power of two. Fall back to a first-fit walk over the pool,
+ * hopping over free blocks, to keep the allocation semantics of mem_alloc_ppages.
+ */
+static ssize_t pp_alloc_scan(struct page_pool* pool, size_t num_pages, bool aligned)
+{
+    size_t run = 0;
+    size_t curr = 0;
+
+    while (curr < pool->size) {
+        size_t order = 0;
+        size_t head = pp_find_block(pool, curr, &order);
+
+        if (head == PP_NIL) {
+            curr++;
+            run = curr;
+            continue;
+        }
+
+        curr = head + pp_block_pages(order);
+
+        size_t start = run;
+        if (aligned) {
+            size_t pfn = pp_pfn(pool, run);
+            start = run + ((num_pages - (pfn % num_pages)) % num_pages);
+        }
+        if ((start + num_pages) <= curr) {
+            return (ssize_t)start;
+        }
+    }
+
+    return -1;
+}
+
+bool pp_alloc(struct page_pool* pool, size_t num_pages, bool aligned, struct ppages* ppages)
+{
+    ppages->colors = 0;
+    ppages->num_pages = 0;
+
+    bool ok = false;
+    size_t order = pp_order(num_pages);
+    ssize_t index = -1;
+
+    if (num_pages == 0) {
+        return true;
+    }
+
+    spin_lock(&pool->lock);
+
+    /**
+     * Blocks are naturally aligned, so any block large enough also satisfies an alignment to a
+     * power of two size.
+     */
+    if (!aligned || ((num_pages & (num_pages - 1)) == 0)) {
+        for (size_t i = order; i < PP_ORDER_NUM; i++) {
+            if (pool->free_list[i] != PP_NIL) {
+                index = (ssize_t)pool->free_list[i];
+                break;
+            }
+        }
+    }
+
+    if ((index < 0) && (pool->free >= num_pages)) {
+        index = pp_alloc_scan(pool, num_pages, aligned);
+    }
+
+    if ((index >= 0) && pp_take(pool, (size_t)index, num_pages)) {
+        ppages->base = pool->base + (((size_t)index) * PAGE_SIZE);
+        ppages->num_pages = num_pages;
+        ok = true;
+    }
+
+    spin_unlock(&pool->lock);
+
+    return ok;
+}
+
+size_t pp_meta_pages(size_t num_pages)
+{
+    size_t size = (num_pages * sizeof(struct pp_page)) + ALIGN(num_pages, sizeof(bitmap_t)) +
+        (BITMAP_SIZE(num_pages) * sizeof(bitmap_t));
+    return NUM_PAGES(size);
+}
+
+/**
+ * Set up a pool with all of its pages free, its pages array, orders and bitmap laid out in this
+ * order in meta, which must be mapped and pp_meta_pages(pool->size) pages long. The pages holding
+ * meta itself must be taken by the caller if they belong to the pool.
+ */
+void pp_setup(struct page_pool* pool, void* meta)
+{
+    pool->pages = (struct pp_page*)meta;
+    pool->orders = (uint8_t*)&pool->pages[pool->size];
+    pool->bitmap = (bitmap_t*)&pool->orders[ALIGN(pool->size, sizeof(bitmap_t))];
+    memset((void*)pool->orders, 0, pool->size);
+    memset((void*)pool->bitmap, 0, BITMAP_SIZE(pool->size) * sizeof(bitmap_t));
+
+    for (size_t i = 0; i < PP_ORDER_NUM; i++) {
+        pool->free_list[i] = PP_NIL;
+    }
+
+    pp_range_put(pool, 0, pool->size);
+    pool->free = pool->size;
+    pool->last = 0;
+}
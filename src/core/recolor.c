@@ -0,0 +1,197 @@
+/**
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (c) Bao Project and Contributors. All rights reserved.
+ */
+
+#include <recolor.h>
+#include <cpu.h>
+#include <vm.h>
+#include <config.h>
+#include <atomic.h>
+#include <timer.h>
+#include <spinlock.h>
+#include <hypercall.h>
+#include <mem_throt.h>
+
+enum { RECOLOR_START, RECOLOR_PAUSE };
+
+/**
+ * Recoloring state of each VM. It is kept in global hypervisor data rather than in struct vm, as
+ * the management VM's cpus do not map other VMs' structures. Only the VM's master cpu advances
+ * the migration.
+ */
+struct recolor_vm {
+    spinlock_t lock;
+    volatile uint32_t state;
+    bool ready;
+    cpuid_t master;
+    colormap_t colors;
+    size_t region;
+    size_t offset;
+    size_t moved;
+    struct timer_event step;
+    volatile uint32_t pause;
+    volatile uint32_t paused;
+};
+
+static struct recolor_vm recolor_vms[CONFIG_VM_NUM];
+
+static void recolor_handler(uint32_t event, uint64_t data);
+CPU_MSG_HANDLER(recolor_handler, RECOLOR_CPUMSG_ID)
+
+/* Hold the VM's other vcpus in the hypervisor until recolor_resume */
+static void recolor_pause(struct vm* vm, struct recolor_vm* recolor)
+{
+    struct cpu_msg msg = { (uint32_t)RECOLOR_CPUMSG_ID, RECOLOR_PAUSE, vm->id };
+
+    atomic_store_release(&recolor->pause, 1);
+    vm_msg_broadcast(vm, &msg);
+    while (atomic_load_acquire(&recolor->paused) != (vm->cpu_num - 1)) { }
+}
+
+static void recolor_resume(struct recolor_vm* recolor)
+{
+    atomic_store_release(&recolor->pause, 0);
+    while (atomic_load_acquire(&recolor->paused) != 0) { }
+}
+
+static void recolor_wait_resume(struct recolor_vm* recolor)
+{
+    atomic_fetch_add(&recolor->paused, 1);
+    while (atomic_load_acquire(&recolor->pause) != 0) {
+        atomic_wait_while_eq(&recolor->pause, 1);
+    }
+    atomic_fetch_add(&recolor->paused, (uint32_t)-1);
+}
+
+static void recolor_done(struct vm* vm, struct recolor_vm* recolor, enum recolor_state state)
+{
+    if (state == RECOLOR_DONE) {
+        spin_lock(&vm->as.lock);
+        vm->as.colors = recolor->colors;
+        spin_unlock(&vm->as.lock);
+        INFO("vm %d: recolored, %d pages moved", vm->id, recolor->moved);
+    } else {
+        WARNING("vm %d: recoloring stopped after %d pages, no free memory in the new colors",
+            vm->id, recolor->moved);
+    }
+
+    atomic_store_release(&recolor->state, state);
+}
+
+static void recolor_step(struct timer_event* event)
+{
+    struct recolor_vm* recolor = (struct recolor_vm*)event->data;
+    struct vm* vm = cpu()->vcpu->vm;
+    const struct vm_platform* vm_platform = &vm->config->platform;
+
+    /* The copy must wait for the budget to be refilled, as the guest itself would */
+    if (cpu()->vcpu->mem_throt.throttled) {
+        timer_event_add_us(event, RECOLOR_STEP_US);
+        return;
+    }
+
+    while ((recolor->region < vm_platform->region_num) &&
+        vm_platform->regions[recolor->region].place_phys) {
+        recolor->region++;
+    }
+
+    if (recolor->region >= vm_platform->region_num) {
+        recolor_done(vm, recolor, RECOLOR_DONE);
+        return;
+    }
+
+    struct vm_mem_region* reg = &vm_platform->regions[recolor->region];
+    size_t reg_pages = NUM_PAGES(reg->size);
+    size_t num_pages = min((size_t)RECOLOR_CHUNK_PAGES, reg_pages - recolor->offset);
+    size_t reclrd_num = 0;
+
+    recolor_pause(vm, recolor);
+    bool ok = mem_reclr_pages(&vm->as, reg->base + (recolor->offset * PAGE_SIZE), num_pages,
+        recolor->colors, &reclrd_num);
+    recolor_resume(recolor);
+
+    if (!ok) {
+        recolor_done(vm, recolor, RECOLOR_FAILED);
+        return;
+    }
+
+    /* Each page moved was read and written once */
+    mem_throt_charge(2 * reclrd_num * PAGE_SIZE);
+    recolor->moved += reclrd_num;
+
+    recolor->offset += num_pages;
+    if (recolor->offset >= reg_pages) {
+        recolor->region++;
+        recolor->offset = 0;
+    }
+
+    timer_event_add_us(event, RECOLOR_STEP_US);
+}
+
+static void recolor_handler(uint32_t event, uint64_t data)
+{
+    struct recolor_vm* recolor = &recolor_vms[data];
+
+    switch (event) {
+        case RECOLOR_START:
+            timer_event_add(&recolor->step, timer_get_ticks());
+            break;
+        case RECOLOR_PAUSE:
+            recolor_wait_resume(recolor);
+            break;
+        default:
+            WARNING("Unknown recolor IPI event");
+            break;
+    }
+}
+
+/* Called by the VM's master cpu once the VM's address space is set up */
+void recolor_vm_init(struct vm* vm)
+{
+    struct recolor_vm* recolor = &recolor_vms[vm->id];
+
+    recolor->lock = SPINLOCK_INITVAL;
+    recolor->master = vm->master;
+    timer_event_init(&recolor->step, recolor_step, recolor);
+    fence_ord_write();
+    recolor->ready = true;
+}
+
+long int recolor_hypercall(unsigned long cmd, unsigned long vm_id, unsigned long colors)
+{
+    struct vm* vm = cpu()->vcpu->vm;
+    long int ret = -HC_E_FAILURE;
+
+    if (!DEFINED(MEM_PROT_MMU) || !config.recolor.enable || (vm->id != config.recolor.mgmt_vm)) {
+        return -HC_E_INVAL_ID;
+    }
+
+    if ((vm_id >= config.vmlist_size) || (vm_id == vm->id) || !recolor_vms[vm_id].ready) {
+        return -HC_E_INVAL_ARGS;
+    }
+
+    struct recolor_vm* recolor = &recolor_vms[vm_id];
+
+    if (cmd == RECOLOR_CMD_STATUS) {
+        return (long int)atomic_load_acquire(&recolor->state);
+    } else if (cmd != RECOLOR_CMD_START) {
+        return -HC_E_INVAL_ARGS;
+    }
+
+    spin_lock(&recolor->lock);
+    if (atomic_load_acquire(&recolor->state) != RECOLOR_RUNNING) {
+        recolor->colors = colors & BIT_MASK(0, COLOR_NUM);
+        recolor->region = 0;
+        recolor->offset = 0;
+        recolor->moved = 0;
+        atomic_store_release(&recolor->state, RECOLOR_RUNNING);
+
+        struct cpu_msg msg = { (uint32_t)RECOLOR_CPUMSG_ID, RECOLOR_START, vm_id };
+        cpu_send_msg(recolor->master, &msg);
+        ret = HC_E_SUCCESS;
+    }
+    spin_unlock(&recolor->lock);
+
+    return ret;
+}
@@ -0,0 +1,113 @@
+/**
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (c) Bao Project and Contributors. All rights reserved.
+ */
+
+#include <spinlock.h>
+
+#ifdef SPINLOCK_MCS
+
+#include <cpu.h>
+#include <atomic.h>
+#include <platform_defs.h>
+
+/**
+ * Nodes are shared with the other cpus in the queue, so they can not live in the cpu private
+ * area. Each node takes a cache line of its own, so a waiter spinning on its flag is not disturbed
+ * by the other cpus' queues.
+ */
+struct spinlock_mcs_node {
+    spinlock_t* lock;
+    volatile uint32_t next;
+    volatile uint32_t wait;
+} __attribute__((aligned(64)));
+
+static struct spinlock_mcs_node spinlock_mcs_nodes[PLAT_CPU_NUM][SPINLOCK_MCS_NODES];
+
+/* A queue entry is the index of the node plus one, so that zero means an empty queue */
+static inline uint32_t spinlock_mcs_encode(cpuid_t cpu_id, size_t idx)
+{
+    return (uint32_t)((cpu_id * SPINLOCK_MCS_NODES) + idx + 1);
+}
+
+static inline struct spinlock_mcs_node* spinlock_mcs_decode(uint32_t entry)
+{
+    return &spinlock_mcs_nodes[(entry - 1) / SPINLOCK_MCS_NODES][(entry - 1) % SPINLOCK_MCS_NODES];
+}
+
+/**
+ * The hypervisor runs with interrupts masked, so a cpu's nodes are never claimed concurrently.
+ * Locks may be released in any order, so nodes are looked up by lock rather than used as a stack.
+ */
+void spin_lock(spinlock_t* lock)
+{
+    cpuid_t cpu_id = cpu()->id;
+    size_t idx = 0;
+
+    while ((idx < SPINLOCK_MCS_NODES) && (spinlock_mcs_nodes[cpu_id][idx].lock != NULL)) {
+        idx++;
+    }
+
+    /**
+     * Reporting the error would itself take the console lock, for which there is no node left.
+     * Stop here, as ERROR would.
+     */
+    if (idx >= SPINLOCK_MCS_NODES) {
+        while (true) { }
+    }
+
+    struct spinlock_mcs_node* node = &spinlock_mcs_nodes[cpu_id][idx];
+    uint32_t entry = spinlock_mcs_encode(cpu_id, idx);
+    uint32_t prev = lock->tail;
+    uint32_t old;
+
+    node->lock = lock;
+    node->next = 0;
+    node->wait = 1;
+
+    /* Swap in the new tail. The exchange has release semantics, publishing the node's reset */
+    while ((old = atomic_cmpxchg(&lock->tail, prev, entry)) != prev) {
+        prev = old;
+    }
+
+    if (prev != 0) {
+        atomic_store_release(&spinlock_mcs_decode(prev)->next, entry);
+        while (atomic_load_acquire(&node->wait) != 0) {
+            atomic_wait_while_eq(&node->wait, 1);
+        }
+    }
+}
+
+void spin_unlock(spinlock_t* lock)
+{
+    cpuid_t cpu_id = cpu()->id;
+    size_t idx = 0;
+
+    while ((idx < SPINLOCK_MCS_NODES) && (spinlock_mcs_nodes[cpu_id][idx].lock != lock)) {
+        idx++;
+    }
+
+    if (idx >= SPINLOCK_MCS_NODES) {
+        ERROR("cpu %d releasing spinlock 0x%lx it does not hold", cpu_id, (unsigned long)lock);
+    }
+
+    struct spinlock_mcs_node* node = &spinlock_mcs_nodes[cpu_id][idx];
+    uint32_t entry = spinlock_mcs_encode(cpu_id, idx);
+    uint32_t next = atomic_load_acquire(&node->next);
+
+    if (next == 0) {
+        /* No known successor: free the lock, unless a cpu is just now linking itself in */
+        if (atomic_cmpxchg(&lock->tail, entry, 0) == entry) {
+            node->lock = NULL;
+            return;
+        }
+        while ((next = atomic_load_acquire(&node->next)) == 0) {
+            atomic_wait_while_eq(&node->next, 0);
+        }
+    }
+
+    atomic_store_release(&spinlock_mcs_decode(next)->wait, 0);
+    node->lock = NULL;
+}
+
+#endif
@@ -0,0 +1,181 @@
+/**
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (c) Bao Project and Contributors. All rights reserved
+ */
+
+#include <timer.h>
+#include <cpu.h>
+#include <interrupts.h>
+
+static inline bool timer_heap_before(struct timer_queue* queue, size_t i, size_t j)
+{
+    return queue->heap[i]->deadline < queue->heap[j]->deadline;
+}
+
+static inline void timer_heap_swap(struct timer_queue* queue, size_t i, size_t j)
+{
+    struct timer_event* tmp = queue->heap[i];
+    queue->heap[i] = queue->heap[j];
+    queue->heap[j] = tmp;
+    queue->heap[i]->index = i;
+    queue->heap[j]->index = j;
+}
+
+static void timer_heap_sift_up(struct timer_queue* queue, size_t i)
+{
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!timer_heap_before(queue, i, parent)) {
+            break;
+        }
+        timer_heap_swap(queue, i, parent);
+        i = parent;
+    }
+}
+
+static void timer_heap_sift_down(struct timer_queue* queue, size_t i)
+{
+    while (true) {
+        size_t left = (2 * i) + 1;
+        size_t right = left + 1;
+        size_t min = i;
+
+        if ((left < queue->size) && timer_heap_before(queue, left, min)) {
+            min = left;
+        }
+        if ((right < queue->size) && timer_heap_before(queue, right, min)) {
+            min = right;
+        }
+        if (min == i) {
+            break;
+        }
+        timer_heap_swap(queue, i, min);
+        i = min;
+    }
+}
+
+static void timer_heap_remove(struct timer_queue* queue, size_t i)
+{
+    size_t last = --queue->size;
+
+    queue->heap[i]->index = TIMER_EVENT_IDLE;
+    if (i != last) {
+        queue->heap[i] = queue->heap[last];
+        queue->heap[i]->index = i;
+        timer_heap_sift_down(queue, i);
+        timer_heap_sift_up(queue, i);
+    }
+    queue->heap[last] = NULL;
+}
+
+static void timer_queue_program(struct timer_queue* queue)
+{
+    if (queue->dispatching) {
+        /* The interrupt handler reprograms the timer once it is done dispatching */
+        return;
+    }
+
+    if (queue->size > 0) {
+        timer_arch_set_deadline(queue->heap[0]->deadline);
+    } else {
+        timer_arch_disarm();
+    }
+}
+
+void timer_event_init(struct timer_event* event, timer_handler_t handler, void* data)
+{
+    event->deadline = 0;
+    event->handler = handler;
+    event->data = data;
+    event->index = TIMER_EVENT_IDLE;
+}
+
+void timer_event_add(struct timer_event* event, uint64_t deadline)
+{
+    struct timer_queue* queue = &cpu()->timers;
+
+    if (timer_event_pending(event)) {
+        size_t i = event->index;
+        bool was_top = (i == 0);
+        event->deadline = deadline;
+        timer_heap_sift_down(queue, i);
+        timer_heap_sift_up(queue, event->index);
+        if (!was_top && (event->index != 0)) {
+            return;
+        }
+    } else {
+        if (queue->size >= TIMER_EVENTS_MAX) {
+            ERROR("cpu%d timer event queue full", cpu()->id);
+        }
+        event->deadline = deadline;
+        event->index = queue->size;
+        queue->heap[queue->size++] = event;
+        timer_heap_sift_up(queue, event->index);
+        if (event->index != 0) {
+            return;
+        }
+    }
+
+    timer_queue_program(queue);
+}
+
+void timer_event_cancel(struct timer_event* event)
+{
+    struct timer_queue* queue = &cpu()->timers;
+
+    if (!timer_event_pending(event)) {
+        return;
+    }
+
+    if ((event->index >= queue->size) || (queue->heap[event->index] != event)) {
+        ERROR("cpu%d cancelling timer event owned by other cpu", cpu()->id);
+    }
+
+    bool was_top = (event->index == 0);
+    timer_heap_remove(queue, event->index);
+    if (was_top) {
+        timer_queue_program(queue);
+    }
+}
+
+static void timer_irq_handler(irqid_t int_id)
+{
+    UNUSED_ARG(int_id);
+
+    struct timer_queue* queue = &cpu()->timers;
+
+    /**
+     * Handlers are free to re-arm or cancel events. While dispatching, those operations only
+     * update the heap so that the hardware is reprogrammed exactly once, after all expired events
+     * have been handled. Handlers must return (i.e., must not put the cpu in standby).
+     */
+    queue->dispatching = true;
+    while ((queue->size > 0) && (queue->heap[0]->deadline <= timer_get_ticks())) {
+        struct timer_event* event = queue->heap[0];
+        timer_heap_remove(queue, 0);
+        event->handler(event);
+    }
+    queue->dispatching = false;
+
+    timer_queue_program(queue);
+}
+
+void timer_init(void)
+{
+    struct timer_queue* queue = &cpu()->timers;
+
+    queue->size = 0;
+    queue->dispatching = false;
+
+    if (cpu_is_master()) {
+        if (!interrupts_reserve(timer_arch_irq_id(), timer_irq_handler)) {
+            ERROR("Failed to reserve hypervisor timer interrupt");
+        }
+    }
+
+    timer_arch_init();
+
+    cpu_sync_barrier(&cpu_glb_sync);
+
+    interrupts_cpu_enable(timer_arch_irq_id(), true);
+}
@@ -0,0 +1,106 @@
+/**
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (c) Bao Project and Contributors. All rights reserved.
+ */
+
+#include <trace.h>
+#include <config.h>
+#include <shmem.h>
+#include <string.h>
+
+/* Keep each ring on its own cache lines so cpus never write to a shared line */
+#define TRACE_RING_ALIGN (64)
+
+struct trace_ring* trace_rings[PLAT_CPU_NUM];
+
+static inline size_t trace_ring_stride(size_t ring_size)
+{
+    return ALIGN(sizeof(struct trace_ring) + (ring_size * sizeof(struct trace_record)),
+        TRACE_RING_ALIGN);
+}
+
+static inline size_t trace_rings_offset(void)
+{
+    return ALIGN(sizeof(struct trace_header), TRACE_RING_ALIGN);
+}
+
+/* Largest power of two ring size that fits the exported region */
+static size_t trace_ring_size_fit(size_t size)
+{
+    size_t ring_size = TRACE_RING_SIZE;
+
+    while ((ring_size > 0) &&
+        ((trace_rings_offset() + (platform.cpu_num * trace_ring_stride(ring_size))) > size)) {
+        ring_size >>= 1;
+    }
+
+    return ring_size;
+}
+
+static vaddr_t trace_alloc(size_t* ring_size)
+{
+    if (config.trace.export) {
+        struct shmem* shmem = shmem_get(config.trace.shmem_id);
+        if (shmem == NULL) {
+            WARNING("trace: invalid shmem id in configuration, trace not exported");
+        } else {
+            *ring_size = trace_ring_size_fit(shmem->size);
+            if (*ring_size == 0) {
+                ERROR("trace: shared memory region too small for the trace buffers");
+            }
+
+            struct ppages ppages = mem_ppages_get(shmem->phys, NUM_PAGES(shmem->size));
+            ppages.colors = shmem->colors;
+            return mem_alloc_map(&cpu()->as, SEC_HYP_GLOBAL, &ppages, INVALID_VA,
+                NUM_PAGES(shmem->size), PTE_HYP_FLAGS);
+        }
+    }
+
+    *ring_size = TRACE_RING_SIZE;
+    size_t size = trace_rings_offset() + (platform.cpu_num * trace_ring_stride(*ring_size));
+    return (vaddr_t)mem_alloc_page(NUM_PAGES(size), SEC_HYP_GLOBAL, false);
+}
+
+void trace_init(void)
+{
+    if (!DEFINED(TRACE_ENABLED) || !cpu_is_master()) {
+        return;
+    }
+
+    if ((TRACE_RING_SIZE & (TRACE_RING_SIZE - 1)) != 0) {
+        ERROR("trace: ring size must be a power of two");
+    }
+
+    size_t ring_size = 0;
+    vaddr_t base = trace_alloc(&ring_size);
+    if (base == (vaddr_t)NULL) {
+        ERROR("trace: failed to allocate trace buffers");
+    }
+
+    size_t stride = trace_ring_stride(ring_size);
+    size_t size = trace_rings_offset() + (platform.cpu_num * stride);
+    memset((void*)base, 0, size);
+
+    struct trace_header* header = (struct trace_header*)base;
+    header->version = TRACE_VERSION;
+    header->cpu_num = (uint32_t)platform.cpu_num;
+    header->ring_size = ring_size;
+    header->record_size = sizeof(struct trace_record);
+    header->timer_freq = timer_get_freq();
+    header->rings_offset = trace_rings_offset();
+    header->ring_stride = stride;
+
+    for (size_t i = 0; i < platform.cpu_num; i++) {
+        struct trace_ring* ring = (struct trace_ring*)(base + trace_rings_offset() + (i * stride));
+        ring->size = ring_size;
+    }
+
+    /* Publish the magic last so a reader never sees a half-initialized header */
+    fence_ord_write();
+    header->magic = TRACE_MAGIC;
+
+    for (size_t i = 0; i < platform.cpu_num; i++) {
+        trace_rings[i] = (struct trace_ring*)(base + trace_rings_offset() + (i * stride));
+    }
+    fence_sync_write();
+}
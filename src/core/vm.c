@@ -9,6 +9,37 @@
 #include <cache.h>
 #include <config.h>
 #include <shmem.h>
+#include <recolor.h>
+#include <atomic.h>
+#include <timer.h>
+#include <fences.h>
+
+/**
+ * Report how much memory is left to a VM assigned colors or banks, which is not evident from its
+ * configuration. An empty partition could never satisfy an allocation.
+ */
+static void vm_report_partition(struct vm* vm)
+{
+    colormap_t colors = vm->as.colors;
+    bankmap_t banks = vm->as.banks;
+
+    if (all_clrs_banks(colors, banks)) {
+        return;
+    }
+
+    size_t clr_num = all_clrs(colors) ? COLOR_NUM : bit_count(colors & BIT_MASK(0, COLOR_NUM));
+    size_t bank_num =
+        all_banks(banks) ? DRAM_BANK_NUM : bit_count(banks & BIT_MASK(0, DRAM_BANK_NUM));
+    size_t part_pages = mem_part_num_pages(colors, banks);
+    size_t total_pages = mem_part_num_pages(0, 0);
+
+    if (part_pages == 0) {
+        ERROR("vm %d: no memory in its colors and banks", vm->id);
+    }
+
+    INFO("vm %d: colors %d/%d, banks %d/%d, %d of %d MiB", vm->id, clr_num, COLOR_NUM, bank_num,
+        DRAM_BANK_NUM, (part_pages * PAGE_SIZE) >> 20, (total_pages * PAGE_SIZE) >> 20);
+}
 
 static void vm_master_init(struct vm* vm, const struct vm_config* vm_config, vmid_t vm_id)
 {
@@ -20,6 +51,7 @@ static void vm_master_init(struct vm* vm, const struct vm_config* vm_config, vmi
     cpu_sync_init(&vm->sync, vm->cpu_num);
 
     vm_mem_prot_init(vm, vm_config);
+    vm_report_partition(vm);
 }
 
 static void vm_cpu_init(struct vm* vm)
@@ -54,10 +86,82 @@ static void vm_vcpu_init(struct vm* vm, const struct vm_config* vm_config)
     vcpu_arch_reset(vcpu, vm_config->entry);
 }
 
+static inline bool vm_mem_region_lazy(struct vm_mem_region* reg)
+{
+    return DEFINED(MEM_PROT_MMU) && reg->lazy;
+}
+
+/**
+ * Map the VM_LAZY_CHUNK aligned chunk of a lazy region holding addr, clipped to the region. Fresh
+ * pages are zeroed through a temporary hypervisor mapping before the guest can reach them, as they
+ * may have been freed by another VM. Chunks are mapped under the vm lock, so if another cpu already
+ * mapped this one it is left as is. Returns false only if the pages can not be allocated.
+ */
+static bool vm_map_mem_chunk(struct vm* vm, struct vm_mem_region* reg, vaddr_t addr)
+{
+    vaddr_t chunk = ALIGN_FLOOR(addr, (vaddr_t)VM_LAZY_CHUNK);
+    vaddr_t base = max(chunk, (vaddr_t)reg->base);
+    vaddr_t end = min(chunk + VM_LAZY_CHUNK, (vaddr_t)(reg->base + reg->size));
+    size_t n = NUM_PAGES(end - base);
+    bool mapped = true;
+    paddr_t pa;
+
+    spin_lock(&vm->lock);
+
+    if (!mem_translate(&vm->as, base, &pa)) {
+        struct ppages ppages;
+        if (reg->place_phys) {
+            ppages = mem_ppages_get(reg->phys + (base - reg->base), n);
+            ppages.colors = reg->colors;
+        } else {
+            /* A clipped chunk is not a power of two, and aligning to its size takes a slow scan */
+            bool aligned = all_clrs_banks(vm->as.colors, vm->as.banks) && ((n & (n - 1)) == 0);
+            ppages = mem_alloc_ppages_banks(vm->as.colors, vm->as.banks, n, aligned);
+            mapped = ppages.num_pages == n;
+            if (mapped) {
+                vaddr_t va = mem_alloc_map(&cpu()->as, SEC_HYP_VM, &ppages, INVALID_VA, n,
+                    PTE_HYP_FLAGS);
+                mapped = va != INVALID_VA;
+                if (mapped) {
+                    memset((void*)va, 0, n * PAGE_SIZE);
+                    cache_flush_range(va, n * PAGE_SIZE);
+                    mem_unmap(&cpu()->as, va, n, false);
+                }
+            }
+        }
+
+        mapped = mapped &&
+            (mem_alloc_map(&vm->as, SEC_VM_ANY, &ppages, base, n, PTE_VM_FLAGS) == base);
+    }
+
+    spin_unlock(&vm->lock);
+
+    return mapped;
+}
+
+/* The image is installed at boot, so the chunks holding it can not wait for the guest */
+static void vm_map_lazy_img_rgn(struct vm* vm, const struct vm_config* vm_config,
+    struct vm_mem_region* reg)
+{
+    vaddr_t img_base = vm_config->image.base_addr;
+    vaddr_t img_end = img_base + vm_config->image.size;
+
+    for (vaddr_t addr = ALIGN_FLOOR(img_base, (vaddr_t)VM_LAZY_CHUNK); addr < img_end;
+         addr += VM_LAZY_CHUNK) {
+        if (!vm_map_mem_chunk(vm, reg, max(addr, (vaddr_t)reg->base))) {
+            ERROR("failed to allocate vm's region at 0x%lx", addr);
+        }
+    }
+}
+
 static void vm_map_mem_region(struct vm* vm, struct vm_mem_region* reg)
 {
     size_t n = NUM_PAGES(reg->size);
 
+    if (vm_mem_region_lazy(reg)) {
+        return;
+    }
+
     struct ppages pa_reg;
     struct ppages* pa_ptr = NULL;
     if (reg->place_phys) {
@@ -90,7 +194,7 @@ static void vm_map_img_rgn_inplace(struct vm* vm, const struct vm_config* vm_con
     struct ppages pa_img = mem_ppages_get(vm_config->image.load_addr, n_img);
 
     mem_alloc_map(&vm->as, SEC_VM_ANY, NULL, (vaddr_t)reg->base, n_before, PTE_VM_FLAGS);
-    if (all_clrs(vm->as.colors)) {
+    if (all_clrs_banks(vm->as.colors, vm->as.banks)) {
         /* map img in place */
         mem_alloc_map(&vm->as, SEC_VM_ANY, &pa_img, img_base, n_img, PTE_VM_FLAGS);
         /* we are mapping in place, config is already reserved */
@@ -103,19 +207,40 @@ static void vm_map_img_rgn_inplace(struct vm* vm, const struct vm_config* vm_con
         PTE_VM_FLAGS);
 }
 
+static void vm_install_image_lz4_init(struct vm* vm)
+{
+    struct lz4_frame* frame = &vm->install.frame;
+
+    if (!lz4_frame_parse((void*)vm->install.src, vm->install.src_size, frame)) {
+        ERROR("vm %d: image is not an LZ4 frame of independent blocks", vm->id);
+    }
+
+    if ((frame->content_size != 0) && (frame->content_size != vm->install.size)) {
+        ERROR("vm %d: image decompresses to 0x%lx bytes, not the configured 0x%lx", vm->id,
+            (size_t)frame->content_size, vm->install.size);
+    }
+
+    vm->install.lock = SPINLOCK_INITVAL;
+    vm->install.next_offset = frame->data_offset;
+    vm->install.done = 0;
+}
+
 static void vm_install_image(struct vm* vm, struct vm_mem_region* reg)
 {
+    size_t load_size = vm_config_image_load_size(vm->config);
+    bool raw = vm->config->image.format == VM_IMAGE_RAW;
+
     if (reg->place_phys) {
         paddr_t img_base = (paddr_t)vm->config->image.base_addr;
         paddr_t img_load_pa = vm->config->image.load_addr;
         size_t img_sz = vm->config->image.size;
 
-        if (img_base == img_load_pa) {
+        if ((img_base == img_load_pa) && raw) {
             // The image is already correctly installed. Our work is done.
             return;
         }
 
-        if (range_overlap_range(img_base, img_sz, img_load_pa, img_sz)) {
+        if (range_overlap_range(img_base, img_sz, img_load_pa, load_size)) {
             // We impose an image load region cannot overlap its runtime region. This both
             // simplifies the copying procedure as well as avoids limitations of mpu-based memory
             // management which does not allow overlapping mappings on the same address space.
@@ -124,25 +249,154 @@ static void vm_install_image(struct vm* vm, struct vm_mem_region* reg)
         }
     }
 
+    /**
+     * Only map the image here. It is copied by all the VM's cpus in vm_install_image_copy, so both
+     * mappings go in the section shared by all cpus.
+     */
     size_t img_num_pages = NUM_PAGES(vm->config->image.size);
-    struct ppages img_ppages = mem_ppages_get(vm->config->image.load_addr, img_num_pages);
-    vaddr_t src_va = mem_alloc_map(&cpu()->as, SEC_HYP_GLOBAL, &img_ppages, INVALID_VA,
-        img_num_pages, PTE_HYP_FLAGS);
-    vaddr_t dst_va =
+    size_t load_num_pages = NUM_PAGES(load_size);
+    struct ppages img_ppages = mem_ppages_get(vm->config->image.load_addr, load_num_pages);
+    vm->install.src = mem_alloc_map(&cpu()->as, SEC_HYP_GLOBAL, &img_ppages, INVALID_VA,
+        load_num_pages, PTE_HYP_FLAGS);
+    vm->install.src_size = load_size;
+    vm->install.dst =
         mem_map_cpy(&vm->as, &cpu()->as, vm->config->image.base_addr, INVALID_VA, img_num_pages);
-    memcpy((void*)dst_va, (void*)src_va, vm->config->image.size);
-    cache_flush_range((vaddr_t)dst_va, vm->config->image.size);
-    mem_unmap(&cpu()->as, src_va, img_num_pages, false);
-    mem_unmap(&cpu()->as, dst_va, img_num_pages, false);
+    vm->install.size = vm->config->image.size;
+    vm->install.next_chunk = 0;
+
+    if (!raw) {
+        vm_install_image_lz4_init(vm);
+    }
+}
+
+/**
+ * Each cpu takes the next chunk of a raw image until none is left, copying it without polluting
+ * the caches, and then cleans it. A chunk is only cleaned after the next one is copied, so the
+ * cache maintenance overlaps with the copy.
+ */
+static void vm_install_image_raw(struct vm* vm)
+{
+    size_t chunk_num = ALIGN(vm->install.size, VM_INSTALL_CHUNK) / VM_INSTALL_CHUNK;
+    vaddr_t prev_va = 0;
+    size_t prev_size = 0;
+    size_t chunk = 0;
+
+    while ((chunk = atomic_fetch_add(&vm->install.next_chunk, 1)) < chunk_num) {
+        size_t offset = chunk * VM_INSTALL_CHUNK;
+        size_t size = min((size_t)VM_INSTALL_CHUNK, vm->install.size - offset);
+        cache_copy_stream((void*)(vm->install.dst + offset), (void*)(vm->install.src + offset),
+            size);
+        if (prev_size != 0) {
+            cache_flush_range(prev_va, prev_size);
+        }
+        prev_va = vm->install.dst + offset;
+        prev_size = size;
+    }
+
+    if (prev_size != 0) {
+        cache_flush_range(prev_va, prev_size);
+    }
+}
+
+/**
+ * Each cpu claims the next block of an LZ4 image and decompresses it straight into the VM's
+ * memory, cleaning the output as it goes. Every block but the last decompresses to exactly
+ * frame.block_max bytes, so the n-th block's place is known without decompressing the others.
+ */
+static void vm_install_image_lz4(struct vm* vm)
+{
+    const struct lz4_frame* frame = &vm->install.frame;
+    const uint8_t* src = (const uint8_t*)vm->install.src;
+    struct lz4_block block;
+    size_t index = 0;
+
+    while (true) {
+        spin_lock(&vm->install.lock);
+        size_t header = vm->install.next_offset;
+        bool valid = lz4_frame_block(src, vm->install.src_size, frame, header, &block);
+        if (valid && (block.size != 0)) {
+            vm->install.next_offset = block.next_offset;
+            index = vm->install.next_chunk++;
+        }
+        spin_unlock(&vm->install.lock);
+
+        if (!valid) {
+            ERROR("vm %d: image truncated at offset 0x%lx", vm->id, header);
+        } else if (block.size == 0) {
+            break;
+        }
+
+        size_t offset = index * frame->block_max;
+        if (offset >= vm->install.size) {
+            ERROR("vm %d: image larger than the configured 0x%lx bytes", vm->id,
+                vm->install.size);
+        }
+
+        void* dst = (void*)(vm->install.dst + offset);
+        size_t dst_size = min(frame->block_max, vm->install.size - offset);
+        ssize_t len = -1;
+
+        if (!block.raw) {
+            len = lz4_decompress(dst, dst_size, &src[block.data_offset], block.size,
+                cache_flush_range);
+        } else if (block.size <= dst_size) {
+            cache_copy_stream(dst, &src[block.data_offset], block.size);
+            cache_flush_range((vaddr_t)dst, block.size);
+            len = (ssize_t)block.size;
+        }
+
+        if (len < 0) {
+            ERROR("vm %d: corrupted image block at offset 0x%lx", vm->id, block.data_offset);
+        }
+
+        spin_lock(&vm->install.lock);
+        vm->install.done += (size_t)len;
+        spin_unlock(&vm->install.lock);
+    }
+}
+
+/* Called by all the VM's cpus */
+static void vm_install_image_copy(struct vm* vm)
+{
+    if (vm->install.size == 0) {
+        return;
+    }
+
+    if (vm->config->image.format == VM_IMAGE_LZ4) {
+        vm_install_image_lz4(vm);
+    } else {
+        vm_install_image_raw(vm);
+    }
+    fence_sync();
+}
+
+static void vm_install_image_finish(struct vm* vm)
+{
+    if (vm->install.size != 0) {
+        if ((vm->config->image.format != VM_IMAGE_RAW) && (vm->install.done != vm->install.size)) {
+            ERROR("vm %d: image decompressed to 0x%lx bytes, not the configured 0x%lx", vm->id,
+                vm->install.done, vm->install.size);
+        }
+        mem_unmap(&cpu()->as, vm->install.src, NUM_PAGES(vm->install.src_size), false);
+        mem_unmap(&cpu()->as, vm->install.dst, NUM_PAGES(vm->install.size), false);
+        vm->install.size = 0;
+    }
 }
 
 static void vm_map_img_rgn(struct vm* vm, const struct vm_config* vm_config,
     struct vm_mem_region* reg)
 {
     if (!reg->place_phys && vm_config->image.inplace) {
+        if (vm_config->image.format != VM_IMAGE_RAW) {
+            ERROR("vm %d: compressed images can not be used in place", vm->id);
+        }
         vm_map_img_rgn_inplace(vm, vm_config, reg);
     } else {
-        vm_map_mem_region(vm, reg);
+        if (vm_mem_region_lazy(reg)) {
+            vm_map_lazy_img_rgn(vm, vm_config, reg);
+        } else {
+            vm_map_mem_region(vm, reg);
+        }
         vm_install_image(vm, reg);
     }
 }
@@ -266,10 +520,27 @@ struct vm* vm_init(struct vm_allocation* vm_alloc, const struct vm_config* vm_co
     /**
      * Create the VM's address space according to configuration and where its image was loaded.
      */
+    uint64_t mem_ticks = timer_get_ticks();
     if (master) {
         vm_init_mem_regions(vm, vm_config);
         vm_init_dev(vm, vm_config);
         vm_init_ipc(vm, vm_config);
+        recolor_vm_init(vm);
+    }
+
+    /* Install the image, if any, with all of the VM's cpus */
+    cpu_sync_and_clear_msgs(&vm->sync);
+    uint64_t img_ticks = timer_get_ticks();
+    vm_install_image_copy(vm);
+    cpu_sync_barrier(&vm->sync);
+
+    if (master) {
+        uint64_t end_ticks = timer_get_ticks();
+        INFO("vm %d: memory set up in %d us, image of %d KiB installed in %d us by %d cpus",
+            vm->id, timer_ticks_to_ns(img_ticks - mem_ticks) / 1000, vm->install.size / 1024,
+            timer_ticks_to_ns(end_ticks - img_ticks) / 1000, vm->cpu_num);
+        mem_prot_report();
+        vm_install_image_finish(vm);
     }
 
     mem_throt_config(vm_config->mem_throth.period_us, vm_config->mem_throth.vm_budget, vm_config->mem_throth.cpu_num_tickets);
@@ -283,6 +554,55 @@ struct vm* vm_init(struct vm_allocation* vm_alloc, const struct vm_config* vm_co
     return vm;
 }
 
+enum VM_EVENTS { VM_STOP };
+static void vm_msg_handler(uint32_t event, uint64_t data);
+CPU_MSG_HANDLER(vm_msg_handler, VM_CPUMSG_ID)
+
+static void vm_msg_handler(uint32_t event, uint64_t data)
+{
+    UNUSED_ARG(data);
+
+    if ((event == VM_STOP) && cpu()->vcpu->vm->stopped) {
+        cpu_idle();
+    }
+}
+
+/**
+ * Stop a VM that can not go on, without taking down the hypervisor and the other VMs. Its cpus stay
+ * parked in the hypervisor for good, as vcpu_run never resumes the guest of a stopped VM.
+ */
+static void vm_stop(struct vm* vm)
+{
+    struct cpu_msg msg = { (uint32_t)VM_CPUMSG_ID, VM_STOP, vm->id };
+
+    vm->stopped = true;
+    vm_msg_broadcast(vm, &msg);
+    cpu_idle();
+}
+
+/**
+ * Handle a stage 2 translation fault at addr, mapping the chunk around it if it belongs to a lazy
+ * region. Returns false if it does not, so the fault is to be handled as before. If another vcpu
+ * already mapped the same chunk, the guest simply retries the access. If there is no memory left
+ * for the chunk, only this VM is stopped.
+ */
+bool vm_mem_fault(struct vm* vm, vaddr_t addr)
+{
+    for (size_t i = 0; i < vm->config->platform.region_num; i++) {
+        struct vm_mem_region* reg = &vm->config->platform.regions[i];
+        if (vm_mem_region_lazy(reg) && (addr >= reg->base) && (addr < (reg->base + reg->size))) {
+            if (!vm_map_mem_chunk(vm, reg, addr)) {
+                WARNING("vm %d: out of memory for lazily mapped region at 0x%lx, stopping it",
+                    vm->id, addr);
+                vm_stop(vm);
+            }
+            return true;
+        }
+    }
+
+    return false;
+}
+
 void vm_emul_add_mem(struct vm* vm, struct emul_mem* emu)
 {
     list_push(&vm->emul_mem_list, &emu->node);
@@ -293,17 +613,22 @@ void vm_emul_add_reg(struct vm* vm, struct emul_reg* emu)
     list_push(&vm->emul_reg_list, &emu->node);
 }
 
-emul_handler_t vm_emul_get_mem(struct vm* vm, vaddr_t addr)
+struct emul_mem* vm_emul_get_mem_region(struct vm* vm, vaddr_t addr)
 {
-    emul_handler_t handler = NULL;
     list_foreach (vm->emul_mem_list, struct emul_mem, emu) {
         if (addr >= emu->va_base && (addr < (emu->va_base + emu->size))) {
-            handler = emu->handler;
-            break;
+            return emu;
         }
     }
 
-    return handler;
+    return NULL;
+}
+
+emul_handler_t vm_emul_get_mem(struct vm* vm, vaddr_t addr)
+{
+    struct emul_mem* emu = vm_emul_get_mem_region(vm, addr);
+
+    return (emu != NULL) ? emu->handler : NULL;
 }
 
 emul_handler_t vm_emul_get_reg(struct vm* vm, vaddr_t addr)
@@ -321,12 +646,7 @@ emul_handler_t vm_emul_get_reg(struct vm* vm, vaddr_t addr)
 
 void vm_msg_broadcast(struct vm* vm, struct cpu_msg* msg)
 {
-    for (size_t i = 0, n = 0; n < vm->cpu_num - 1; i++) {
-        if (((1U << i) & vm->cpus) && (i != cpu()->id)) {
-            n++;
-            cpu_send_msg(i, msg);
-        }
-    }
+    cpu_send_msg_mask(vm->cpus & ~(1UL << cpu()->id), msg);
 }
 
 __attribute__((weak)) cpumap_t vm_translate_to_pcpu_mask(struct vm* vm, cpumap_t mask, size_t len)
@@ -355,6 +675,11 @@ __attribute__((weak)) cpumap_t vm_translate_to_vcpu_mask(struct vm* vm, cpumap_t
 
 void vcpu_run(struct vcpu* vcpu)
 {
+    if (vcpu->vm->stopped) {
+        cpu_idle();
+    }
+
     cpu()->vcpu->active = true;
+    exit_stats_end();
     vcpu_arch_run(vcpu);
 }
@@ -11,6 +11,7 @@
 #include <fences.h>
 #include <string.h>
 #include <shmem.h>
+#include <trace.h>
 
 static struct vm_assignment {
     spinlock_t lock;
@@ -128,6 +129,7 @@ void vmm_init()
     vmm_arch_init();
     vmm_io_init();
     shmem_init();
+    trace_init();
 
     cpu_sync_barrier(&cpu_glb_sync);
 
@@ -109,3 +109,29 @@ void bitmap_set_consecutive(bitmap_t* map, size_t start, size_t n)
         map[pos / BITMAP_GRANULE_LEN] |= BITMAP_GRANULE_MASK(0, count);
     }
 }
+
+void bitmap_clear_consecutive(bitmap_t* map, size_t start, size_t n)
+{
+    size_t pos = start;
+    size_t count = n;
+    size_t start_offset = start % BITMAP_GRANULE_LEN;
+    size_t first_word_bits = min(BITMAP_GRANULE_LEN - start_offset, count);
+
+    if (n == 0) {
+        return;
+    }
+
+    map[pos / BITMAP_GRANULE_LEN] &= ~BITMAP_GRANULE_MASK(start_offset, first_word_bits);
+    pos += first_word_bits;
+    count -= first_word_bits;
+
+    while (count >= BITMAP_GRANULE_LEN) {
+        map[pos / BITMAP_GRANULE_LEN] = 0;
+        pos += BITMAP_GRANULE_LEN;
+        count -= BITMAP_GRANULE_LEN;
+    }
+
+    if (count > 0) {
+        map[pos / BITMAP_GRANULE_LEN] &= ~BITMAP_GRANULE_MASK(0, count);
+    }
+}
@@ -42,12 +42,7 @@ static inline unsigned bitmap_get(bitmap_t* map, size_t bit)
 
 void bitmap_set_consecutive(bitmap_t* map, size_t start, size_t n);
 
-static inline void bitmap_clear_consecutive(bitmap_t* map, size_t start, size_t n)
-{
-    for (size_t i = 0; i < n; i++) {
-        bitmap_clear(map, start + i);
-    }
-}
+void bitmap_clear_consecutive(bitmap_t* map, size_t start, size_t n);
 
 static inline size_t bitmap_count(bitmap_t* map, size_t start, size_t n, bool set)
 {
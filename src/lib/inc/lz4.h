@@ -0,0 +1,64 @@
+/**
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (c) Bao Project and Contributors. All rights reserved.
+ */
+
+#ifndef __LZ4_H__
+#define __LZ4_H__
+
+#include <bao.h>
+
+/**
+ * LZ4 frame decoding, as produced by the lz4 command line tool. Only frames whose blocks are
+ * independent (the tool's default) are supported, so each block can be decompressed on its own,
+ * in any order. Checksums are skipped rather than verified.
+ */
+
+#define LZ4_FRAME_MAGIC  (0x184D2204U)
+
+/* Matches reach back at most this far into the block's output */
+#define LZ4_WINDOW_SIZE  (0x10000)
+
+struct lz4_frame {
+    /* Offset of the first block header */
+    size_t data_offset;
+    /* Decompressed size of every block but the last */
+    size_t block_max;
+    bool block_checksum;
+    /* Decompressed size of the whole frame, or zero if the frame does not tell */
+    uint64_t content_size;
+};
+
+struct lz4_block {
+    /* Offset of the block's data and its size, as stored */
+    size_t data_offset;
+    size_t size;
+    /* Stored uncompressed */
+    bool raw;
+    /* Offset of the next block header */
+    size_t next_offset;
+};
+
+/**
+ * Called by lz4_decompress with ranges of output no later match can read, so they can be written
+ * back while the rest of the block is decompressed.
+ */
+typedef void (*lz4_flush_t)(vaddr_t base, size_t size);
+
+bool lz4_frame_parse(const void* src, size_t src_size, struct lz4_frame* frame);
+
+/**
+ * Read the block header at offset. Returns false if the block does not fit in the frame. The end
+ * of the frame reads as a block of size zero.
+ */
+bool lz4_frame_block(const void* src, size_t src_size, const struct lz4_frame* frame,
+    size_t offset, struct lz4_block* block);
+
+/**
+ * Decompress an independent block. Returns the number of bytes written, or -1 if the block is
+ * malformed or does not fit in dst_size bytes. flush may be NULL.
+ */
+ssize_t lz4_decompress(void* dst, size_t dst_size, const void* src, size_t src_size,
+    lz4_flush_t flush);
+
+#endif /* __LZ4_H__ */
@@ -0,0 +1,187 @@
+/**
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (c) Bao Project and Contributors. All rights reserved.
+ */
+
+#include <lz4.h>
+
+#include <string.h>
+
+#define LZ4_FLG_VERSION_OFF    (6)
+#define LZ4_FLG_VERSION        (1)
+#define LZ4_FLG_BLOCK_INDEP    (1U << 5)
+#define LZ4_FLG_BLOCK_CHECKSUM (1U << 4)
+#define LZ4_FLG_CONTENT_SIZE   (1U << 3)
+#define LZ4_FLG_DICT_ID        (1U << 0)
+#define LZ4_BD_BLOCK_MAX_OFF   (4)
+#define LZ4_BD_BLOCK_MAX_MSK   (0x7)
+#define LZ4_BLOCK_RAW          (1U << 31)
+#define LZ4_CHECKSUM_SIZE      (4)
+#define LZ4_MIN_MATCH          (4)
+#define LZ4_RUN_MSK            (0xf)
+
+/* Frame fields are little endian and unaligned */
+static inline uint32_t lz4_read32(const uint8_t* ptr)
+{
+    return (uint32_t)ptr[0] | ((uint32_t)ptr[1] << 8) | ((uint32_t)ptr[2] << 16) |
+        ((uint32_t)ptr[3] << 24);
+}
+
+bool lz4_frame_parse(const void* src, size_t src_size, struct lz4_frame* frame)
+{
+    const uint8_t* in = src;
+    size_t offset = 6;
+
+    /* Magic, FLG, BD and the header checksum */
+    if ((src_size < (offset + 1)) || (lz4_read32(in) != LZ4_FRAME_MAGIC)) {
+        return false;
+    }
+
+    uint8_t flg = in[4];
+    uint8_t bd = in[5];
+    size_t block_max_code = (bd >> LZ4_BD_BLOCK_MAX_OFF) & LZ4_BD_BLOCK_MAX_MSK;
+
+    if (((flg >> LZ4_FLG_VERSION_OFF) != LZ4_FLG_VERSION) || !(flg & LZ4_FLG_BLOCK_INDEP) ||
+        (flg & LZ4_FLG_DICT_ID) || (block_max_code < 4)) {
+        return false;
+    }
+
+    /* Codes 4 to 7 stand for 64 KiB, 256 KiB, 1 MiB and 4 MiB */
+    frame->block_max = ((size_t)1) << (8 + (2 * block_max_code));
+    frame->block_checksum = (flg & LZ4_FLG_BLOCK_CHECKSUM) != 0;
+    frame->content_size = 0;
+
+    if (flg & LZ4_FLG_CONTENT_SIZE) {
+        if (src_size < (offset + 8 + 1)) {
+            return false;
+        }
+        frame->content_size =
+            (uint64_t)lz4_read32(&in[offset]) | ((uint64_t)lz4_read32(&in[offset + 4]) << 32);
+        offset += 8;
+    }
+
+    frame->data_offset = offset + 1;
+
+    return true;
+}
+
+bool lz4_frame_block(const void* src, size_t src_size, const struct lz4_frame* frame,
+    size_t offset, struct lz4_block* block)
+{
+    const uint8_t* in = src;
+
+    if ((offset > src_size) || ((src_size - offset) < sizeof(uint32_t))) {
+        return false;
+    }
+
+    uint32_t header = lz4_read32(&in[offset]);
+    size_t tail = frame->block_checksum ? LZ4_CHECKSUM_SIZE : 0;
+
+    block->raw = (header & LZ4_BLOCK_RAW) != 0;
+    block->size = header & ~LZ4_BLOCK_RAW;
+    block->data_offset = offset + sizeof(uint32_t);
+    block->next_offset = block->data_offset;
+
+    /* The end mark */
+    if (block->size == 0) {
+        return !block->raw;
+    }
+
+    if ((block->size > frame->block_max) ||
+        ((src_size - block->data_offset) < (block->size + tail))) {
+        return false;
+    }
+
+    block->next_offset += block->size + tail;
+
+    return true;
+}
+
+/* Run lengths of 15 continue in the following bytes, for as long as these are 255 */
+static inline bool lz4_run_length(const uint8_t** ip, const uint8_t* iend, size_t* len)
+{
+    if (*len != LZ4_RUN_MSK) {
+        return true;
+    }
+
+    uint8_t byte = 0;
+    do {
+        if (*ip >= iend) {
+            return false;
+        }
+        byte = *(*ip)++;
+        *len += byte;
+    } while (byte == 0xff);
+
+    return true;
+}
+
+/**
+ * A block is a sequence of literal runs, each but the last followed by a match: a copy of earlier
+ * output at a 16-bit distance back. The output is handed to flush in LZ4_WINDOW_SIZE pieces once
+ * it is out of every later match's reach.
+ */
+ssize_t lz4_decompress(void* dst, size_t dst_size, const void* src, size_t src_size,
+    lz4_flush_t flush)
+{
+    const uint8_t* ip = src;
+    const uint8_t* iend = ip + src_size;
+    uint8_t* op = dst;
+    uint8_t* oend = op + dst_size;
+    uint8_t* flushed = dst;
+
+    while (ip < iend) {
+        uint8_t token = *ip++;
+
+        size_t lit_len = token >> 4;
+        if (!lz4_run_length(&ip, iend, &lit_len) || (lit_len > (size_t)(iend - ip)) ||
+            (lit_len > (size_t)(oend - op))) {
+            return -1;
+        }
+        memcpy(op, ip, lit_len);
+        ip += lit_len;
+        op += lit_len;
+
+        if (ip == iend) {
+            break;
+        }
+
+        if ((iend - ip) < 2) {
+            return -1;
+        }
+        size_t dist = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+
+        size_t match_len = token & LZ4_RUN_MSK;
+        if ((dist == 0) || (dist > (size_t)(op - (uint8_t*)dst)) ||
+            !lz4_run_length(&ip, iend, &match_len)) {
+            return -1;
+        }
+        match_len += LZ4_MIN_MATCH;
+        if (match_len > (size_t)(oend - op)) {
+            return -1;
+        }
+
+        const uint8_t* match = op - dist;
+        if (dist >= match_len) {
+            memcpy(op, match, match_len);
+            op += match_len;
+        } else {
+            /* Overlapping matches repeat the last dist bytes */
+            for (size_t i = 0; i < match_len; i++) {
+                *op++ = *match++;
+            }
+        }
+
+        while ((flush != NULL) && ((size_t)(op - flushed) >= (2 * LZ4_WINDOW_SIZE))) {
+            flush((vaddr_t)flushed, LZ4_WINDOW_SIZE);
+            flushed += LZ4_WINDOW_SIZE;
+        }
+    }
+
+    if ((flush != NULL) && (op != flushed)) {
+        flush((vaddr_t)flushed, (size_t)(op - flushed));
+    }
+
+    return (ssize_t)(op - (uint8_t*)dst);
+}
@@ -4,3 +4,4 @@
 lib-objs-y+=string.o
 lib-objs-y+=printk.o
 lib-objs-y+=bitmap.o
+lib-objs-y+=lz4.o
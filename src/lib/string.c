@@ -5,7 +5,12 @@
 
 #include <string.h>
 
-void* memcpy(void* dst, const void* src, size_t count)
+/**
+ * Generic memcpy and memset. Architectures may provide optimized versions that take their place
+ * (see src/arch/armv8/aarch64/string.S and src/arch/riscv/string.S).
+ */
+
+__attribute__((weak)) void* memcpy(void* dst, const void* src, size_t count)
 {
     size_t i;
     uint8_t* dst_tmp = dst;
@@ -36,7 +41,7 @@ void* memcpy(void* dst, const void* src, size_t count)
     return dst;
 }
 
-void* memset(void* dest, int c, size_t count)
+__attribute__((weak)) void* memset(void* dest, int c, size_t count)
 {
     uint8_t* d;
     d = (uint8_t*)dest;
@@ -29,6 +29,15 @@ struct platform platform = {
             .gicr_addr = 0x080A0000,
             .maintenance_id = 25,
         },
+
+        .generic_timer = {
+            .timer_id = 26,
+        },
+
+        .events = {
+            /* The PMU overflow PPI */
+            .events_irq_offset = 23,
+        },
     },
 
 };
@@ -33,6 +33,7 @@ struct platform platform = {
 #else
 #error "unknown IPIC type " IPIC
 #endif
+        .timer.freq = 10000000,
     },
 
 };
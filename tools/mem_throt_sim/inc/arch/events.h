@@ -0,0 +1,38 @@
+/**
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (c) Bao Project and Contributors. All rights reserved.
+ */
+
+#ifndef __ARCH_EVENTS_H__
+#define __ARCH_EVENTS_H__
+
+#include <bao.h>
+
+/**
+ * Simulated per-cpu PMU with the same programming model as the Armv8 one: counters are 32 bits
+ * wide, are set to overflow after the given number of events, and raise an interrupt on overflow
+ * if both the counter interrupt and the cpu's PMU interrupt are enabled (see sim.c).
+ */
+
+#define EVENTS_ARCH_CNTR_MAX_NUM     (6)
+#define ERROR_NO_MORE_EVENT_COUNTERS (-10)
+
+size_t events_arch_cntr_alloc(void);
+void events_arch_cntr_free(size_t counter);
+void events_arch_enable(void);
+void events_arch_disable(void);
+int events_arch_cntr_enable(size_t counter);
+void events_arch_cntr_disable(size_t counter);
+void events_arch_cntr_set(size_t counter, unsigned long value);
+void events_arch_cntr_write(size_t counter, uint32_t value);
+uint64_t events_arch_get_cntr_value(size_t counter);
+void events_arch_set_evtyper(size_t counter, size_t event);
+void events_arch_set_evtyper_raw(size_t counter, uint64_t evtyper);
+void events_arch_interrupt_enable(uint64_t cpu_id);
+void events_arch_interrupt_disable(uint64_t cpu_id);
+void events_arch_cntr_irq_enable(size_t counter);
+void events_arch_cntr_irq_disable(size_t counter);
+bool events_arch_cntr_ovs(size_t counter);
+void events_arch_clear_cntr_ovs(size_t counter);
+
+#endif /* __ARCH_EVENTS_H__ */
@@ -0,0 +1,46 @@
+/**
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (c) Bao Project and Contributors. All rights reserved.
+ */
+
+#ifndef __ARCH_TIMER_H__
+#define __ARCH_TIMER_H__
+
+#include <bao.h>
+
+/* Simulated per-cpu hypervisor timer, driven by the simulation clock (see sim.c) */
+
+#define SIM_TIMER_IRQ (26)
+
+uint64_t sim_time(void);
+uint64_t sim_freq(void);
+void sim_timer_set(uint64_t deadline);
+
+static inline irqid_t timer_arch_irq_id(void)
+{
+    return SIM_TIMER_IRQ;
+}
+
+static inline uint64_t timer_arch_get_counter(void)
+{
+    return sim_time();
+}
+
+static inline uint64_t timer_arch_get_freq(void)
+{
+    return sim_freq();
+}
+
+static inline void timer_arch_init(void) { }
+
+static inline void timer_arch_set_deadline(uint64_t deadline)
+{
+    sim_timer_set(deadline);
+}
+
+static inline void timer_arch_disarm(void)
+{
+    sim_timer_set(UINT64_MAX);
+}
+
+#endif /* __ARCH_TIMER_H__ */
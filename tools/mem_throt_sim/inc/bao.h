@@ -0,0 +1,35 @@
+/**
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (c) Bao Project and Contributors. All rights reserved.
+ */
+
+#ifndef __BAO_H__
+#define __BAO_H__
+
+/* Host stand-in for src/core/inc/bao.h: console output goes to stderr and errors abort the run */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <types.h>
+#include <util.h>
+
+#define INFO(...)                                  \
+    do {                                           \
+        fprintf(stderr, "BAO INFO: " __VA_ARGS__); \
+        fprintf(stderr, "\n");                     \
+    } while (0)
+
+#define WARNING(...)                                  \
+    do {                                              \
+        fprintf(stderr, "BAO WARNING: " __VA_ARGS__); \
+        fprintf(stderr, "\n");                        \
+    } while (0)
+
+#define ERROR(...)                                  \
+    do {                                            \
+        fprintf(stderr, "BAO ERROR: " __VA_ARGS__); \
+        fprintf(stderr, "\n");                      \
+        exit(EXIT_FAILURE);                         \
+    } while (0)
+
+#endif /* __BAO_H__ */
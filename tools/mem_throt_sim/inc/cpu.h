@@ -0,0 +1,52 @@
+/**
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (c) Bao Project and Contributors. All rights reserved.
+ */
+
+#ifndef __CPU_H__
+#define __CPU_H__
+
+#include <bao.h>
+#include <setjmp.h>
+#include <bitmap.h>
+#include <events.h>
+#include <timer.h>
+#include <mem_throt.h>
+
+/**
+ * Host stand-in for src/core/inc/cpu.h, keeping only the per-cpu state the regulator, the events
+ * layer and the timer queue use. cpu() returns the cpu the simulation is currently running
+ * hypervisor code on.
+ */
+
+struct vcpu;
+
+struct cpu {
+    cpuid_t id;
+    struct vcpu* vcpu;
+    uint64_t is_handling_irq;
+
+    struct events_cntr_owner events_owners[EVENTS_CNTR_MAX_NUM];
+    struct events_mux events_mux;
+    struct timer_queue timers;
+
+    /* cpu_standby() unwinds to the interrupt dispatch in the simulator */
+    jmp_buf standby;
+};
+
+struct cpu_synctoken {
+    int unused;
+};
+
+extern struct cpu_synctoken cpu_glb_sync;
+
+struct cpu* cpu(void);
+bool cpu_is_master(void);
+void cpu_standby(void) __attribute__((noreturn));
+
+static inline void cpu_sync_barrier(struct cpu_synctoken* token)
+{
+    (void)token;
+}
+
+#endif /* __CPU_H__ */
@@ -0,0 +1,19 @@
+/**
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (c) Bao Project and Contributors. All rights reserved.
+ */
+
+#ifndef __EXIT_STATS_H__
+#define __EXIT_STATS_H__
+
+enum exit_reason {
+    EXIT_REASON_PMU,
+};
+
+static inline void exit_stats_classify(enum exit_reason reason, unsigned long key)
+{
+    (void)reason;
+    (void)key;
+}
+
+#endif /* __EXIT_STATS_H__ */
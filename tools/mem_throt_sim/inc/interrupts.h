@@ -0,0 +1,16 @@
+/**
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (c) Bao Project and Contributors. All rights reserved.
+ */
+
+#ifndef __INTERRUPTS_H__
+#define __INTERRUPTS_H__
+
+#include <bao.h>
+
+typedef void (*irq_handler_t)(irqid_t int_id);
+
+bool interrupts_reserve(irqid_t int_id, irq_handler_t handler);
+void interrupts_cpu_enable(irqid_t int_id, bool en);
+
+#endif /* __INTERRUPTS_H__ */
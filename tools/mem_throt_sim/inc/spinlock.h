@@ -0,0 +1,27 @@
+/**
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (c) Bao Project and Contributors. All rights reserved.
+ */
+
+#ifndef __SPINLOCK_H__
+#define __SPINLOCK_H__
+
+/* The simulation runs every cpu on a single host thread, so locks are never contended */
+
+typedef struct {
+    int unused;
+} spinlock_t;
+
+#define SPINLOCK_INITVAL ((spinlock_t){ 0 })
+
+static inline void spin_lock(spinlock_t* lock)
+{
+    (void)lock;
+}
+
+static inline void spin_unlock(spinlock_t* lock)
+{
+    (void)lock;
+}
+
+#endif /* __SPINLOCK_H__ */
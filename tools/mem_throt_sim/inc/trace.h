@@ -0,0 +1,13 @@
+/**
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (c) Bao Project and Contributors. All rights reserved.
+ */
+
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#define TRACE_EVENT(CAT, EVENT, ARG0, ARG1, ARG2) \
+    do {                                          \
+    } while (0)
+
+#endif /* __TRACE_H__ */
@@ -0,0 +1,27 @@
+/**
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (c) Bao Project and Contributors. All rights reserved.
+ */
+
+#ifndef __VM_H__
+#define __VM_H__
+
+#include <bao.h>
+#include <mem_throt.h>
+
+/* Host stand-in for src/core/inc/vm.h with the fields the regulator uses */
+
+struct vm {
+    vmid_t id;
+    cpuid_t master;
+    size_t cpu_num;
+    mem_throt_t mem_throt;
+};
+
+struct vcpu {
+    vcpuid_t id;
+    mem_throt_t mem_throt;
+    struct vm* vm;
+};
+
+#endif /* __VM_H__ */
@@ -0,0 +1,810 @@
+/**
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (c) Bao Project and Contributors. All rights reserved.
+ */
+
+/**
+ * Host-side simulator for the memory bandwidth regulator. It links the hypervisor's own
+ * src/core/mem_throt.c, src/core/events.c and src/core/timer.c against a simulated clock, per-cpu
+ * PMU and hypervisor timer, and drives them with per-core memory access traces. This makes it
+ * possible to evaluate budgets, periods and regulator changes offline, deterministically and
+ * without hardware. The command line and the trace format are described in the top-level README.
+ */
+
+#include <bao.h>
+#include <cpu.h>
+#include <vm.h>
+#include <interrupts.h>
+#include <mem_throt.h>
+#include <events.h>
+#include <timer.h>
+
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SIM_CPUS_MAX   (16)
+#define SIM_PMU_IRQ    (23)
+#define SIM_DEV_IRQ    (32)
+#define SIM_IRQS_MAX   (64)
+#define SIM_NEVER      (UINT64_MAX)
+#define SIM_LINE_BYTES (64)
+
+/* A trace phase: the core issues accesses at a constant rate for duration ticks */
+struct sim_phase {
+    uint64_t duration;
+    uint64_t accesses;
+};
+
+struct sim_trace {
+    struct sim_phase* phases;
+    size_t num;
+    size_t cur;
+    uint64_t left;
+    double rate;
+    double max_rate;
+    bool loop;
+};
+
+struct sim_cntr {
+    bool allocated;
+    bool enabled;
+    bool irq_enabled;
+    bool ovs;
+    uint32_t value;
+};
+
+struct sim_stats {
+    uint64_t accesses;
+    uint64_t throttled_ticks;
+    uint64_t throttles;
+    uint64_t period_accesses;
+    uint64_t max_burst;
+    uint64_t overruns;
+};
+
+struct sim_cpu {
+    struct cpu cpu;
+    struct vcpu vcpu;
+
+    struct sim_cntr cntrs[EVENTS_ARCH_CNTR_MAX_NUM];
+    bool pmu_enabled;
+    bool pmu_irq_enabled;
+    bool timer_irq_enabled;
+    uint64_t timer_deadline;
+    uint64_t pmu_irq_time;
+    uint64_t dev_irq_time;
+
+    bool standby;
+    double carry;
+    struct sim_trace trace;
+    struct sim_stats stats;
+};
+
+static struct sim_cpu sim_cpus[SIM_CPUS_MAX];
+static size_t sim_cpu_num = 4;
+static struct sim_cpu* sim_cur;
+static struct vm sim_vm;
+static irq_handler_t sim_irq_handlers[SIM_IRQS_MAX];
+
+static uint64_t sim_now;
+static uint64_t sim_hz = 100000000;
+static uint64_t sim_skid;
+static uint64_t sim_dev_irq_period;
+
+struct cpu_synctoken cpu_glb_sync;
+
+/* Hypervisor interfaces used by the regulator, the events layer and the timer queue */
+
+struct cpu* cpu(void)
+{
+    return &sim_cur->cpu;
+}
+
+bool cpu_is_master(void)
+{
+    return sim_cur->cpu.id == 0;
+}
+
+void cpu_standby(void)
+{
+    longjmp(sim_cur->cpu.standby, 1);
+}
+
+bool interrupts_reserve(irqid_t int_id, irq_handler_t handler)
+{
+    if ((int_id >= SIM_IRQS_MAX) || (sim_irq_handlers[int_id] != NULL)) {
+        return false;
+    }
+    sim_irq_handlers[int_id] = handler;
+    return true;
+}
+
+void interrupts_cpu_enable(irqid_t int_id, bool en)
+{
+    if (int_id == SIM_TIMER_IRQ) {
+        sim_cur->timer_irq_enabled = en;
+    }
+}
+
+uint64_t sim_time(void)
+{
+    return sim_now;
+}
+
+uint64_t sim_freq(void)
+{
+    return sim_hz;
+}
+
+void sim_timer_set(uint64_t deadline)
+{
+    sim_cur->timer_deadline = deadline;
+}
+
+/* Simulated PMU */
+
+static inline struct sim_cntr* sim_cntr_get(size_t counter)
+{
+    if (counter >= EVENTS_ARCH_CNTR_MAX_NUM) {
+        ERROR("cpu%lu: invalid event counter %zu", sim_cur->cpu.id, counter);
+    }
+    return &sim_cur->cntrs[counter];
+}
+
+/* The overflow interrupt is level triggered: it stays pending while any enabled overflow is set */
+static void sim_pmu_update_irq(struct sim_cpu* sc, uint64_t when)
+{
+    bool asserted = false;
+
+    for (size_t i = 0; i < EVENTS_ARCH_CNTR_MAX_NUM; i++) {
+        asserted |= sc->cntrs[i].ovs && sc->cntrs[i].irq_enabled;
+    }
+
+    if (!asserted || !sc->pmu_irq_enabled) {
+        sc->pmu_irq_time = SIM_NEVER;
+    } else if (sc->pmu_irq_time == SIM_NEVER) {
+        sc->pmu_irq_time = when;
+    }
+}
+
+size_t events_arch_cntr_alloc(void)
+{
+    for (size_t i = 0; i < EVENTS_ARCH_CNTR_MAX_NUM; i++) {
+        if (!sim_cur->cntrs[i].allocated) {
+            sim_cur->cntrs[i].allocated = true;
+            return i;
+        }
+    }
+    return (size_t)ERROR_NO_MORE_EVENT_COUNTERS;
+}
+
+void events_arch_cntr_free(size_t counter)
+{
+    memset(sim_cntr_get(counter), 0, sizeof(struct sim_cntr));
+    sim_pmu_update_irq(sim_cur, sim_now);
+}
+
+void events_arch_enable(void)
+{
+    sim_cur->pmu_enabled = true;
+}
+
+void events_arch_disable(void)
+{
+    sim_cur->pmu_enabled = false;
+}
+
+int events_arch_cntr_enable(size_t counter)
+{
+    sim_cntr_get(counter)->enabled = true;
+    return 0;
+}
+
+void events_arch_cntr_disable(size_t counter)
+{
+    sim_cntr_get(counter)->enabled = false;
+}
+
+void events_arch_cntr_set(size_t counter, unsigned long value)
+{
+    sim_cntr_get(counter)->value = (uint32_t)(UINT32_MAX - value);
+}
+
+void events_arch_cntr_write(size_t counter, uint32_t value)
+{
+    sim_cntr_get(counter)->value = value;
+}
+
+uint64_t events_arch_get_cntr_value(size_t counter)
+{
+    return sim_cntr_get(counter)->value;
+}
+
+/* Every counter counts the trace's memory accesses, whatever event it is programmed with */
+void events_arch_set_evtyper(size_t counter, size_t event)
+{
+    UNUSED_ARG(event);
+    sim_cntr_get(counter);
+}
+
+void events_arch_set_evtyper_raw(size_t counter, uint64_t evtyper)
+{
+    UNUSED_ARG(evtyper);
+    sim_cntr_get(counter);
+}
+
+void events_arch_interrupt_enable(uint64_t cpu_id)
+{
+    UNUSED_ARG(cpu_id);
+    sim_cur->pmu_irq_enabled = true;
+    sim_pmu_update_irq(sim_cur, sim_now);
+}
+
+void events_arch_interrupt_disable(uint64_t cpu_id)
+{
+    UNUSED_ARG(cpu_id);
+    sim_cur->pmu_irq_enabled = false;
+    sim_pmu_update_irq(sim_cur, sim_now);
+}
+
+void events_arch_cntr_irq_enable(size_t counter)
+{
+    sim_cntr_get(counter)->irq_enabled = true;
+    sim_pmu_update_irq(sim_cur, sim_now);
+}
+
+void events_arch_cntr_irq_disable(size_t counter)
+{
+    sim_cntr_get(counter)->irq_enabled = false;
+    sim_pmu_update_irq(sim_cur, sim_now);
+}
+
+bool events_arch_cntr_ovs(size_t counter)
+{
+    return sim_cntr_get(counter)->ovs;
+}
+
+void events_arch_clear_cntr_ovs(size_t counter)
+{
+    sim_cntr_get(counter)->ovs = false;
+    sim_pmu_update_irq(sim_cur, sim_now);
+}
+
+static void sim_pmu_irq_handler(irqid_t int_id)
+{
+    uint64_t ovs = 0;
+
+    UNUSED_ARG(int_id);
+
+    /* Acknowledge the overflows that raised the interrupt, as the Armv8 PMU handler does */
+    for (size_t i = 0; i < EVENTS_ARCH_CNTR_MAX_NUM; i++) {
+        if (sim_cur->cntrs[i].ovs && sim_cur->cntrs[i].irq_enabled) {
+            sim_cur->cntrs[i].ovs = false;
+            ovs |= (uint64_t)1 << i;
+        }
+    }
+    sim_pmu_update_irq(sim_cur, sim_now);
+
+    if (ovs != 0) {
+        events_handle_overflow(ovs);
+    }
+}
+
+/* Device interrupts assigned to the guest only wake up the vcpu */
+static void sim_dev_irq_handler(irqid_t int_id)
+{
+    UNUSED_ARG(int_id);
+}
+
+/* Traces */
+
+static uint64_t sim_us_to_ticks(double us)
+{
+    return (uint64_t)llround((us * (double)sim_hz) / 1000000.0);
+}
+
+static void sim_trace_add(struct sim_trace* trace, uint64_t duration, uint64_t accesses)
+{
+    if (duration == 0) {
+        return;
+    }
+    trace->phases = realloc(trace->phases, (trace->num + 1) * sizeof(struct sim_phase));
+    if (trace->phases == NULL) {
+        ERROR("out of memory");
+    }
+    trace->phases[trace->num].duration = duration;
+    trace->phases[trace->num].accesses = accesses;
+    trace->num++;
+    trace->max_rate = fmax(trace->max_rate, (double)accesses / (double)duration);
+}
+
+/* One "<duration_us> <accesses>" phase per line; '#' starts a comment */
+static void sim_trace_load(struct sim_trace* trace, const char* path)
+{
+    FILE* file = fopen(path, "r");
+    char line[256];
+    size_t lineno = 0;
+
+    if (file == NULL) {
+        ERROR("%s: %s", path, strerror(errno));
+    }
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        double us;
+        unsigned long long accesses;
+        char* comment = strchr(line, '#');
+
+        lineno++;
+        if (comment != NULL) {
+            *comment = '\0';
+        }
+        if (strspn(line, " \t\r\n") == strlen(line)) {
+            continue;
+        }
+        if ((sscanf(line, "%lf %llu", &us, &accesses) != 2) || (us < 0)) {
+            ERROR("%s:%zu: expected \"<duration_us> <accesses>\"", path, lineno);
+        }
+        sim_trace_add(trace, sim_us_to_ticks(us), accesses);
+    }
+
+    fclose(file);
+}
+
+static void sim_trace_enter(struct sim_trace* trace, size_t phase)
+{
+    if (phase >= trace->num) {
+        if (!trace->loop || (trace->num == 0)) {
+            /* Past the end of the trace the core goes idle */
+            trace->cur = trace->num;
+            trace->left = SIM_NEVER;
+            trace->rate = 0;
+            return;
+        }
+        phase = 0;
+    }
+
+    trace->cur = phase;
+    trace->left = trace->phases[phase].duration;
+    trace->rate = (double)trace->phases[phase].accesses / (double)trace->phases[phase].duration;
+}
+
+/* Simulation */
+
+static void sim_irq(struct sim_cpu* sc, irqid_t int_id)
+{
+    irq_handler_t handler = sim_irq_handlers[int_id];
+
+    if (handler == NULL) {
+        return;
+    }
+
+    sim_cur = sc;
+    sc->cpu.is_handling_irq = true;
+    if (setjmp(sc->cpu.standby) == 0) {
+        handler(int_id);
+        /* Returning from the hypervisor resumes the guest */
+        sc->standby = false;
+    } else if (!sc->standby) {
+        sc->standby = true;
+        sc->stats.throttles++;
+    }
+    sc->cpu.is_handling_irq = false;
+}
+
+/* Ticks until the core's next counted access overflows an enabled counter */
+static uint64_t sim_next_overflow(struct sim_cpu* sc)
+{
+    uint64_t next = SIM_NEVER;
+
+    if (sc->standby || !sc->pmu_enabled || (sc->trace.rate <= 0)) {
+        return SIM_NEVER;
+    }
+
+    for (size_t i = 0; i < EVENTS_ARCH_CNTR_MAX_NUM; i++) {
+        struct sim_cntr* cntr = &sc->cntrs[i];
+        if (cntr->enabled) {
+            double events = ((double)UINT32_MAX - cntr->value + 1) - sc->carry;
+            uint64_t ticks = (uint64_t)ceil(events / sc->trace.rate);
+            next = min(next, max(ticks, (uint64_t)1));
+        }
+    }
+
+    return next;
+}
+
+static void sim_advance(struct sim_cpu* sc, uint64_t ticks)
+{
+    if (sc->trace.left != SIM_NEVER) {
+        sc->trace.left -= ticks;
+    }
+
+    if (sc->standby) {
+        sc->stats.throttled_ticks += ticks;
+        return;
+    }
+
+    double total = (sc->trace.rate * (double)ticks) + sc->carry;
+    uint64_t accesses = (uint64_t)total;
+    sc->carry = total - (double)accesses;
+
+    sc->stats.accesses += accesses;
+    sc->stats.period_accesses += accesses;
+
+    if (!sc->pmu_enabled) {
+        return;
+    }
+
+    for (size_t i = 0; i < EVENTS_ARCH_CNTR_MAX_NUM; i++) {
+        struct sim_cntr* cntr = &sc->cntrs[i];
+        if (!cntr->enabled) {
+            continue;
+        }
+        if (accesses > ((uint64_t)UINT32_MAX - cntr->value)) {
+            cntr->ovs = true;
+            sim_pmu_update_irq(sc, sim_now + ticks + sim_skid);
+        }
+        cntr->value = (uint32_t)(cntr->value + accesses);
+    }
+}
+
+struct sim_opts {
+    uint64_t period_us;
+    uint64_t vm_budget;
+    size_t ratios[SIM_CPUS_MAX];
+    uint64_t duration;
+    uint64_t slack;
+    bool check;
+    FILE* csv;
+};
+
+static void sim_period_end(struct sim_opts* opts, uint64_t period)
+{
+    if (opts->csv != NULL) {
+        fprintf(opts->csv, "%llu", (unsigned long long)period);
+    }
+
+    for (size_t i = 0; i < sim_cpu_num; i++) {
+        struct sim_cpu* sc = &sim_cpus[i];
+        uint64_t budget = sc->vcpu.mem_throt.budget;
+        /* Overflow is only noticed at tick granularity, so allow one tick worth of accesses */
+        uint64_t grain = (uint64_t)ceil(sc->trace.max_rate);
+
+        sc->stats.max_burst = max(sc->stats.max_burst, sc->stats.period_accesses);
+        if ((budget != 0) && (sc->stats.period_accesses > (budget + 1 + grain + opts->slack))) {
+            sc->stats.overruns++;
+        }
+        if (opts->csv != NULL) {
+            fprintf(opts->csv, ",%llu", (unsigned long long)sc->stats.period_accesses);
+        }
+        sc->stats.period_accesses = 0;
+    }
+
+    if (opts->csv != NULL) {
+        fprintf(opts->csv, "\n");
+    }
+}
+
+static void sim_setup(struct sim_opts* opts)
+{
+    sim_vm.id = 0;
+    sim_vm.master = 0;
+    sim_vm.cpu_num = sim_cpu_num;
+
+    if (!interrupts_reserve(SIM_PMU_IRQ, sim_pmu_irq_handler) ||
+        !interrupts_reserve(SIM_DEV_IRQ, sim_dev_irq_handler)) {
+        ERROR("failed to reserve simulator interrupts");
+    }
+
+    for (size_t i = 0; i < sim_cpu_num; i++) {
+        struct sim_cpu* sc = &sim_cpus[i];
+        sc->cpu.id = i;
+        sc->cpu.vcpu = &sc->vcpu;
+        sc->vcpu.id = i;
+        sc->vcpu.vm = &sim_vm;
+        sc->timer_deadline = SIM_NEVER;
+        sc->pmu_irq_time = SIM_NEVER;
+        sc->dev_irq_time = (sim_dev_irq_period != 0) ? sim_dev_irq_period : SIM_NEVER;
+        sim_trace_enter(&sc->trace, 0);
+
+        sim_cur = sc;
+        timer_init();
+    }
+
+    /* vm_init order: the master configures the VM-wide state before the other vcpus */
+    for (size_t i = 0; i < sim_cpu_num; i++) {
+        sim_cur = &sim_cpus[i];
+        mem_throt_config(opts->period_us, opts->vm_budget, opts->ratios);
+    }
+    for (size_t i = 0; i < sim_cpu_num; i++) {
+        sim_cur = &sim_cpus[i];
+        mem_throt_init();
+    }
+}
+
+static void sim_run(struct sim_opts* opts)
+{
+    uint64_t period = sim_us_to_ticks((double)opts->period_us);
+    uint64_t period_num = 0;
+
+    while (sim_now < opts->duration) {
+        uint64_t next = min(opts->duration, (period_num + 1) * period);
+
+        for (size_t i = 0; i < sim_cpu_num; i++) {
+            struct sim_cpu* sc = &sim_cpus[i];
+            uint64_t ovf = sim_next_overflow(sc);
+            if (sc->timer_irq_enabled) {
+                next = min(next, sc->timer_deadline);
+            }
+            next = min(next, sc->pmu_irq_time);
+            next = min(next, sc->dev_irq_time);
+            if (sc->trace.left != SIM_NEVER) {
+                next = min(next, sim_now + sc->trace.left);
+            }
+            if (ovf != SIM_NEVER) {
+                next = min(next, sim_now + ovf);
+            }
+        }
+        next = max(next, sim_now);
+
+        for (size_t i = 0; i < sim_cpu_num; i++) {
+            sim_advance(&sim_cpus[i], next - sim_now);
+        }
+        sim_now = next;
+
+        if (sim_now == ((period_num + 1) * period)) {
+            sim_period_end(opts, period_num++);
+        }
+
+        for (size_t i = 0; i < sim_cpu_num; i++) {
+            struct sim_cpu* sc = &sim_cpus[i];
+
+            if (sc->trace.left == 0) {
+                sim_trace_enter(&sc->trace, sc->trace.cur + 1);
+            }
+
+            /* Pending interrupts are taken lowest id first, as the GIC does at equal priority */
+            if (sc->pmu_irq_time <= sim_now) {
+                sim_irq(sc, SIM_PMU_IRQ);
+            }
+            if (sc->timer_irq_enabled && (sc->timer_deadline <= sim_now)) {
+                sim_irq(sc, SIM_TIMER_IRQ);
+            }
+            if (sc->dev_irq_time <= sim_now) {
+                sc->dev_irq_time += sim_dev_irq_period;
+                sim_irq(sc, SIM_DEV_IRQ);
+            }
+        }
+    }
+}
+
+static bool sim_report(struct sim_opts* opts)
+{
+    double seconds = (double)sim_now / (double)sim_hz;
+    uint64_t vm_accesses = 0;
+    bool ok = true;
+
+    printf("%-4s %10s %14s %10s %10s %8s %10s %10s %9s\n", "core", "budget", "accesses", "MB/s",
+        "throttles", "thr%", "max_burst", "over%", "overruns");
+
+    for (size_t i = 0; i < sim_cpu_num; i++) {
+        struct sim_cpu* sc = &sim_cpus[i];
+        uint64_t budget = sc->vcpu.mem_throt.budget;
+        double mbps = ((double)sc->stats.accesses * SIM_LINE_BYTES) / seconds / 1e6;
+        double throttled = (100.0 * (double)sc->stats.throttled_ticks) / (double)sim_now;
+        double over = (budget == 0) ?
+            0.0 :
+            ((100.0 * ((double)sc->stats.max_burst - (double)budget)) / (double)budget);
+
+        vm_accesses += sc->stats.accesses;
+        printf("%-4zu %10llu %14llu %10.1f %10llu %7.2f%% %10llu %9.2f%% %9llu\n", i,
+            (unsigned long long)budget, (unsigned long long)sc->stats.accesses, mbps,
+            (unsigned long long)sc->stats.throttles, throttled,
+            (unsigned long long)sc->stats.max_burst, max(over, 0.0),
+            (unsigned long long)sc->stats.overruns);
+
+        if (opts->check && (sc->stats.overruns != 0)) {
+            fprintf(stderr, "check: core %zu exceeded its budget of %llu in %llu periods\n", i,
+                (unsigned long long)budget, (unsigned long long)sc->stats.overruns);
+            ok = false;
+        }
+    }
+
+    printf("vm   %10llu %14llu %10.1f\n", (unsigned long long)opts->vm_budget,
+        (unsigned long long)vm_accesses, ((double)vm_accesses * SIM_LINE_BYTES) / seconds / 1e6);
+
+    return ok;
+}
+
+static void sim_usage(const char* prog)
+{
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  -n cores           number of cores/vcpus (default 4, max %d)\n"
+        "  -p period_us       regulation period (default 1000)\n"
+        "  -b accesses        VM budget per period (default 0, unregulated)\n"
+        "  -r r0,r1,...       per-core budget share in percent (default: even split)\n"
+        "  -t ms              simulated time (default 100)\n"
+        "  -f mhz             timer and simulation clock frequency (default 100)\n"
+        "  -l ns              PMU overflow interrupt latency (default 0)\n"
+        "  -i us              device interrupt period on every core (default 0, none)\n"
+        "  -T core:file       access trace for core, looped\n"
+        "  -s core:rate[:on_us:off_us]\n"
+        "                     synthetic load: rate accesses/us, optionally bursty\n"
+        "  -k accesses        per-period slack allowed by -c (default 0)\n"
+        "  -c                 exit with an error if a core exceeds its budget in any period\n"
+        "  -o file            write per-period access counts as CSV\n"
+        "  core may be '*' to apply a trace or load to every core\n",
+        prog, SIM_CPUS_MAX);
+    exit(EXIT_FAILURE);
+}
+
+static unsigned long long sim_parse_num(const char* str, const char* prog)
+{
+    char* end;
+    unsigned long long val = strtoull(str, &end, 0);
+
+    if ((end == str) || (*end != '\0')) {
+        sim_usage(prog);
+    }
+    return val;
+}
+
+/* Parses "core:" and returns the rest of the argument */
+static char* sim_parse_core(char* arg, bool* all, size_t* core, const char* prog)
+{
+    char* sep = strchr(arg, ':');
+
+    if (sep == NULL) {
+        sim_usage(prog);
+    }
+    *sep = '\0';
+    *all = (strcmp(arg, "*") == 0);
+    *core = *all ? 0 : (size_t)sim_parse_num(arg, prog);
+    return sep + 1;
+}
+
+struct sim_load {
+    char* arg;
+    bool trace;
+};
+
+static void sim_load_apply(struct sim_load* load, const char* prog)
+{
+    bool all;
+    size_t core;
+    char* spec = sim_parse_core(load->arg, &all, &core, prog);
+
+    if (!all && (core >= sim_cpu_num)) {
+        ERROR("core %zu out of range", core);
+    }
+
+    for (size_t i = all ? 0 : core; i < (all ? sim_cpu_num : (core + 1)); i++) {
+        struct sim_trace* trace = &sim_cpus[i].trace;
+
+        trace->num = 0;
+        trace->max_rate = 0;
+        trace->loop = true;
+
+        if (load->trace) {
+            sim_trace_load(trace, spec);
+            continue;
+        }
+
+        double rate, on_us, off_us;
+        int fields = sscanf(spec, "%lf:%lf:%lf", &rate, &on_us, &off_us);
+        if ((fields != 1) && (fields != 3)) {
+            sim_usage(prog);
+        }
+        if (fields == 1) {
+            on_us = 1000;
+            off_us = 0;
+        }
+        sim_trace_add(trace, sim_us_to_ticks(on_us), (uint64_t)llround(rate * on_us));
+        sim_trace_add(trace, sim_us_to_ticks(off_us), 0);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    struct sim_opts opts = { .period_us = 1000, .duration = 100 };
+    struct sim_load loads[2 * SIM_CPUS_MAX];
+    size_t load_num = 0;
+    char* ratios = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:p:b:r:t:f:l:i:T:s:k:co:h")) != -1) {
+        switch (opt) {
+            case 'n':
+                sim_cpu_num = (size_t)sim_parse_num(optarg, argv[0]);
+                break;
+            case 'p':
+                opts.period_us = sim_parse_num(optarg, argv[0]);
+                break;
+            case 'b':
+                opts.vm_budget = sim_parse_num(optarg, argv[0]);
+                break;
+            case 'r':
+                ratios = optarg;
+                break;
+            case 't':
+                opts.duration = sim_parse_num(optarg, argv[0]);
+                break;
+            case 'f':
+                sim_hz = sim_parse_num(optarg, argv[0]) * 1000000;
+                break;
+            case 'l':
+                sim_skid = sim_parse_num(optarg, argv[0]);
+                break;
+            case 'i':
+                sim_dev_irq_period = sim_parse_num(optarg, argv[0]);
+                break;
+            case 'T':
+            case 's':
+                if (load_num >= (sizeof(loads) / sizeof(loads[0]))) {
+                    sim_usage(argv[0]);
+                }
+                loads[load_num].arg = optarg;
+                loads[load_num++].trace = (opt == 'T');
+                break;
+            case 'k':
+                opts.slack = sim_parse_num(optarg, argv[0]);
+                break;
+            case 'c':
+                opts.check = true;
+                break;
+            case 'o':
+                if ((opts.csv = fopen(optarg, "w")) == NULL) {
+                    ERROR("%s: %s", optarg, strerror(errno));
+                }
+                break;
+            default:
+                sim_usage(argv[0]);
+        }
+    }
+
+    if ((optind != argc) || (sim_cpu_num == 0) || (sim_cpu_num > SIM_CPUS_MAX) ||
+        (opts.period_us == 0) || (opts.duration == 0) || (sim_hz == 0)) {
+        sim_usage(argv[0]);
+    }
+
+    /* Command line times are in convenient units, the simulation runs in clock ticks */
+    opts.duration = sim_us_to_ticks((double)opts.duration * 1000);
+    sim_skid = (sim_skid * sim_hz) / 1000000000;
+    sim_dev_irq_period = sim_us_to_ticks((double)sim_dev_irq_period);
+
+    for (size_t i = 0; i < sim_cpu_num; i++) {
+        opts.ratios[i] = 100 / sim_cpu_num;
+    }
+    for (size_t i = 0; (ratios != NULL) && (i < sim_cpu_num); i++) {
+        char* end;
+        opts.ratios[i] = strtoul(ratios, &end, 0);
+        if ((end == ratios) || ((*end != ',') && (*end != '\0'))) {
+            sim_usage(argv[0]);
+        }
+        ratios = (*end == ',') ? (end + 1) : NULL;
+    }
+
+    for (size_t i = 0; i < load_num; i++) {
+        sim_load_apply(&loads[i], argv[0]);
+    }
+
+    if (opts.csv != NULL) {
+        fprintf(opts.csv, "period");
+        for (size_t i = 0; i < sim_cpu_num; i++) {
+            fprintf(opts.csv, ",core%zu", i);
+        }
+        fprintf(opts.csv, "\n");
+    }
+
+    sim_setup(&opts);
+    sim_run(&opts);
+    bool ok = sim_report(&opts);
+
+    if (opts.csv != NULL) {
+        fclose(opts.csv);
+    }
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}